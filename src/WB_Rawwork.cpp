@@ -3,76 +3,16 @@
 #include <sstream>
 #include <fstream>
 #include <cmath>
-#include <regex>
-
-// **Function to Read V4L2 Camera Settings**
-int getCameraSetting(const std::string& setting_name) {
-    std::ostringstream command;
-    command << "v4l2-ctl --get-ctrl=" << setting_name;
-    FILE* pipe = popen(command.str().c_str(), "r");
-    if (!pipe) {
-        std::cerr << "Error: Failed to execute v4l2-ctl\n";
-        return -1;
-    }
-
-    char buffer[128];
-    std::string result;
-    while (fgets(buffer, sizeof(buffer), pipe) != nullptr) {
-        result += buffer;
-    }
-    pclose(pipe);
-
-    std::smatch match;
-    std::regex num_regex(R"(\d+)");
-    if (std::regex_search(result, match, num_regex)) {
-        try {
-            return std::stoi(match.str());
-        } catch (const std::exception& e) {
-            std::cerr << "Error: Invalid number format for " << setting_name << "\n";
-            return -1;
-        }
-    }
 
-    std::cerr << "Error: Could not extract numeric value for " << setting_name << "\n";
-    return -1;
-}
-
-// **Function to Set Camera Controls Using V4L2**
-void setCameraSettings(int brightness, int contrast, int saturation, int wb_value) {
-    static int last_brightness = -1, last_contrast = -1, last_saturation = -1, last_wb = -1;
-    
-    if (brightness == last_brightness && contrast == last_contrast && 
-        saturation == last_saturation && wb_value == last_wb) {
-        return;  // Skip if no changes
-    }
-
-    std::ostringstream command;
-    command << "v4l2-ctl --set-ctrl=brightness=" << brightness
-            << " --set-ctrl=contrast=" << contrast
-            << " --set-ctrl=saturation=" << saturation
-            << " --set-ctrl=white_balance_temperature=" << wb_value;
-    std::system(command.str().c_str());
-
-    last_brightness = brightness;
-    last_contrast = contrast;
-    last_saturation = saturation;
-    last_wb = wb_value;
-
-    std::cout << "Updated Settings -> Brightness: " << brightness 
-              << ", Contrast: " << contrast 
-              << ", Saturation: " << saturation 
-              << ", White Balance: " << wb_value << "K\n";
-}
+#include "async_log.h"
+#include "camera_control.h"
+#include "frame_stats.h"
 
 // **Function to Estimate Color Temperature (1000K - 10000K)**
-double estimateColorTemperature(const cv::Mat& image) {
-    cv::Scalar avgRGB = cv::mean(image);
-    double r = avgRGB[2], g = avgRGB[1], b = avgRGB[0];
-
-    double ratio = r / (b + 1e-6);  // Avoid division by zero
-    double temp = (ratio > 1.0) ? (4500.0 * std::pow(ratio, 1.2)) : (4500.0 / std::pow(1.0 / ratio, 1.2));
+double estimateColorTemperature(const FrameHistograms& histograms) {
+    double ratio = histograms.redBlueRatio();  // Channel means from the histogram cache
 
-    return std::round(std::min(std::max(temp, 1000.0), 10000.0));  // Clamp & round to nearest integer
+    return std::round(kelvinFromRedBlueRatio(ratio));  // Clamp & round to nearest integer
 }
 
 int main() {
@@ -87,11 +27,15 @@ int main() {
     cap.set(cv::CAP_PROP_FRAME_WIDTH, 1280);
     cap.set(cv::CAP_PROP_FRAME_HEIGHT, 720);
 
+    // **Open Camera Controls Once (Same Device as cap(0))**
+    V4L2ControlDevice controlDevice("/dev/video0");
+    CameraControls controls(controlDevice);
+
     // **Read Initial Camera Settings**
-    int brightness = getCameraSetting("brightness");
-    int contrast = getCameraSetting("contrast");
-    int saturation = getCameraSetting("saturation");
-    int whiteBalance = getCameraSetting("white_balance_temperature");
+    int brightness = controls.get("brightness");
+    int contrast = controls.get("contrast");
+    int saturation = controls.get("saturation");
+    int whiteBalance = controls.get("white_balance_temperature");
 
     brightness = std::max(0, std::min(15, brightness));
     contrast = std::max(0, std::min(30, contrast));
@@ -101,12 +45,18 @@ int main() {
     cv::Mat frame;
     bool autoWB = true;
 
+    // **Per-Frame Histograms on a 1-in-16 Pixel Grid (see bench_sampling)**
+    FrameAnalyzer analyzer;
+    uint64_t frameId = 0;
+
+    LogChannel statusLog(2.0);  // Status line at most twice a second, repeats dropped
+
     while (true) {
         cap >> frame;
         if (frame.empty()) continue;
 
         // **Estimate Corrected Color Temperature (1000K - 10000K)**
-        double colorTemperature = estimateColorTemperature(frame);
+        double colorTemperature = estimateColorTemperature(analyzer.analyze(frame, ++frameId, 4));
 
         // **If AWB is OFF, Use Current Estimated Temperature as Manual WB**
         if (!autoWB) {
@@ -115,7 +65,7 @@ int main() {
         }
 
         // **Apply Settings to Camera**
-        setCameraSettings(brightness, contrast, saturation, whiteBalance);
+        setCameraSettings(controls, brightness, contrast, saturation, whiteBalance);
 
         // **Display Camera Settings on Video**
         std::string text = "Brightness: " + std::to_string(brightness) +
@@ -145,7 +95,7 @@ int main() {
             }
         }
 
-        std::cout << text << std::endl;
+        statusLog.log(text);
     }
 
     cap.release();
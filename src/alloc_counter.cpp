@@ -0,0 +1,130 @@
+#include "alloc_counter.h"
+
+#include <opencv2/opencv.hpp>
+
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+// Plain-old-data thread_locals need no dynamic initialisation, so they are
+// safe to touch from operator new (heap_counter.cpp) before main() and
+// during thread exit.
+thread_local uint64_t threadMat = 0;
+thread_local uint64_t threadHeap = 0;
+std::atomic<uint64_t> processMat(0);
+std::atomic<uint64_t> processHeap(0);
+
+inline void countHeap() {
+    threadHeap++;
+    processHeap.fetch_add(1, std::memory_order_relaxed);
+}
+
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 2)
+using MatAccessFlag = cv::AccessFlag;
+#else
+using MatAccessFlag = int;
+#endif
+
+// **cv::MatAllocator That Counts, Then Forwards to OpenCV's Allocator**
+// The forwarded UMatData keeps the base allocator as its owner, so
+// deallocation never comes through here.
+class CountingMatAllocator : public cv::MatAllocator {
+public:
+    explicit CountingMatAllocator(cv::MatAllocator* base) : base_(base) {}
+
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                           MatAccessFlag flags, cv::UMatUsageFlags usageFlags) const override {
+        cv::UMatData* u = base_->allocate(dims, sizes, type, data, step, flags, usageFlags);
+        if (u && !data) {
+            threadMat++;
+            processMat.fetch_add(1, std::memory_order_relaxed);
+        }
+        return u;
+    }
+
+    bool allocate(cv::UMatData* data, MatAccessFlag accessFlags, cv::UMatUsageFlags usageFlags) const override {
+        return base_->allocate(data, accessFlags, usageFlags);
+    }
+
+    void deallocate(cv::UMatData* data) const override {
+        base_->deallocate(data);
+    }
+
+private:
+    cv::MatAllocator* base_;
+};
+
+void updateMax(std::atomic<uint64_t>& target, uint64_t value) {
+    uint64_t current = target.load(std::memory_order_relaxed);
+    while (value > current && !target.compare_exchange_weak(current, value)) {}
+}
+
+}  // namespace
+
+// **Called by heap_counter.cpp's operator new**
+void countHeapAllocation() {
+    countHeap();
+}
+
+void installAllocationCounter() {
+    static CountingMatAllocator* counter = nullptr;
+    if (counter) return;
+    counter = new CountingMatAllocator(cv::Mat::getDefaultAllocator());
+    cv::Mat::setDefaultAllocator(counter);
+}
+
+AllocationCounts threadAllocationCounts() {
+    AllocationCounts c;
+    c.matAllocations = threadMat;
+    c.heapAllocations = threadHeap;
+    return c;
+}
+
+AllocationCounts processAllocationCounts() {
+    AllocationCounts c;
+    c.matAllocations = processMat.load(std::memory_order_relaxed);
+    c.heapAllocations = processHeap.load(std::memory_order_relaxed);
+    return c;
+}
+
+FrameAllocationMeter::FrameAllocationMeter(uint64_t warmupFrames)
+    : warmup_(warmupFrames), frames_(0), lastMat_(0), lastHeap_(0),
+      steadyAllocating_(0), maxMat_(0), maxHeap_(0), steadyTotal_(0) {}
+
+void FrameAllocationMeter::beginFrame() {
+    start_ = threadAllocationCounts();
+}
+
+void FrameAllocationMeter::endFrame() {
+    AllocationCounts now = threadAllocationCounts();
+    uint64_t mat = now.matAllocations - start_.matAllocations;
+    uint64_t heap = now.heapAllocations - start_.heapAllocations;
+    lastMat_ = mat;
+    lastHeap_ = heap;
+
+    if (frames_++ >= warmup_) {
+        if (mat + heap > 0) steadyAllocating_++;
+        updateMax(maxMat_, mat);
+        updateMax(maxHeap_, heap);
+        steadyTotal_ += mat + heap;
+    }
+}
+
+uint64_t FrameAllocationMeter::steadyFrames() const {
+    uint64_t f = frames_;
+    return f > warmup_ ? f - warmup_ : 0;
+}
+
+void printAllocationMeter(const char* stage, const FrameAllocationMeter& meter) {
+    std::printf("Allocations (%s) -> Frames: %llu, Steady-state frames allocating: %llu/%llu, "
+                "Max per frame (Mat/heap): %llu/%llu, Last frame: %llu/%llu\n",
+                stage,
+                static_cast<unsigned long long>(meter.frames()),
+                static_cast<unsigned long long>(meter.steadyFramesAllocating()),
+                static_cast<unsigned long long>(meter.steadyFrames()),
+                static_cast<unsigned long long>(meter.steadyMaxMat()),
+                static_cast<unsigned long long>(meter.steadyMaxHeap()),
+                static_cast<unsigned long long>(meter.lastMat()),
+                static_cast<unsigned long long>(meter.lastHeap()));
+}
@@ -0,0 +1,77 @@
+// Heap allocation counters for the frame loops.
+// installAllocationCounter() wraps OpenCV's default cv::MatAllocator so
+// every Mat buffer allocation is counted. Programs that also link
+// heap_counter.cpp get counting replacements for the global operator new, so
+// every other heap allocation is counted too; in the rest heap counts stay
+// zero and operator new is the standard one. Counts are kept per thread and
+// in total. FrameAllocationMeter turns the calling
+// thread's counts into a per-frame figure for one stage, so steady-state
+// allocations (and the allocator jitter that comes with them) can be
+// checked for.
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// **Allocations Made So Far**
+struct AllocationCounts {
+    uint64_t matAllocations = 0;   // cv::Mat data buffers
+    uint64_t heapAllocations = 0;  // operator new / new[] (with heap_counter.cpp linked)
+
+    uint64_t total() const { return matAllocations + heapAllocations; }
+};
+
+// **Count cv::Mat Allocations from Now On (Call Once, Early in main)**
+void installAllocationCounter();
+
+// Allocations made by the calling thread
+AllocationCounts threadAllocationCounts();
+
+// Allocations made by every thread
+AllocationCounts processAllocationCounts();
+
+// Counts one heap allocation on the calling thread (heap_counter.cpp)
+void countHeapAllocation();
+
+// **Allocations per Frame on One Thread**
+// beginFrame() / endFrame() bracket the per-frame work on one thread. The
+// first warmupFrames frames (buffers being sized) are not counted as steady
+// state. The getters may be called from any thread.
+class FrameAllocationMeter {
+public:
+    explicit FrameAllocationMeter(uint64_t warmupFrames = 10);
+
+    void beginFrame();
+    void endFrame();
+
+    uint64_t frames() const { return frames_; }
+    uint64_t lastMat() const { return lastMat_; }
+    uint64_t lastHeap() const { return lastHeap_; }
+    uint64_t steadyFrames() const;
+    uint64_t steadyFramesAllocating() const { return steadyAllocating_; }  // Frames with any allocation
+    uint64_t steadyMaxMat() const { return maxMat_; }
+    uint64_t steadyMaxHeap() const { return maxHeap_; }
+    uint64_t steadyTotal() const { return steadyTotal_; }
+
+private:
+    uint64_t warmup_;
+    AllocationCounts start_;
+    std::atomic<uint64_t> frames_, lastMat_, lastHeap_;
+    std::atomic<uint64_t> steadyAllocating_, maxMat_, maxHeap_, steadyTotal_;
+};
+
+// **Brackets One Frame; endFrame() Runs on Every Path Out of the Scope**
+class FrameAllocationScope {
+public:
+    explicit FrameAllocationScope(FrameAllocationMeter& meter) : meter_(meter) { meter_.beginFrame(); }
+    ~FrameAllocationScope() { meter_.endFrame(); }
+
+    FrameAllocationScope(const FrameAllocationScope&) = delete;
+    FrameAllocationScope& operator=(const FrameAllocationScope&) = delete;
+
+private:
+    FrameAllocationMeter& meter_;
+};
+
+// **Print the Meter in One Line**
+void printAllocationMeter(const char* stage, const FrameAllocationMeter& meter);
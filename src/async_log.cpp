@@ -0,0 +1,145 @@
+#include "async_log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// FNV-1a: cheap and good enough to spot a repeated line
+uint64_t hashText(const std::string& text) {
+    uint64_t h = 1469598103934665603ull;
+    for (unsigned char c : text) h = (h ^ c) * 1099511628211ull;
+    return h;
+}
+
+}  // namespace
+
+// **Logger**
+AsyncLogger& AsyncLogger::instance() {
+    static AsyncLogger logger;
+    return logger;
+}
+
+AsyncLogger::AsyncLogger()
+    : slots_(new Slot[kCapacity]), enqueuePos_(0), dequeuePos_(0),
+      stopping_(false), written_(0), dropped_(0) {
+    for (size_t i = 0; i < kCapacity; i++) slots_[i].sequence.store(i, std::memory_order_relaxed);
+    writer_ = std::thread(&AsyncLogger::writerLoop, this);
+}
+
+AsyncLogger::~AsyncLogger() {
+    stopping_ = true;
+    writer_.join();  // The writer drains the ring before it returns
+}
+
+// **Bounded Multi-Producer Ring (Vyukov)**
+// Each slot's sequence says whose turn it is: pos when free for the
+// producer claiming position pos, pos + 1 once filled for the writer.
+bool AsyncLogger::write(LogLevel level, const char* text, size_t length) {
+    size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+    Slot* slot;
+    for (;;) {
+        slot = &slots_[pos & (kCapacity - 1)];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);  // Full
+            return false;
+        } else {
+            pos = enqueuePos_.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->level = level;
+    slot->length = static_cast<uint16_t>(std::min(length, kMaxMessage));
+    std::memcpy(slot->text, text, slot->length);
+    if (length > kMaxMessage) std::memcpy(slot->text + kMaxMessage - 3, "...", 3);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool AsyncLogger::pop(Slot& out) {
+    const size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+    Slot& slot = slots_[pos & (kCapacity - 1)];
+    if (slot.sequence.load(std::memory_order_acquire) != pos + 1) return false;
+
+    out.level = slot.level;
+    out.length = slot.length;
+    std::memcpy(out.text, slot.text, slot.length);
+    slot.sequence.store(pos + kCapacity, std::memory_order_release);
+    dequeuePos_.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+void AsyncLogger::flush() {
+    const size_t target = enqueuePos_.load();
+    while (dequeuePos_.load(std::memory_order_acquire) < target) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+// **Writer: Batches Whatever Is Queued, One Flush per Batch**
+void AsyncLogger::writerLoop() {
+    Slot message;
+    for (;;) {
+        // Read before draining, so everything queued before the destructor
+        // ran is written before the thread exits
+        const bool stop = stopping_;
+
+        bool wroteOut = false, wroteErr = false;
+        while (pop(message)) {
+            std::FILE* out = message.level == LogLevel::Info ? stdout : stderr;
+            std::fwrite(message.text, 1, message.length, out);
+            std::fputc('\n', out);
+            (out == stdout ? wroteOut : wroteErr) = true;
+            written_.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (wroteOut) std::fflush(stdout);
+        if (wroteErr) std::fflush(stderr);
+
+        if (stop) return;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+}
+
+// **Channel**
+LogChannel::LogChannel(double maxPerSecond, bool dedup, LogLevel level)
+    : intervalNs_(maxPerSecond > 0 ? static_cast<int64_t>(1e9 / maxPerSecond) : 0),
+      dedup_(dedup), level_(level), lastEmitNs_(INT64_MIN / 2), lastHash_(0),
+      pendingSuppressed_(0), suppressedTotal_(0) {}
+
+bool LogChannel::log(const std::string& text) {
+    const int64_t now = nowNs();
+    int64_t last = lastEmitNs_.load(std::memory_order_relaxed);
+    const uint64_t hash = dedup_ ? hashText(text) : 0;
+
+    // Rate limit, then drop a line identical to the last one written (but
+    // repeat it every kRepeatNs, with its count, so a persistent condition
+    // stays visible); the compare-exchange lets one thread through per interval
+    const int64_t kRepeatNs = 5000000000ll;
+    bool allowed = now - last >= intervalNs_ &&
+                   !(dedup_ && hash == lastHash_.load(std::memory_order_relaxed) && now - last < kRepeatNs) &&
+                   lastEmitNs_.compare_exchange_strong(last, now, std::memory_order_relaxed);
+    if (!allowed) {
+        pendingSuppressed_.fetch_add(1, std::memory_order_relaxed);
+        suppressedTotal_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    lastHash_.store(hash, std::memory_order_relaxed);
+
+    uint64_t skipped = pendingSuppressed_.exchange(0, std::memory_order_relaxed);
+    if (skipped == 0) return AsyncLogger::instance().write(level_, text);
+
+    char line[AsyncLogger::kMaxMessage];
+    int n = std::snprintf(line, sizeof(line), "%s (%llu suppressed)", text.c_str(),
+                          static_cast<unsigned long long>(skipped));
+    return AsyncLogger::instance().write(level_, line, std::min<size_t>(n, sizeof(line) - 1));
+}
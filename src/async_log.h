@@ -0,0 +1,93 @@
+// Non-blocking logging for the frame loops.
+// The live programs used to print a status line per frame with
+// std::cout << ... << std::endl: a flush and a write syscall at 30-60 Hz,
+// which stalls the loop whenever the console (a serial line, journald)
+// is slow. Here, producers copy the message into a slot of a fixed-size
+// lock-free ring and return; a background thread writes batches and
+// flushes once per batch. A full ring drops the message (counted) rather
+// than waiting.
+// LogChannel sits in front of it for repetitive output: at most
+// maxPerSecond lines, identical consecutive lines suppressed (repeated
+// every 5 s while they persist), and the number of suppressed lines
+// reported on the next line that gets through.
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+
+enum class LogLevel {
+    Info,     // stdout
+    Warning,  // stderr
+    Error,    // stderr
+};
+
+class AsyncLogger {
+public:
+    static const size_t kMaxMessage = 240;  // Longer messages are truncated
+    static const size_t kCapacity = 1024;   // Messages in flight (power of two)
+
+    // The process-wide logger; its writer thread starts on first use and
+    // drains the queue at exit.
+    static AsyncLogger& instance();
+
+    ~AsyncLogger();
+
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+    // **Queue a Line (Newline Added); Never Blocks**
+    // Returns false if the ring was full and the message was dropped.
+    bool write(LogLevel level, const char* text, size_t length);
+    bool write(LogLevel level, const std::string& text) { return write(level, text.data(), text.size()); }
+
+    // Waits until everything queued so far has been written.
+    void flush();
+
+    uint64_t written() const { return written_; }
+    uint64_t dropped() const { return dropped_; }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        LogLevel level;
+        uint16_t length;
+        char text[kMaxMessage];
+    };
+
+    AsyncLogger();
+    bool pop(Slot& out);
+    void writerLoop();
+
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<size_t> enqueuePos_;
+    std::atomic<size_t> dequeuePos_;  // Advanced by the writer only
+
+    std::atomic<bool> stopping_;
+    std::atomic<uint64_t> written_, dropped_;
+    std::thread writer_;
+};
+
+// **Rate-Limited, Deduplicating Front End for One Kind of Message**
+// Safe to call from several threads; designed for one call site in a loop.
+class LogChannel {
+public:
+    explicit LogChannel(double maxPerSecond = 2.0, bool dedup = true, LogLevel level = LogLevel::Info);
+
+    // Returns true if the line was queued.
+    bool log(const std::string& text);
+
+    uint64_t suppressed() const { return suppressedTotal_; }
+
+private:
+    int64_t intervalNs_;
+    bool dedup_;
+    LogLevel level_;
+    std::atomic<int64_t> lastEmitNs_;
+    std::atomic<uint64_t> lastHash_;
+    std::atomic<uint64_t> pendingSuppressed_, suppressedTotal_;
+};
@@ -0,0 +1,114 @@
+#include "awb_controller.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+double miredFromKelvin(double kelvin) { return 1e6 / kelvin; }
+double kelvinFromMired(double mired) { return 1e6 / mired; }
+
+}  // namespace
+
+AwbController::AwbController(const AwbConfig& config, const ControlRange& device)
+    : config_(config),
+      minKelvin_(std::max(config.minKelvin, static_cast<int>(device.minimum))),
+      maxKelvin_(std::min(config.maxKelvin, static_cast<int>(device.maximum))),
+      step_(std::max(1, static_cast<int>(device.step))),
+      period_(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double>(1.0 / std::max(config.updateHz, 0.1)))) {
+    // Config range inside the device range (the device wins if they do not
+    // overlap), aligned to the device's grid so every value is accepted
+    if (maxKelvin_ < minKelvin_) {
+        minKelvin_ = device.minimum;
+        maxKelvin_ = std::max(device.minimum, device.maximum);
+    }
+    minKelvin_ = device.minimum + (minKelvin_ - device.minimum + step_ - 1) / step_ * step_;
+    maxKelvin_ = std::max(minKelvin_, minKelvin_ + (maxKelvin_ - minKelvin_) / step_ * step_);
+    reset(device.defaultValue);
+}
+
+void AwbController::reset(int kelvin, std::chrono::steady_clock::time_point now) {
+    kelvin_ = quantize(kelvin);
+    mired_ = miredFromKelvin(kelvin_);
+    targetSum_ = 0;
+    targetCount_ = 0;
+    nextUpdate_ = now + period_;
+    started_ = now;
+    stats_ = AwbStats();
+    convergenceTotal_ = 0;
+}
+
+int AwbController::quantize(double kelvin) const {
+    double steps = std::round((kelvin - minKelvin_) / step_);
+    int value = minKelvin_ + static_cast<int>(steps) * step_;
+    return std::min(std::max(value, minKelvin_), maxKelvin_);
+}
+
+// **Average the Estimates, Then Decide at updateHz**
+bool AwbController::update(double targetKelvin, std::chrono::steady_clock::time_point now, int& kelvin) {
+    targetKelvin = std::min(std::max(targetKelvin, static_cast<double>(minKelvin_)), static_cast<double>(maxKelvin_));
+    targetSum_ += miredFromKelvin(targetKelvin);
+    targetCount_++;
+    if (now < nextUpdate_) return false;
+
+    const double dt = std::chrono::duration<double>(period_).count();
+    // After a stall the schedule restarts from now, so the frames that follow
+    // do not catch up on the missed decisions in a burst
+    nextUpdate_ = nextUpdate_ + period_ < now ? now + period_ : nextUpdate_ + period_;
+    const double target = targetSum_ / targetCount_;
+    targetSum_ = 0;
+    targetCount_ = 0;
+    stats_.updates++;
+
+    // Error against what the device has, not the unquantised state, so a
+    // target that sits between two steps does not keep the controller busy
+    const double error = target - miredFromKelvin(kelvin_);
+    if (!stats_.tracking) {
+        if (std::abs(error) <= config_.deadbandMired) return false;
+        stats_.tracking = true;
+        trackingSince_ = now;
+        mired_ = miredFromKelvin(kelvin_);
+    }
+
+    // First-order approach in mired space, the same settling as the old EMA
+    const double alpha = 1.0 - std::exp(-dt / std::max(config_.timeConstant, 1e-3));
+    mired_ += alpha * (target - mired_);
+    int next = quantize(kelvinFromMired(mired_));
+
+    // Settled: inside the release band, or the remaining error is below one device step
+    double remaining = std::abs(target - miredFromKelvin(next));
+    double stepMired = std::abs(miredFromKelvin(next) - miredFromKelvin(std::min(next + step_, maxKelvin_)));
+    if (remaining <= config_.releaseMired || (next == kelvin_ && remaining <= stepMired)) {
+        next = quantize(kelvinFromMired(target));
+        stats_.tracking = false;
+        double seconds = std::chrono::duration<double>(now - trackingSince_).count();
+        stats_.lastConvergenceSeconds = seconds;
+        convergenceTotal_ += seconds;
+        stats_.convergences++;
+        stats_.meanConvergenceSeconds = convergenceTotal_ / stats_.convergences;
+    }
+
+    if (next == kelvin_) return false;
+    kelvin_ = next;
+    kelvin = next;
+    stats_.writes++;
+    return true;
+}
+
+AwbStats AwbController::stats(std::chrono::steady_clock::time_point now) const {
+    AwbStats s = stats_;
+    double minutes = std::chrono::duration<double>(now - started_).count() / 60.0;
+    s.writesPerMinute = minutes > 1.0 / 60 ? s.writes / minutes : 0.0;
+    return s;
+}
+
+std::string describeAwbStats(const AwbStats& stats) {
+    char line[160];
+    std::snprintf(line, sizeof(line), "AWB: %llu writes (%.1f/min), convergence %.2f s (mean %.2f s over %llu)%s",
+                  static_cast<unsigned long long>(stats.writes), stats.writesPerMinute,
+                  stats.lastConvergenceSeconds, stats.meanConvergenceSeconds,
+                  static_cast<unsigned long long>(stats.convergences), stats.tracking ? ", tracking" : "");
+    return line;
+}
@@ -0,0 +1,75 @@
+// Manual white balance controller for the live programs.
+// The old per-frame EMA produced a new integer kelvin value on almost every
+// frame while converging, and each one went to the device. AwbController
+// instead averages the per-frame estimates and acts only updateHz times a
+// second, whatever the frame rate. It works in mired (1e6 / K), where equal
+// steps look equally large to the eye. It starts moving only when the
+// target is more than deadbandMired away, keeps moving until within
+// releaseMired (hysteresis, so noise around the edge does not make it
+// chatter), and rounds to the step the device accepts. The result is a
+// handful of writes per adjustment instead of dozens per second.
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "camera_control.h"
+
+// **Controller Tuning**
+struct AwbConfig {
+    double updateHz = 4.0;        // Controller decisions per second
+    double timeConstant = 0.5;    // Seconds to cover ~63% of the error while tracking
+    double deadbandMired = 6.0;   // Error needed to start moving
+    double releaseMired = 2.0;    // Error at which tracking stops
+    int minKelvin = 1000;         // Clamped further to the device range
+    int maxKelvin = 10000;
+};
+
+// **Writes and Settling, for Tuning**
+struct AwbStats {
+    uint64_t updates = 0;          // Controller decisions taken
+    uint64_t writes = 0;           // New kelvin values handed out
+    double writesPerMinute = 0;    // Since construction or reset()
+    double lastConvergenceSeconds = 0;  // Deadband exit to settled, last adjustment
+    double meanConvergenceSeconds = 0;
+    uint64_t convergences = 0;
+    bool tracking = false;
+};
+
+class AwbController {
+public:
+    // device is the white_balance_temperature range (see
+    // CameraControls::query); the default accepts any kelvin in 1 K steps.
+    explicit AwbController(const AwbConfig& config = AwbConfig(),
+                           const ControlRange& device = ControlRange{1000, 10000, 1, 4500});
+
+    // Starts over from a known device value (e.g. when AWB is switched off).
+    void reset(int kelvin, std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+    // **Feed One Estimate; Returns True When kelvin Should Be Written**
+    // Cheap enough to call every frame; decisions are taken at updateHz.
+    bool update(double targetKelvin, std::chrono::steady_clock::time_point now, int& kelvin);
+
+    int kelvin() const { return kelvin_; }
+    AwbStats stats(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now()) const;
+
+private:
+    int quantize(double kelvin) const;
+
+    AwbConfig config_;
+    int minKelvin_, maxKelvin_, step_;
+    std::chrono::steady_clock::duration period_;
+
+    int kelvin_;             // Last value handed out (quantised)
+    double mired_;           // Unquantised controller state
+    double targetSum_ = 0;   // Estimates since the last decision, in mired
+    int targetCount_ = 0;
+    std::chrono::steady_clock::time_point nextUpdate_, started_, trackingSince_;
+
+    AwbStats stats_;
+    double convergenceTotal_ = 0;
+};
+
+// "AWB: 12 writes (3.1/min), convergence 1.8 s (mean 1.6 s over 4)"
+std::string describeAwbStats(const AwbStats& stats);
@@ -0,0 +1,353 @@
+// Headless batch version of the main2.cpp still-image chain:
+//   denoise (fastNlMeansDenoisingColored) -> 3x3 sharpen -> per-channel CLAHE
+//   -> optional bilateral filter -> optional gamma,
+// or any other EnhanceChain given with --chain.
+// Inputs are files and/or directories; results are written to the output
+// directory under the same file name; two inputs that would write the same
+// output file (a/img.png and b/img.png) stop the run before it starts. Each worker decodes, processes and
+// encodes whole images, so decode, processing and encode of different images
+// overlap across the pool. OpenCV's own threading is switched off while the
+// pool runs, so each core works on one image at a time.
+//
+// Usage: ./batch_enhance [options] <image or directory>...
+//   -o <dir>          Output directory (default: enhanced)
+//   --chain <spec>    Enhancement chain, e.g. "denoise:1:2,sharpen,clahe-rgb:5"
+//                     (replaces --denoise/--clip/--bilateral/--gamma)
+//   -l <file>         Read input paths from a text file, one per line
+//   -j <n>            Worker threads (default: all cores)
+//   --resize WxH      Resize before processing (main2 uses 400x250)
+//   --denoise h,hc    Denoise strengths (default: 1,2; 0 disables)
+//   --denoise-tier t  nlm (default), nlm-fast, bilateral or guided (denoise.h)
+//   --clip <limit>    CLAHE clip limit (default: 5.0)
+//   --bilateral       Apply bilateralFilter(9, 75, 75) after CLAHE
+//   --gamma <g>       Apply a gamma LUT (main2 uses 0.5)
+//   --ext <.ext>      Output format (default: same as the input)
+//   --quality <q>     JPEG quality (default: 95)
+
+#include <opencv2/opencv.hpp>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "enhance_chain.h"
+
+// **Command-Line Options**
+struct BatchOptions {
+    std::vector<std::string> inputs;
+    std::string outputDir = "enhanced";
+    int workers = 0;
+    cv::Size resize;
+    float denoiseH = 1.0f, denoiseHColor = 2.0f;
+    DenoiseTier denoiseTier = DenoiseTier::NlMeans;
+    double clipLimit = 5.0;
+    bool bilateral = false;
+    double gamma = 0.0;
+    std::string chain;
+    std::string ext;
+    int quality = 95;
+};
+
+// **Per-Worker Time per Stage, Merged at the End**
+// Stage 0 is decode, then resize, the chain's stages, and encode last.
+struct StageTimes {
+    std::vector<std::string> names;
+    std::vector<double> ms;
+    uint64_t images = 0;
+
+    void add(const StageTimes& other) {
+        if (names.empty()) {
+            names = other.names;
+            ms.assign(other.ms.size(), 0.0);
+        }
+        for (size_t i = 0; i < ms.size() && i < other.ms.size(); i++) ms[i] += other.ms[i];
+        images += other.images;
+    }
+};
+
+static double msSince(std::chrono::steady_clock::time_point& last) {
+    auto now = std::chrono::steady_clock::now();
+    double ms = std::chrono::duration<double, std::milli>(now - last).count();
+    last = now;
+    return ms;
+}
+
+static bool hasImageExtension(const std::string& path) {
+    static const char* exts[] = {".jpg", ".jpeg", ".png", ".bmp", ".tif", ".tiff", ".webp"};
+    size_t dot = path.rfind('.');
+    if (dot == std::string::npos) return false;
+    std::string ext = path.substr(dot);
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    for (const char* e : exts)
+        if (ext == e) return true;
+    return false;
+}
+
+static bool isDirectory(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+// **Expand Directories into Their Image Files**
+static void collectInputs(const std::string& path, std::vector<std::string>& files) {
+    if (!isDirectory(path)) {
+        files.push_back(path);
+        return;
+    }
+    std::vector<cv::String> found;
+    cv::glob(path + "/*", found, false);
+    for (const cv::String& f : found)
+        if (hasImageExtension(f)) files.push_back(f);
+}
+
+static std::string outputPath(const BatchOptions& options, const std::string& input) {
+    size_t slash = input.find_last_of('/');
+    std::string name = (slash == std::string::npos) ? input : input.substr(slash + 1);
+    if (!options.ext.empty()) {
+        size_t dot = name.rfind('.');
+        if (dot != std::string::npos) name = name.substr(0, dot);
+        name += options.ext;
+    }
+    return options.outputDir + "/" + name;
+}
+
+// **Refuse Inputs That Would Overwrite Each Other's Output**
+static bool checkOutputCollisions(const BatchOptions& options) {
+    std::map<std::string, const std::string*> writers;
+    bool unique = true;
+    for (const std::string& input : options.inputs) {
+        auto inserted = writers.insert({outputPath(options, input), &input});
+        if (!inserted.second) {
+            std::cerr << "Error: " << input << " and " << *inserted.first->second << " would both be written to "
+                      << inserted.first->first << std::endl;
+            unique = false;
+        }
+    }
+    return unique;
+}
+
+static void printUsage() {
+    std::cerr << "Usage: batch_enhance [-o dir] [-l list] [-j n] [--resize WxH] [--chain spec] [--denoise h,hc]\n"
+                 "                     [--denoise-tier t] [--clip limit] [--bilateral] [--gamma g] [--ext .png] [--quality q]\n"
+                 "                     <image or directory>...\n";
+}
+
+static bool parseOptions(int argc, char** argv, BatchOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "-o" && hasValue) {
+            options.outputDir = argv[++i];
+        } else if (arg == "-l" && hasValue) {
+            std::ifstream list(argv[++i]);
+            if (!list) {
+                std::cerr << "Error: Cannot read list file " << argv[i] << std::endl;
+                return false;
+            }
+            std::string line;
+            while (std::getline(list, line))
+                if (!line.empty()) collectInputs(line, options.inputs);
+        } else if (arg == "-j" && hasValue) {
+            options.workers = std::atoi(argv[++i]);
+        } else if (arg == "--resize" && hasValue) {
+            if (std::sscanf(argv[++i], "%dx%d", &options.resize.width, &options.resize.height) != 2) {
+                std::cerr << "Error: --resize expects WxH" << std::endl;
+                return false;
+            }
+        } else if (arg == "--denoise" && hasValue) {
+            if (std::sscanf(argv[++i], "%f,%f", &options.denoiseH, &options.denoiseHColor) != 2) {
+                std::cerr << "Error: --denoise expects h,hColor" << std::endl;
+                return false;
+            }
+        } else if (arg == "--denoise-tier" && hasValue) {
+            if (!parseDenoiseTier(argv[++i], options.denoiseTier)) {
+                std::cerr << "Error: Unknown denoise tier " << argv[i] << std::endl;
+                return false;
+            }
+        } else if (arg == "--chain" && hasValue) {
+            options.chain = argv[++i];
+        } else if (arg == "--clip" && hasValue) {
+            options.clipLimit = std::atof(argv[++i]);
+        } else if (arg == "--bilateral") {
+            options.bilateral = true;
+        } else if (arg == "--gamma" && hasValue) {
+            options.gamma = std::atof(argv[++i]);
+        } else if (arg == "--ext" && hasValue) {
+            options.ext = argv[++i];
+            if (options.ext[0] != '.') options.ext = "." + options.ext;
+        } else if (arg == "--quality" && hasValue) {
+            options.quality = std::atoi(argv[++i]);
+        } else if (!arg.empty() && arg[0] == '-') {
+            std::cerr << "Error: Unknown option " << arg << std::endl;
+            return false;
+        } else {
+            collectInputs(arg, options.inputs);
+        }
+    }
+    return true;
+}
+
+// **main2 Chain from the Individual Options**
+static std::string defaultChain(const BatchOptions& options) {
+    std::string spec;
+    if (options.denoiseH > 0 || options.denoiseHColor > 0) {
+        spec += std::string("denoise-") + denoiseTierName(options.denoiseTier) + ":" + std::to_string(options.denoiseH) + ":" + std::to_string(options.denoiseHColor) + ",";
+    }
+    spec += "sharpen,clahe-rgb:" + std::to_string(options.clipLimit);
+    if (options.bilateral) spec += ",bilateral";
+    if (options.gamma > 0) spec += ",gamma:" + std::to_string(options.gamma);
+    return spec;
+}
+
+// **Per-Worker Processing State, Reused for Every Image**
+// The chain is re-planned only when an image has a different size from the
+// previous one.
+class BatchWorker {
+public:
+    explicit BatchWorker(const BatchOptions& options) : options_(options) {
+        encodeParams_ = {cv::IMWRITE_JPEG_QUALITY, options.quality};
+    }
+
+    bool init(const std::string& spec, StageTimes& times) {
+        EnhanceChainBuilder builder;
+        if (!builder.parse(spec) || !builder.build(cv::Size(), CV_8UC3, chain_)) return false;
+
+        times.names = {"decode", "resize"};
+        for (size_t i = 0; i < chain_.size(); i++) times.names.push_back(chain_.stage(i).name());
+        times.names.push_back("encode");
+        times.ms.assign(times.names.size(), 0.0);
+        return true;
+    }
+
+    bool run(const std::string& input, StageTimes& times) {
+        auto last = std::chrono::steady_clock::now();
+
+        // **Decode**
+        cv::Mat image = cv::imread(input, cv::IMREAD_COLOR);
+        times.ms[0] += msSince(last);
+        if (image.empty()) {
+            std::cerr << "Error: Could not load " << input << std::endl;
+            return false;
+        }
+
+        if (options_.resize.area() > 0) {
+            cv::resize(image, resized_, options_.resize, 0, 0, cv::INTER_LINEAR);
+            image = resized_;
+            times.ms[1] += msSince(last);
+        }
+
+        // **Enhance (Per-Stage Times Come from the Chain)**
+        if (!chain_.run(image, result_)) return false;
+        msSince(last);
+
+        // **Encode**
+        std::string output = outputPath(options_, input);
+        bool written = cv::imwrite(output, result_, encodeParams_);
+        times.ms.back() += msSince(last);
+        if (!written) {
+            std::cerr << "Error: Could not write " << output << std::endl;
+            return false;
+        }
+        times.images++;
+        return true;
+    }
+
+    void collectChainTimes(StageTimes& times) const {
+        for (size_t i = 0; i < chain_.size(); i++) times.ms[2 + i] += chain_.stageMs(i);
+    }
+
+private:
+    const BatchOptions& options_;
+    EnhanceChain chain_;
+    std::vector<int> encodeParams_;
+    cv::Mat resized_, result_;
+};
+
+int main(int argc, char** argv) {
+    BatchOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return -1;
+    }
+    if (options.inputs.empty()) {
+        std::cerr << "Error: No input images" << std::endl;
+        printUsage();
+        return -1;
+    }
+
+    if (!checkOutputCollisions(options)) return -1;
+
+    if (mkdir(options.outputDir.c_str(), 0755) != 0 && !isDirectory(options.outputDir)) {
+        std::cerr << "Error: Cannot create output directory " << options.outputDir << std::endl;
+        return -1;
+    }
+
+    const std::string spec = options.chain.empty() ? defaultChain(options) : options.chain;
+    {
+        // Validate the spec once before starting the pool
+        EnhanceChainBuilder builder;
+        EnhanceChain chain;
+        if (!builder.parse(spec) || !builder.build(cv::Size(), CV_8UC3, chain)) {
+            std::cerr << "Error: Invalid enhancement chain '" << spec << "'" << std::endl;
+            return -1;
+        }
+        std::cout << "Enhancement: " << chain.describe() << "\n";
+    }
+
+    int workers = options.workers > 0 ? options.workers : static_cast<int>(std::thread::hardware_concurrency());
+    workers = std::max(1, std::min(workers, static_cast<int>(options.inputs.size())));
+
+    // Parallelism comes from the pool; nested OpenCV threads would oversubscribe
+    if (workers > 1) cv::setNumThreads(1);
+
+    // **Worker Pool Pulling Images from a Shared Index**
+    std::atomic<size_t> next(0);
+    std::atomic<uint64_t> failed(0);
+    std::mutex totalsMutex;
+    StageTimes totals;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (int w = 0; w < workers; w++) {
+        pool.emplace_back([&]() {
+            BatchWorker worker(options);
+            StageTimes times;
+            if (!worker.init(spec, times)) return;
+            for (size_t i = next++; i < options.inputs.size(); i = next++)
+                if (!worker.run(options.inputs[i], times)) failed++;
+            worker.collectChainTimes(times);
+
+            std::lock_guard<std::mutex> lock(totalsMutex);
+            totals.add(times);
+        });
+    }
+    for (std::thread& t : pool) t.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // **Report**
+    std::printf("Processed %llu of %zu images with %d workers in %.2f s (%.1f images/s, %.0f images/h)\n",
+                static_cast<unsigned long long>(totals.images), options.inputs.size(), workers, seconds,
+                totals.images / seconds, 3600.0 * totals.images / seconds);
+    if (totals.images > 0) {
+        double all = 0;
+        for (double ms : totals.ms) all += ms;
+        std::printf("  %-10s %12s %8s\n", "stage", "ms/image", "share");
+        for (size_t i = 0; i < totals.ms.size(); i++) {
+            if (totals.ms[i] == 0) continue;
+            std::printf("  %-10s %12.2f %7.1f%%\n", totals.names[i].c_str(),
+                        totals.ms[i] / totals.images, 100.0 * totals.ms[i] / all);
+        }
+    }
+    if (failed > 0) std::printf("Failed: %llu\n", static_cast<unsigned long long>(failed.load()));
+    return failed > 0 ? 1 : 0;
+}
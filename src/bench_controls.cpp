@@ -0,0 +1,171 @@
+// Checks and times the camera control path without a camera.
+// Drives CameraControls against a FakeControlDevice: unchanged settings must
+// not reach the device, a change must go out as one batch holding only the
+// changed controls, and the device must end up with the requested values,
+// clamped to the range and rounded to the step like a V4L2 driver does.
+// Then times apply() for a changing and an unchanged request, which is the
+// cost the frame loops pay on top of the ioctl itself.
+// Last, AwbController is driven through a simulated 1400 K scene change at
+// 30 fps, with noisy estimates, writing to a fake device with a 10 K step:
+// it reports settling time and device writes, and checks that the
+// controller settles near the target without a burst of decisions after a
+// stalled frame.
+// Exits with 1 if a check fails.
+// Run from the build directory: ./bench_controls [iterations]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+#include "awb_controller.h"
+#include "camera_control.h"
+
+static int failures = 0;
+
+static void check(bool ok, const std::string& what) {
+    std::printf("  %-58s %s\n", what.c_str(), ok ? "ok" : "FAILED");
+    if (!ok) failures++;
+}
+
+static int32_t valueOf(FakeControlDevice& device, uint32_t id) {
+    int32_t value = INT32_MIN;
+    device.getControl(id, value);
+    return value;
+}
+
+// **Write Semantics of CameraControls**
+static void checkControlPath() {
+    std::printf("Control path:\n");
+    FakeControlDevice device;
+    CameraControls controls(device);
+
+    check(controls.apply({5, 10, 20, 4600}) == ControlWrite::Written, "first apply writes");
+    check(device.batchCount() == 1 && device.writeCount() == 4, "  as one batch of 4 controls");
+    check(valueOf(device, V4L2_CID_BRIGHTNESS) == 5 && valueOf(device, V4L2_CID_WHITE_BALANCE_TEMPERATURE) == 4600,
+          "  device holds the requested values");
+
+    check(controls.apply({5, 10, 20, 4600}) == ControlWrite::Unchanged, "unchanged apply does not write");
+    check(device.batchCount() == 1 && device.writeCount() == 4, "  device untouched");
+
+    check(controls.apply({5, 10, 20, 4700}) == ControlWrite::Written, "white balance change writes");
+    check(device.batchCount() == 2 && device.writeCount() == 5, "  one batch holding only white balance");
+
+    check(controls.applyWhiteBalance(4700) == ControlWrite::Unchanged, "unchanged applyWhiteBalance does not write");
+    check(controls.applyWhiteBalance(4800) == ControlWrite::Written && valueOf(device, V4L2_CID_WHITE_BALANCE_TEMPERATURE) == 4800,
+          "applyWhiteBalance writes a new value");
+
+    // assume() leaves controls the device already holds out of the batch
+    controls.assume({INT32_MIN, INT32_MIN, INT32_MIN, 4800});
+    int writes = device.writeCount();
+    check(controls.apply({6, 10, 20, 4800}) == ControlWrite::Written && device.writeCount() == writes + 3,
+          "after assume(), white balance is not rewritten");
+
+    ControlRange range{0, 0, 0, 0};
+    device.addControl(V4L2_CID_WHITE_BALANCE_TEMPERATURE, 4800, ControlRange{2800, 6500, 10, 4600});
+    check(controls.query("white_balance_temperature", range) && range.minimum == 2800 && range.step == 10,
+          "query returns the registered range");
+    check(!device.setControl(V4L2_CID_GAIN, 1), "write to an unregistered control fails");
+    check(!device.setControls({{V4L2_CID_BRIGHTNESS, 1}, {V4L2_CID_GAIN, 1}}) &&
+              valueOf(device, V4L2_CID_BRIGHTNESS) == 6,
+          "a batch with an unknown control is rejected whole");
+
+    check(controls.applyWhiteBalance(9000) == ControlWrite::Written &&
+              valueOf(device, V4L2_CID_WHITE_BALANCE_TEMPERATURE) == 6500,
+          "out-of-range write is clamped to the maximum");
+    check(controls.applyWhiteBalance(4805) == ControlWrite::Written &&
+              valueOf(device, V4L2_CID_WHITE_BALANCE_TEMPERATURE) == 4810,
+          "off-step write is rounded to the step");
+    check(device.controlStats(V4L2_CID_WHITE_BALANCE_TEMPERATURE).adjusted == 2, "  both counted as adjusted");
+}
+
+// **Cost of apply() per Frame**
+static void timeControlPath(int iterations) {
+    FakeControlDevice device;
+    CameraControls controls(device);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        controls.apply({i & 15, 13, 9, 4000 + (i & 1) * 10});  // Changes every call
+    }
+    auto changing = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        controls.apply({15, 13, 9, 4010});  // Same as the last write
+    }
+    auto unchanged = std::chrono::steady_clock::now() - start;
+
+    auto ns = [iterations](std::chrono::steady_clock::duration d) {
+        return std::chrono::duration<double, std::nano>(d).count() / iterations;
+    };
+    std::printf("Timing (%d iterations, fake device):\n", iterations);
+    std::printf("  apply, settings changed    %8.1f ns\n", ns(changing));
+    std::printf("  apply, settings unchanged  %8.1f ns\n", ns(unchanged));
+    std::printf("  batches %d, controls written %d\n", device.batchCount(), device.writeCount());
+}
+
+// **AWB Controller Against a Simulated Scene Change**
+static void simulateAwb() {
+    using Clock = std::chrono::steady_clock;
+    const ControlRange range{2800, 6500, 10, 4000};
+    FakeControlDevice device;
+    device.addControl(V4L2_CID_WHITE_BALANCE_TEMPERATURE, range.defaultValue, range);
+    CameraControls controls(device);
+    controls.assume({INT32_MIN, INT32_MIN, INT32_MIN, range.defaultValue});
+
+    AwbController awb(AwbConfig(), range);
+    Clock::time_point now = Clock::now();
+    awb.reset(range.defaultValue, now);
+
+    // 4000 K -> 5400 K at t = 0, estimates with 60 K of noise, 30 fps for 6 s
+    const double scene = 5400.0;
+    const auto frame = std::chrono::microseconds(33333);
+    std::mt19937 random(7);
+    std::normal_distribution<double> noise(0.0, 60.0);
+    const int before = device.writeCount();
+    double settledAt = -1;
+    for (int i = 0; i < 180; i++) {
+        now += frame;
+        int kelvin;
+        if (awb.update(scene + noise(random), now, kelvin)) controls.applyWhiteBalance(kelvin);
+        if (settledAt < 0 && awb.stats(now).convergences > 0) settledAt = (i + 1) / 30.0;
+    }
+    const int writes = device.writeCount() - before;
+    const int32_t deviceKelvin = valueOf(device, V4L2_CID_WHITE_BALANCE_TEMPERATURE);
+
+    std::printf("AWB, 4000 K -> 5400 K step, 30 fps, 60 K estimate noise, 10 K device step:\n");
+    std::printf("  settled after %.2f s, %d device writes, device at %d K\n", settledAt, writes, deviceKelvin);
+    check(settledAt > 0 && settledAt < 4.0, "settles within 4 s");
+    check(std::abs(1e6 / deviceKelvin - 1e6 / scene) <= AwbConfig().deadbandMired, "ends inside the deadband of the target");
+    check(writes > 0 && writes <= 20, "takes at most 20 device writes");
+    check(device.controlStats(V4L2_CID_WHITE_BALANCE_TEMPERATURE).adjusted == 0,
+          "every write is on the device's range and step");
+
+    // A 2 s stall, then two frames: only the first may take a decision
+    now += std::chrono::seconds(2);
+    const uint64_t updates = awb.stats(now).updates;
+    int kelvin;
+    awb.update(scene, now, kelvin);
+    now += frame;
+    awb.update(scene, now, kelvin);
+    check(awb.stats(now).updates == updates + 1, "one decision, not a burst, after a stalled frame");
+}
+
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? std::max(1, std::atoi(argv[1])) : 1000000;
+
+    checkControlPath();
+    timeControlPath(iterations);
+    simulateAwb();
+
+    if (failures > 0) {
+        std::printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
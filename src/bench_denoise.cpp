@@ -0,0 +1,151 @@
+// Compares the Denoiser tiers with the NL-means call of main1.cpp.
+// Quality: PSNR and SSIM of every tier against the nlm output, on the
+// repository images. Speed: ms per frame at 720p and 1080p (the images
+// resized), against the provisional budgets in denoise.h; the figures
+// printed here on the reference machine are what those budgets should be.
+// Run from the build directory: ./bench_denoise [h] [iterations]
+//   h defaults to 10, the strength main1.cpp uses.
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "denoise.h"
+
+// **Mean SSIM over All Channels (11x11 Gaussian Window, sigma 1.5)**
+static double ssim(const cv::Mat& a, const cv::Mat& b) {
+    const double c1 = 6.5025, c2 = 58.5225;  // (0.01 * 255)^2, (0.03 * 255)^2
+    cv::Mat x, y;
+    a.convertTo(x, CV_32F);
+    b.convertTo(y, CV_32F);
+
+    cv::Mat xx, yy, xy;
+    cv::multiply(x, x, xx);
+    cv::multiply(y, y, yy);
+    cv::multiply(x, y, xy);
+
+    cv::Mat muX, muY, sXX, sYY, sXY;
+    const cv::Size window(11, 11);
+    cv::GaussianBlur(x, muX, window, 1.5);
+    cv::GaussianBlur(y, muY, window, 1.5);
+    cv::GaussianBlur(xx, sXX, window, 1.5);
+    cv::GaussianBlur(yy, sYY, window, 1.5);
+    cv::GaussianBlur(xy, sXY, window, 1.5);
+
+    cv::Mat muXX, muYY, muXY;
+    cv::multiply(muX, muX, muXX);
+    cv::multiply(muY, muY, muYY);
+    cv::multiply(muX, muY, muXY);
+    cv::subtract(sXX, muXX, sXX);
+    cv::subtract(sYY, muYY, sYY);
+    cv::subtract(sXY, muXY, sXY);
+
+    // (2 muXY + c1)(2 sXY + c2) / ((muXX + muYY + c1)(sXX + sYY + c2))
+    cv::Mat num1 = muXY * 2, num2 = sXY * 2, den1, den2, num, den, map;
+    cv::add(num1, cv::Scalar::all(c1), num1);
+    cv::add(num2, cv::Scalar::all(c2), num2);
+    cv::add(muXX, muYY, den1);
+    cv::add(den1, cv::Scalar::all(c1), den1);
+    cv::add(sXX, sYY, den2);
+    cv::add(den2, cv::Scalar::all(c2), den2);
+    cv::multiply(num1, num2, num);
+    cv::multiply(den1, den2, den);
+    cv::divide(num, den, map);
+
+    cv::Scalar m = cv::mean(map);
+    double sum = 0;
+    for (int c = 0; c < a.channels(); c++) sum += m[c];
+    return sum / a.channels();
+}
+
+// **Median Milliseconds per Frame**
+static double timeTier(Denoiser& denoiser, const cv::Mat& frame, int iterations) {
+    cv::Mat out;
+    denoiser.apply(frame, out);  // Warm-up: buffers sized
+    std::vector<double> ms;
+    for (int i = 0; i < iterations; i++) {
+        cv::TickMeter tm;
+        tm.start();
+        denoiser.apply(frame, out);
+        tm.stop();
+        ms.push_back(tm.getTimeMilli());
+    }
+    std::sort(ms.begin(), ms.end());
+    return ms[ms.size() / 2];
+}
+
+int main(int argc, char** argv) {
+    const float h = (argc > 1) ? static_cast<float>(std::atof(argv[1])) : 10.0f;
+    int iterations = (argc > 2) ? std::atoi(argv[2]) : 10;
+    if (iterations <= 0) iterations = 10;
+
+    const DenoiseTier tiers[] = {DenoiseTier::Guided, DenoiseTier::Bilateral, DenoiseTier::NlMeansFast};
+    auto configFor = [h](DenoiseTier tier) {
+        DenoiseConfig config;
+        config.tier = tier;
+        config.h = h;
+        config.hColor = h;
+        return config;
+    };
+
+    std::vector<std::pair<std::string, cv::Mat>> images;
+    const char* paths[] = {"../image.jpeg", "../image1.jpeg", "../image2.jpeg", "../image3.jpeg"};
+    for (const char* path : paths) {
+        cv::Mat image = cv::imread(path, cv::IMREAD_COLOR);
+        if (image.empty()) {
+            std::fprintf(stderr, "Warning: Could not load %s, skipping\n", path);
+            continue;
+        }
+        images.push_back({path, image});
+    }
+    if (images.empty()) {
+        std::fprintf(stderr, "Error: No images loaded (run from the build directory)\n");
+        return 1;
+    }
+
+    // **Quality Against the NL-Means Output (h = hColor, 7x7 / 21x21)**
+    std::printf("Quality against nlm (h = %.1f), PSNR dB / SSIM:\n", h);
+    std::printf("  %-18s %16s", "image", "input");
+    for (DenoiseTier tier : tiers) std::printf(" %16s", denoiseTierName(tier));
+    std::printf("\n");
+    for (const auto& image : images) {
+        cv::Mat reference, out;
+        Denoiser(configFor(DenoiseTier::NlMeans)).apply(image.second, reference);
+
+        std::printf("  %-18s %8.2f / %5.3f", image.first.c_str(),
+                    cv::PSNR(image.second, reference), ssim(image.second, reference));
+        for (DenoiseTier tier : tiers) {
+            Denoiser(configFor(tier)).apply(image.second, out);
+            std::printf(" %8.2f / %5.3f", cv::PSNR(out, reference), ssim(out, reference));
+        }
+        std::printf("\n");
+    }
+
+    // **Speed at 720p and 1080p Against the Provisional Budgets**
+    const cv::Size sizes[] = {cv::Size(1280, 720), cv::Size(1920, 1080)};
+    const char* sizeNames[] = {"720p", "1080p"};
+    int overBudget = 0;
+    std::printf("\nSpeed (%s resized, median of %d, %d threads), ms / provisional budget ms:\n",
+                images[0].first.c_str(), iterations, cv::getNumThreads());
+    for (int s = 0; s < 2; s++) {
+        cv::Mat frame;
+        cv::resize(images[0].second, frame, sizes[s], 0, 0, cv::INTER_AREA);
+        std::printf("  %-6s", sizeNames[s]);
+        for (DenoiseTier tier : tiers) {
+            Denoiser denoiser(configFor(tier));
+            double ms = timeTier(denoiser, frame, iterations);
+            double budget = denoiseBudgetMs(tier, sizes[s]);
+            bool over = ms > budget;
+            overBudget += over;
+            std::printf("  %s %7.2f / %-6.0f%s", denoiseTierName(tier), ms, budget, over ? " OVER" : "");
+        }
+        Denoiser reference(configFor(DenoiseTier::NlMeans));
+        std::printf("  nlm %8.2f\n", timeTier(reference, frame, std::max(1, iterations / 5)));
+    }
+
+    std::printf("\n%d tier / size combination(s) over budget on this machine\n", overBudget);
+    return 0;
+}
@@ -0,0 +1,175 @@
+// Checks the fused highlight-compression kernel against the original
+// at<uchar> loops from main4.cpp (hard curve + sharpen + blend) and
+// main3.cpp (soft curve), and reports throughput at 720p, 1080p and 4K on
+// one thread and on all cores.
+// Run from the build directory: ./bench_flash_reduce [iterations]
+
+#include <opencv2/opencv.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "flash_reduce.h"
+
+// **Reference: the main4.cpp Loops, Unchanged**
+static void referenceMain4(cv::Mat& L_plane) {
+    for (int y = 0; y < L_plane.rows; y++) {
+        for (int x = 0; x < L_plane.cols; x++) {
+            uchar& L = L_plane.at<uchar>(y, x);
+            if (L > 200) {  // If pixel is too bright
+                L = cv::saturate_cast<uchar>(L * 0.7);  // Reduce intensity by 30%
+            }
+        }
+    }
+
+    cv::Mat sharpened;
+    cv::Mat kernel = (cv::Mat_<float>(3,3) <<
+        0, -1,  0,
+       -1,  5, -1,
+        0, -1,  0);
+    cv::filter2D(L_plane, sharpened, -1, kernel);
+
+    for (int y = 0; y < L_plane.rows; y++) {
+        for (int x = 0; x < L_plane.cols; x++) {
+            uchar& L = L_plane.at<uchar>(y, x);
+            L = cv::saturate_cast<uchar>(0.6 * L + 0.4 * sharpened.at<uchar>(y, x));  // Blend
+        }
+    }
+}
+
+// **Reference: the main3.cpp Loop, Unchanged**
+static void referenceMain3(cv::Mat& L_plane) {
+    for (int y = 0; y < L_plane.rows; y++) {
+        for (int x = 0; x < L_plane.cols; x++) {
+            uchar& L = L_plane.at<uchar>(y, x);
+            if (L > 200) { // If pixel is too bright
+                float reduction_factor = 0.75 + 0.25 * ((255 - L) / 55.0); // Dynamic adjustment
+                L = cv::saturate_cast<uchar>(L * reduction_factor); // Reduce intensity smoothly
+            }
+        }
+    }
+}
+
+static FlashReduceParams main3Params() {
+    FlashReduceParams params;
+    params.threshold = 200;
+    params.reduction = 0.75;
+    params.softKnee = true;
+    params.sharpenWeight = 0;
+    return params;
+}
+
+static int countMismatches(const cv::Mat& a, const cv::Mat& b) {
+    cv::Mat diff;
+    cv::absdiff(a, b, diff);
+    return cv::countNonZero(diff);
+}
+
+// **Average Milliseconds per Call of fn on a Fresh Copy of the Plane**
+template <typename Fn>
+static double timeIt(const cv::Mat& plane, int iterations, Fn fn) {
+    cv::Mat work;
+    double total = 0;
+    for (int i = 0; i < iterations; i++) {
+        plane.copyTo(work);
+        cv::TickMeter tm;
+        tm.start();
+        fn(work);
+        tm.stop();
+        total += tm.getTimeMilli();
+    }
+    return total / iterations;
+}
+
+static bool checkExact(const std::string& name, const cv::Mat& plane) {
+    cv::Mat ref4 = plane.clone(), fused4 = plane.clone();
+    referenceMain4(ref4);
+    reduceFlashPlane(fused4);
+
+    cv::Mat ref3 = plane.clone(), fused3 = plane.clone();
+    referenceMain3(ref3);
+    reduceFlashPlane(fused3, main3Params());
+
+    // Also interleaved (channel 0 of a 2-channel image, as for YUYV)
+    cv::Mat pair, fusedPair;
+    cv::Mat planes[] = {plane, cv::Mat(plane.size(), CV_8UC1, cv::Scalar(128))};
+    cv::merge(planes, 2, pair);
+    uchar tone[256];
+    buildFlashToneCurve(FlashReduceParams(), tone);
+    compressHighlights(pair, pair, tone, 0.4);
+    cv::extractChannel(pair, fusedPair, 0);
+
+    int m4 = countMismatches(ref4, fused4);
+    int m3 = countMismatches(ref3, fused3);
+    int mp = countMismatches(ref4, fusedPair);
+    std::printf("  %-28s %5dx%-5d main4: %d  main3: %d  interleaved: %d mismatching pixels\n",
+                name.c_str(), plane.cols, plane.rows, m4, m3, mp);
+    return m4 == 0 && m3 == 0 && mp == 0;
+}
+
+int main(int argc, char** argv) {
+    int iterations = (argc > 1) ? std::atoi(argv[1]) : 10;
+    if (iterations <= 0) iterations = 10;
+
+    // **Inputs: Lab L of the Repository Images and Synthetic Planes**
+    std::vector<std::pair<std::string, cv::Mat>> inputs;
+    const char* images[] = {"../image.jpeg", "../image1.jpeg", "../image2.jpeg", "../image3.jpeg"};
+    for (const char* path : images) {
+        cv::Mat image = cv::imread(path, cv::IMREAD_COLOR);
+        if (image.empty()) {
+            std::fprintf(stderr, "Warning: Could not load %s, skipping\n", path);
+            continue;
+        }
+        cv::Mat lab, L;
+        cv::cvtColor(image, lab, cv::COLOR_BGR2Lab);
+        cv::extractChannel(lab, L, 0);
+        inputs.push_back({path, L});
+    }
+
+    const cv::Size sizes[] = {cv::Size(1280, 720), cv::Size(1920, 1080), cv::Size(3840, 2160)};
+    const char* sizeNames[] = {"synthetic 720p", "synthetic 1080p", "synthetic 4K"};
+    std::vector<cv::Mat> timed;  // The throughput table runs on these
+    for (int i = 0; i < 3; i++) {
+        cv::Mat plane(sizes[i], CV_8UC1);
+        cv::randu(plane, cv::Scalar(0), cv::Scalar(256));
+        inputs.push_back({sizeNames[i], plane});
+        timed.push_back(plane);
+    }
+
+    // Odd shapes exercise the border handling
+    cv::Mat tiny(3, 1, CV_8UC1);
+    cv::randu(tiny, cv::Scalar(180), cv::Scalar(256));
+    inputs.push_back({"synthetic 1x3", tiny});
+    cv::Mat strip(1, 17, CV_8UC1);
+    cv::randu(strip, cv::Scalar(180), cv::Scalar(256));
+    inputs.push_back({"synthetic 17x1", strip});
+
+    // **Bit-Exact Comparison**
+    std::printf("Bit-exact check against the original loops:\n");
+    bool exact = true;
+    for (const auto& input : inputs) exact = checkExact(input.first, input.second) && exact;
+
+    // **Throughput**
+    const int allThreads = cv::getNumThreads();
+    std::printf("\nThroughput (main4 chain, %d iterations):\n", iterations);
+    std::printf("  %-16s %12s %12s %12s %14s %14s\n", "input", "loops ms", "fused 1T ms",
+                "fused NT ms", "loops MPix/s", "fused MPix/s");
+    for (size_t i = 0; i < timed.size(); i++) {
+        const cv::Mat& plane = timed[i];
+        double mpix = plane.total() / 1e6;
+
+        double loops = timeIt(plane, iterations, [](cv::Mat& p) { referenceMain4(p); });
+        cv::setNumThreads(1);
+        double fused1 = timeIt(plane, iterations, [](cv::Mat& p) { reduceFlashPlane(p); });
+        cv::setNumThreads(allThreads);
+        double fusedN = timeIt(plane, iterations, [](cv::Mat& p) { reduceFlashPlane(p); });
+
+        std::printf("  %-16s %12.3f %12.3f %12.3f %14.1f %14.1f\n", sizeNames[i],
+                    loops, fused1, fusedN, mpix / (loops / 1000.0), mpix / (fusedN / 1000.0));
+    }
+    std::printf("  (NT = %d threads)\n", allThreads);
+
+    std::printf("\n%s\n", exact ? "PASS: fused kernel is bit-exact" : "FAIL: fused kernel differs");
+    return exact ? 0 : 1;
+}
@@ -0,0 +1,426 @@
+// Times every processing kernel of the repository on the same inputs.
+// Kernels: colour conversions, flash reduction, sharpen, CLAHE, NL-means
+// and the faster denoise tiers, temporal denoise, bilateral, gamma /
+// contrast LUTs, saturation boost, white balance, a chain of point ops
+// fused into one LUT and the same chain stage by stage, the frame statistics
+// estimators and the histogram cache. Inputs: ../image.jpeg ... ../image3.jpeg and synthetic 720p,
+// 1080p and 4K frames, each on one thread and on all cores.
+// Reported per kernel: median ms per frame, megapixels/s and bytes moved
+// (input read + output written, i.e. a lower bound on memory traffic).
+//
+// Run from the build directory:
+//   ./bench_kernels [--out results.json] [--compare baseline.json]
+//                   [--tolerance 0.10] [--iterations n] [--filter text] [--full]
+// Before timing, every point-op chain in kFusionChecks is run fused and
+// unfused on every input; the program exits with 1 if the outputs differ
+// in any pixel.
+// --compare exits with 1 if any kernel is slower than the baseline by more
+// than the tolerance. NL-means kernels are skipped above 1080p unless --full.
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "enhance_chain.h"
+#include "enhance_stages.h"
+#include "flash_reduce.h"
+#include "frame_stats.h"
+
+// One iteration of a kernel; returns the bytes it read and wrote
+using KernelRun = std::function<size_t()>;
+
+// **A Kernel: Builds Its Inputs / State for a Frame, Then Runs Repeatedly**
+struct Kernel {
+    std::string name;
+    bool heavy;  // Seconds per frame: one iteration, skipped above 1080p unless --full
+    std::function<KernelRun(const cv::Mat& bgr)> make;
+};
+
+struct BenchResult {
+    std::string kernel, input;
+    int width = 0, height = 0, threads = 0;
+    double ms = 0, mpps = 0, bytes = 0, gbps = 0;
+};
+
+static size_t bytesOf(const cv::Mat& m) {
+    return m.total() * m.elemSize();
+}
+
+// **Smooth Gradient with Sensor-Like Noise (as in bench_sampling)**
+static cv::Mat makeSyntheticFrame(cv::Size size) {
+    cv::Mat frame(size, CV_8UC3);
+    for (int y = 0; y < size.height; y++) {
+        cv::Vec3b* row = frame.ptr<cv::Vec3b>(y);
+        for (int x = 0; x < size.width; x++) {
+            row[x][0] = static_cast<uchar>(40 + 120 * x / size.width);
+            row[x][1] = static_cast<uchar>(60 + 100 * y / size.height);
+            row[x][2] = static_cast<uchar>(180 - 100 * x / size.width);
+        }
+    }
+    cv::Mat wide, noise(size, CV_16SC3);
+    frame.convertTo(wide, CV_16SC3);
+    cv::randn(noise, cv::Scalar::all(0), cv::Scalar::all(8));
+    cv::add(wide, noise, wide);
+    wide.convertTo(frame, CV_8UC3);
+    return frame;
+}
+
+// **Kernel Helpers**
+static Kernel conversion(const std::string& name, int code, int inputCode = -1) {
+    return {name, false, [code, inputCode](const cv::Mat& bgr) -> KernelRun {
+        auto in = std::make_shared<cv::Mat>(), out = std::make_shared<cv::Mat>();
+        if (inputCode >= 0) cv::cvtColor(bgr, *in, inputCode);
+        else *in = bgr;
+        return [in, out, code] {
+            cv::cvtColor(*in, *out, code);
+            return bytesOf(*in) + bytesOf(*out);
+        };
+    }};
+}
+
+// Native camera format to BGR; the content of the input does not matter
+static Kernel yuyvConversion() {
+    return {"cvt-yuyv2bgr", false, [](const cv::Mat& bgr) -> KernelRun {
+        auto in = std::make_shared<cv::Mat>(bgr.size(), CV_8UC2), out = std::make_shared<cv::Mat>();
+        cv::randu(*in, cv::Scalar::all(0), cv::Scalar::all(256));
+        return [in, out] {
+            cv::cvtColor(*in, *out, cv::COLOR_YUV2BGR_YUYV);
+            return bytesOf(*in) + bytesOf(*out);
+        };
+    }};
+}
+
+static Kernel stage(const std::string& name, const std::vector<double>& args = std::vector<double>(),
+                    bool heavy = false) {
+    return {name, heavy, [name, args](const cv::Mat& bgr) -> KernelRun {
+        std::shared_ptr<EnhanceStage> s(createEnhanceStage(name, args).release());
+        if (!s) return KernelRun();
+        s->prepare(bgr.size(), bgr.type());
+        auto out = std::make_shared<cv::Mat>();
+        cv::Mat in = bgr;
+        return [s, in, out] {
+            s->process(in, *out);
+            return bytesOf(in) + bytesOf(*out);
+        };
+    }};
+}
+
+// Chains of point ops; the fused LUT must reproduce them stage by stage
+const char* const kFusionChecks[] = {
+    "gamma:0.8,contrast:1.2:-10",
+    "darken:30,gamma:0.5,contrast:1.5:20",
+    "wb-gray,gamma:0.8,contrast:1.2:-10",
+    "wb-pct:0.98,darken:20",
+    "wb:4500,contrast:0.9:5,gamma:1.4",
+};
+
+static bool buildChain(const std::string& spec, bool fuse, cv::Size size, EnhanceChain& chain) {
+    EnhanceChainBuilder builder;
+    builder.fusePointOps(fuse);
+    return builder.parse(spec) && builder.build(size, CV_8UC3, chain);
+}
+
+static Kernel chain(const std::string& name, const std::string& spec, bool fuse) {
+    return {name, false, [spec, fuse](const cv::Mat& bgr) -> KernelRun {
+        auto c = std::make_shared<EnhanceChain>();
+        if (!buildChain(spec, fuse, bgr.size(), *c)) return KernelRun();
+        auto out = std::make_shared<cv::Mat>();
+        cv::Mat in = bgr;
+        return [c, in, out] {
+            c->run(in, *out);
+            return bytesOf(in) + bytesOf(*out);
+        };
+    }};
+}
+
+// **Fused Point Ops Against the Same Stages Run One by One**
+static bool checkFusion(const std::string& input, const cv::Mat& frame) {
+    bool exact = true;
+    for (const char* spec : kFusionChecks) {
+        EnhanceChain fused, unfused;
+        if (!buildChain(spec, true, frame.size(), fused) || !buildChain(spec, false, frame.size(), unfused)) {
+            std::fprintf(stderr, "Error: Cannot build chain %s\n", spec);
+            return false;
+        }
+        cv::Mat a, b, diff;
+        fused.run(frame, a);
+        unfused.run(frame, b);
+        cv::absdiff(a, b, diff);
+        int mismatches = cv::countNonZero(diff.reshape(1));
+        if (mismatches > 0) {
+            std::printf("  MISMATCH  %-18s %-38s %d values differ\n", input.c_str(), spec, mismatches);
+            exact = false;
+        }
+    }
+    return exact;
+}
+
+static Kernel statistics(const std::string& name, const SamplingConfig& config) {
+    return {name, false, [config](const cv::Mat& bgr) -> KernelRun {
+        cv::Mat in = bgr;
+        if (config.mode == SamplingConfig::Full) {
+            return [in] {
+                volatile double sink = computeFrameStats(in).brightness();
+                (void)sink;
+                return bytesOf(in);
+            };
+        }
+        return [in, config] {
+            SampledFrameStats s = computeFrameStats(in, config);
+            return s.samples * in.elemSize();
+        };
+    }};
+}
+
+// **Histogram Cache; Every Run Is a New Frame Id, So Pixels Are Read**
+static Kernel histograms(const std::string& name, int stride) {
+    return {name, false, [stride](const cv::Mat& bgr) -> KernelRun {
+        cv::Mat in = bgr;
+        auto analyzer = std::make_shared<FrameAnalyzer>();
+        auto frameId = std::make_shared<uint64_t>(0);
+        return [in, stride, analyzer, frameId] {
+            const FrameHistograms& h = analyzer->analyze(in, ++*frameId, stride);
+            return static_cast<size_t>(h.pixels) * in.elemSize();
+        };
+    }};
+}
+
+static std::vector<Kernel> allKernels() {
+    std::vector<Kernel> kernels = {
+        conversion("cvt-bgr2gray", cv::COLOR_BGR2GRAY),
+        conversion("cvt-bgr2lab", cv::COLOR_BGR2Lab),
+        conversion("cvt-lab2bgr", cv::COLOR_Lab2BGR, cv::COLOR_BGR2Lab),
+        conversion("cvt-bgr2hsv", cv::COLOR_BGR2HSV),
+        yuyvConversion(),
+        {"flash-plane", false, [](const cv::Mat& bgr) -> KernelRun {
+            auto plane = std::make_shared<cv::Mat>(), out = std::make_shared<cv::Mat>();
+            cv::cvtColor(bgr, *plane, cv::COLOR_BGR2GRAY);
+            auto tone = std::make_shared<std::vector<uchar>>(256);
+            buildFlashToneCurve(FlashReduceParams(), tone->data());
+            return [plane, out, tone] {
+                compressHighlights(*plane, *out, tone->data(), 0.4);
+                return bytesOf(*plane) + bytesOf(*out);
+            };
+        }},
+        stage("flash"),
+        stage("sharpen"),
+        stage("clahe"),
+        stage("clahe-rgb", {5}),
+        stage("denoise", {3, 3}, true),
+        stage("denoise-nlm-fast", {3, 3}, true),
+        stage("denoise-bilateral", {3, 3}),
+        stage("denoise-guided", {3}),
+        stage("temporal"),
+        stage("bilateral"),
+        stage("gamma"),
+        stage("contrast"),
+        stage("saturation"),
+        stage("wb"),
+        stage("wb-gray"),
+        stage("wb-pct"),
+        chain("points-fused", kFusionChecks[2], true),
+        chain("points-unfused", kFusionChecks[2], false),
+        statistics("stats-full", SamplingConfig()),
+        statistics("stats-grid4", SamplingConfig::grid(4)),
+        statistics("stats-grid8", SamplingConfig::grid(8)),
+        statistics("stats-random4", SamplingConfig::random(4)),
+        histograms("histograms-full", 1),
+        histograms("histograms-grid4", 4),
+    };
+    return kernels;
+}
+
+// **Median ms of One Kernel on One Frame**
+static bool runKernel(const Kernel& kernel, const cv::Mat& frame, int iterations, BenchResult& r) {
+    KernelRun run = kernel.make(frame);
+    if (!run) return false;
+
+    size_t bytes = run();  // Warm-up: buffers sized, caches primed
+    std::vector<double> ms;
+    for (int i = 0; i < (kernel.heavy ? 1 : iterations); i++) {
+        cv::TickMeter tm;
+        tm.start();
+        bytes = run();
+        tm.stop();
+        ms.push_back(tm.getTimeMilli());
+    }
+    std::sort(ms.begin(), ms.end());
+
+    // A kernel faster than the timer's resolution reads 0 ms; report no rate
+    r.ms = ms[ms.size() / 2];
+    r.bytes = static_cast<double>(bytes);
+    r.mpps = r.ms > 0 ? frame.total() / 1e6 / (r.ms / 1000.0) : 0;
+    r.gbps = r.ms > 0 ? r.bytes / 1e9 / (r.ms / 1000.0) : 0;
+    return true;
+}
+
+// **JSON Results**
+static bool writeResults(const std::string& path, const std::vector<BenchResult>& results, int iterations) {
+    cv::FileStorage fs(path, cv::FileStorage::WRITE);
+    if (!fs.isOpened()) {
+        std::fprintf(stderr, "Error: Cannot write %s\n", path.c_str());
+        return false;
+    }
+    fs << "iterations" << iterations;
+    fs << "cores" << cv::getNumberOfCPUs();
+    fs << "results" << "[";
+    for (const auto& r : results) {
+        fs << "{" << "kernel" << r.kernel << "input" << r.input
+           << "width" << r.width << "height" << r.height << "threads" << r.threads
+           << "ms" << r.ms << "mpps" << r.mpps << "bytes" << r.bytes << "gbps" << r.gbps << "}";
+    }
+    fs << "]";
+    fs.release();
+    return true;
+}
+
+static std::string resultKey(const std::string& kernel, const std::string& input, int threads) {
+    return kernel + "|" + input + "|" + (threads == 1 ? "1" : "N");
+}
+
+static bool readBaseline(const std::string& path, std::map<std::string, double>& baseline) {
+    cv::FileStorage fs(path, cv::FileStorage::READ);
+    if (!fs.isOpened()) {
+        std::fprintf(stderr, "Error: Cannot read baseline %s\n", path.c_str());
+        return false;
+    }
+    cv::FileNode results = fs["results"];
+    for (cv::FileNodeIterator it = results.begin(); it != results.end(); ++it) {
+        cv::FileNode n = *it;
+        baseline[resultKey(n["kernel"], n["input"], static_cast<int>(n["threads"]))] = static_cast<double>(n["ms"]);
+    }
+    return true;
+}
+
+// **Flag Kernels Slower Than the Baseline by More Than the Tolerance**
+// Differences under 0.05 ms are timer noise and never count. Baseline
+// entries this run did not produce (a kernel removed or renamed, an input
+// missing) are listed, since they are not being checked any more; with
+// --filter, only those of the kernels it selects.
+static int compareResults(const std::vector<BenchResult>& results, const std::map<std::string, double>& baseline,
+                          double tolerance, const std::string& filter) {
+    int regressions = 0, improvements = 0, missing = 0;
+    std::set<std::string> seen;
+    std::printf("\nComparison against the baseline (tolerance %.0f%%):\n", tolerance * 100);
+    for (const auto& r : results) {
+        auto it = baseline.find(resultKey(r.kernel, r.input, r.threads));
+        if (it == baseline.end()) {
+            missing++;
+            continue;
+        }
+        seen.insert(it->first);
+        if (it->second <= 0) continue;  // Below the timer's resolution in the baseline
+        double change = r.ms / it->second - 1.0;
+        bool significant = std::abs(r.ms - it->second) > 0.05;
+        if (significant && change > tolerance) {
+            regressions++;
+            std::printf("  REGRESSION  %-18s %-18s %2dT  %9.3f -> %9.3f ms (%+.0f%%)\n", r.kernel.c_str(),
+                        r.input.c_str(), r.threads, it->second, r.ms, change * 100);
+        } else if (significant && change < -tolerance) {
+            improvements++;
+            std::printf("  faster      %-18s %-18s %2dT  %9.3f -> %9.3f ms (%+.0f%%)\n", r.kernel.c_str(),
+                        r.input.c_str(), r.threads, it->second, r.ms, change * 100);
+        }
+    }
+    int dropped = 0;
+    for (const auto& entry : baseline) {
+        const std::string kernel = entry.first.substr(0, entry.first.find('|'));
+        if (seen.count(entry.first) || kernel.find(filter) == std::string::npos) continue;
+        dropped++;
+        std::printf("  NOT RUN     %-44s %9.3f ms in the baseline\n", entry.first.c_str(), entry.second);
+    }
+    std::printf("  %d regression(s), %d improvement(s), %d result(s) not in the baseline, "
+                "%d baseline result(s) not run\n", regressions, improvements, missing, dropped);
+    return regressions;
+}
+
+int main(int argc, char** argv) {
+    std::string outPath = "bench_kernels.json", comparePath, filter;
+    double tolerance = 0.10;
+    int iterations = 10;
+    bool full = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--out" && hasValue) outPath = argv[++i];
+        else if (arg == "--compare" && hasValue) comparePath = argv[++i];
+        else if (arg == "--tolerance" && hasValue) tolerance = std::atof(argv[++i]);
+        else if (arg == "--iterations" && hasValue) iterations = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--filter" && hasValue) filter = argv[++i];
+        else if (arg == "--full") full = true;
+        else {
+            std::fprintf(stderr, "Usage: bench_kernels [--out results.json] [--compare baseline.json]\n"
+                                 "                     [--tolerance 0.10] [--iterations n] [--filter text] [--full]\n");
+            return 2;
+        }
+    }
+
+    std::map<std::string, double> baseline;
+    if (!comparePath.empty() && !readBaseline(comparePath, baseline)) return 2;
+
+    // **Inputs: the Repository Images and Synthetic Frames**
+    std::vector<std::pair<std::string, cv::Mat>> inputs;
+    const char* images[] = {"image.jpeg", "image1.jpeg", "image2.jpeg", "image3.jpeg"};
+    for (const char* name : images) {
+        cv::Mat image = cv::imread(std::string("../") + name, cv::IMREAD_COLOR);
+        if (image.empty()) {
+            std::fprintf(stderr, "Warning: Could not load ../%s, skipping\n", name);
+            continue;
+        }
+        inputs.push_back({name, image});
+    }
+    inputs.push_back({"synthetic-720p", makeSyntheticFrame(cv::Size(1280, 720))});
+    inputs.push_back({"synthetic-1080p", makeSyntheticFrame(cv::Size(1920, 1080))});
+    inputs.push_back({"synthetic-4k", makeSyntheticFrame(cv::Size(3840, 2160))});
+
+    // **Fused LUTs Must Match the Stages They Replace**
+    bool fusionExact = true;
+    for (const auto& input : inputs) fusionExact = checkFusion(input.first, input.second) && fusionExact;
+    std::printf("Point-op fusion: %s\n\n", fusionExact ? "bit-exact on every input" : "FAILED");
+
+    // **Run Every Kernel on Every Input, on One Thread and on All Cores**
+    const std::vector<Kernel> kernels = allKernels();
+    const int allThreads = cv::getNumThreads();
+    const int threadCounts[] = {1, allThreads};
+    std::vector<BenchResult> results;
+
+    std::printf("%-18s %-18s %11s %4s %10s %9s %10s %8s\n", "kernel", "input", "size", "thr",
+                "ms/frame", "MP/s", "MB/frame", "GB/s");
+    for (const auto& input : inputs) {
+        const cv::Mat& frame = input.second;
+        for (int t = 0; t < (allThreads > 1 ? 2 : 1); t++) {
+            cv::setNumThreads(threadCounts[t]);
+            for (const auto& kernel : kernels) {
+                if (!filter.empty() && kernel.name.find(filter) == std::string::npos) continue;
+                if (kernel.heavy && !full && frame.total() > 1920u * 1080u) continue;
+
+                BenchResult r;
+                r.kernel = kernel.name;
+                r.input = input.first;
+                r.width = frame.cols;
+                r.height = frame.rows;
+                r.threads = threadCounts[t];
+                if (!runKernel(kernel, frame, iterations, r)) continue;
+                results.push_back(r);
+
+                std::printf("%-18s %-18s %5dx%-5d %4d %10.3f %9.1f %10.2f %8.2f\n", r.kernel.c_str(),
+                            r.input.c_str(), r.width, r.height, r.threads, r.ms, r.mpps, r.bytes / 1e6, r.gbps);
+            }
+        }
+    }
+    cv::setNumThreads(allThreads);
+
+    if (!writeResults(outPath, results, iterations)) return 2;
+    std::printf("\nResults written to %s\n", outPath.c_str());
+
+    int regressions = comparePath.empty() ? 0 : compareResults(results, baseline, tolerance, filter);
+    return regressions > 0 || !fusionExact ? 1 : 0;
+}
@@ -0,0 +1,123 @@
+// Compares sampled frame statistics against the exact full-frame values.
+// Runs on ../image.jpeg ... ../image3.jpeg and on synthetic 720p/1080p/4K
+// frames, and prints for each sampling mode the time per frame, the observed
+// error and the error the sampler itself predicted.
+// Run from the build directory: ./bench_sampling [iterations]
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "frame_stats.h"
+
+// **Colour Temperature Formula Used by main.cpp (Kelvin, Rounded)**
+static double kelvinFromRatio(double ratio) {
+    return std::round(kelvinFromRedBlueRatio(ratio));
+}
+
+// **Smooth Gradient with Sensor-Like Noise and a Few Solid Colour Patches**
+static cv::Mat makeSyntheticFrame(cv::Size size, unsigned seed) {
+    cv::Mat frame(size, CV_8UC3);
+    for (int y = 0; y < size.height; y++) {
+        cv::Vec3b* row = frame.ptr<cv::Vec3b>(y);
+        for (int x = 0; x < size.width; x++) {
+            row[x][0] = static_cast<uchar>(40 + 120 * x / size.width);
+            row[x][1] = static_cast<uchar>(60 + 100 * y / size.height);
+            row[x][2] = static_cast<uchar>(180 - 100 * x / size.width);
+        }
+    }
+
+    cv::RNG rng(seed);
+    for (int i = 0; i < 12; i++) {
+        cv::Point centre(rng.uniform(0, size.width), rng.uniform(0, size.height));
+        cv::Scalar colour(rng.uniform(0, 256), rng.uniform(0, 256), rng.uniform(0, 256));
+        cv::circle(frame, centre, size.height / 12, colour, -1);
+    }
+
+    cv::Mat wide, noise(size, CV_16SC3);
+    frame.convertTo(wide, CV_16SC3);
+    cv::randn(noise, cv::Scalar::all(0), cv::Scalar::all(8));
+    cv::add(wide, noise, wide);
+    wide.convertTo(frame, CV_8UC3);  // Saturates back to 0-255
+    return frame;
+}
+
+struct Result {
+    double ms;
+    SampledFrameStats sampled;
+};
+
+static Result runSampled(const cv::Mat& frame, const SamplingConfig& config, int iterations) {
+    Result r;
+    cv::TickMeter tm;
+    tm.start();
+    for (int i = 0; i < iterations; i++) r.sampled = computeFrameStats(frame, config);
+    tm.stop();
+    r.ms = tm.getTimeMilli() / iterations;
+    return r;
+}
+
+static void report(const std::string& name, const cv::Mat& frame, int iterations) {
+    Result exact = runSampled(frame, SamplingConfig(), iterations);
+    const FrameStats& e = exact.sampled.stats;
+
+    std::printf("\n%s (%dx%d)\n", name.c_str(), frame.cols, frame.rows);
+    std::printf("  %-10s %8s %9s | %-22s | %-22s | %-22s | %-22s | %s\n", "mode", "ms", "speedup",
+                "R/B ratio err (pred)", "luma err (pred)", "contrast err (pred)", "sat err (pred)",
+                "kelvin diff");
+    std::printf("  %-10s %8.3f %9s |\n", "full", exact.ms, "1.0x");
+
+    struct Mode { const char* label; SamplingConfig config; };
+    std::vector<Mode> modes = {
+        {"grid/16", SamplingConfig::grid(4)},
+        {"grid/64", SamplingConfig::grid(8)},
+        {"random/16", SamplingConfig::random(4)},
+        {"random/64", SamplingConfig::random(8)},
+    };
+
+    for (const Mode& m : modes) {
+        Result r = runSampled(frame, m.config, iterations);
+        const SampledFrameStats& s = r.sampled;
+        double ratioErr = std::abs(s.stats.redBlueRatio() - e.redBlueRatio());
+        double lumaErr = std::abs(s.stats.lumaMean - e.lumaMean);
+        double contrastErr = std::abs(s.stats.contrast() - e.contrast());
+        double satErr = std::abs(s.stats.saturation() - e.saturation());
+        double kelvinDiff = kelvinFromRatio(s.stats.redBlueRatio()) - kelvinFromRatio(e.redBlueRatio());
+
+        std::printf("  %-10s %8.3f %8.1fx | %9.5f (%9.5f) | %9.4f (%9.4f) | %9.4f (%9.4f) | %9.4f (%9.4f) | %+.0fK\n",
+                    m.label, r.ms, exact.ms / r.ms,
+                    ratioErr, s.redBlueRatioError, lumaErr, s.lumaMeanError,
+                    contrastErr, s.contrastError, satErr, s.saturationError, kelvinDiff);
+    }
+}
+
+int main(int argc, char** argv) {
+    int iterations = (argc > 1) ? std::atoi(argv[1]) : 20;
+    if (iterations <= 0) iterations = 20;
+
+    // **Repository Images**
+    const char* images[] = {"../image.jpeg", "../image1.jpeg", "../image2.jpeg", "../image3.jpeg"};
+    for (const char* path : images) {
+        cv::Mat image = cv::imread(path, cv::IMREAD_COLOR);
+        if (image.empty()) {
+            std::fprintf(stderr, "Warning: Could not load %s, skipping\n", path);
+            continue;
+        }
+        report(path, image, iterations);
+    }
+
+    // **Synthetic Frames**
+    const cv::Size sizes[] = {cv::Size(1280, 720), cv::Size(1920, 1080), cv::Size(3840, 2160)};
+    unsigned seed = 1;
+    for (const cv::Size& size : sizes) {
+        report("synthetic", makeSyntheticFrame(size, seed++), iterations);
+    }
+
+    std::printf("\nErrors are absolute differences from the full-frame value; (pred) is the\n"
+                "one-sigma error the sampler reported. Kelvin diff uses main.cpp's formula.\n");
+    return 0;
+}
@@ -0,0 +1,264 @@
+#include "camera_control.h"
+
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include "async_log.h"
+
+// **ioctl That Retries When Interrupted by a Signal**
+static int xioctl(int fd, unsigned long request, void* arg) {
+    int r;
+    do {
+        r = ioctl(fd, request, arg);
+    } while (r == -1 && errno == EINTR);
+    return r;
+}
+
+V4L2ControlDevice::V4L2ControlDevice(const std::string& path)
+    : path_(path), fd_(-1), extControlsSupported_(true) {
+    fd_ = open(path_.c_str(), O_RDWR);
+    if (fd_ < 0) {
+        std::cerr << "Error: Cannot open " << path_ << ": " << std::strerror(errno) << "\n";
+    }
+}
+
+V4L2ControlDevice::~V4L2ControlDevice() {
+    if (fd_ >= 0) close(fd_);
+}
+
+bool V4L2ControlDevice::getControl(uint32_t id, int32_t& value) {
+    if (fd_ < 0) return false;
+
+    struct v4l2_control ctrl;
+    std::memset(&ctrl, 0, sizeof(ctrl));
+    ctrl.id = id;
+    if (xioctl(fd_, VIDIOC_G_CTRL, &ctrl) == -1) {
+        std::cerr << "Error: VIDIOC_G_CTRL failed for control 0x" << std::hex << id << std::dec
+                  << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+    value = ctrl.value;
+    return true;
+}
+
+bool V4L2ControlDevice::setControl(uint32_t id, int32_t value) {
+    if (fd_ < 0) return false;
+
+    struct v4l2_control ctrl;
+    std::memset(&ctrl, 0, sizeof(ctrl));
+    ctrl.id = id;
+    ctrl.value = value;
+    if (xioctl(fd_, VIDIOC_S_CTRL, &ctrl) == -1) {
+        std::cerr << "Error: VIDIOC_S_CTRL failed for control 0x" << std::hex << id << std::dec
+                  << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool V4L2ControlDevice::queryControl(uint32_t id, ControlRange& range) {
+    if (fd_ < 0) return false;
+
+    struct v4l2_queryctrl query;
+    std::memset(&query, 0, sizeof(query));
+    query.id = id;
+    if (xioctl(fd_, VIDIOC_QUERYCTRL, &query) == -1 || (query.flags & V4L2_CTRL_FLAG_DISABLED)) {
+        return false;  // Not every camera has every control; not an error
+    }
+    range = {query.minimum, query.maximum, query.step > 0 ? query.step : 1, query.default_value};
+    return true;
+}
+
+bool V4L2ControlDevice::setControls(const std::vector<ControlValue>& controls) {
+    if (fd_ < 0) return false;
+    if (controls.empty()) return true;
+
+    if (extControlsSupported_) {
+        std::vector<struct v4l2_ext_control> ext(controls.size());
+        for (size_t i = 0; i < controls.size(); i++) {
+            std::memset(&ext[i], 0, sizeof(ext[i]));
+            ext[i].id = controls[i].id;
+            ext[i].value = controls[i].value;
+        }
+
+        struct v4l2_ext_controls batch;
+        std::memset(&batch, 0, sizeof(batch));
+#ifdef V4L2_CTRL_WHICH_CUR_VAL
+        batch.which = V4L2_CTRL_WHICH_CUR_VAL;
+#else
+        batch.ctrl_class = 0;  // Any class, on headers that predate 'which'
+#endif
+        batch.count = static_cast<uint32_t>(ext.size());
+        batch.controls = ext.data();
+
+        if (xioctl(fd_, VIDIOC_S_EXT_CTRLS, &batch) == 0) return true;
+
+        // Drivers without extended controls report ENOTTY; remember that and
+        // use S_CTRL from now on. Any other error (e.g. white balance
+        // temperature while auto WB is enabled) rejects the whole batch, so
+        // fall through and still apply the controls that are writable.
+        if (errno == ENOTTY) {
+            extControlsSupported_ = false;
+        }
+    }
+
+    bool ok = true;
+    for (const ControlValue& c : controls) {
+        ok = setControl(c.id, c.value) && ok;
+    }
+    return ok;
+}
+
+FakeControlDevice::FakeControlDevice() : writeCount_(0), batchCount_(0) {
+    values_[V4L2_CID_BRIGHTNESS] = 0;
+    values_[V4L2_CID_CONTRAST] = 0;
+    values_[V4L2_CID_SATURATION] = 0;
+    values_[V4L2_CID_WHITE_BALANCE_TEMPERATURE] = 4500;
+}
+
+bool FakeControlDevice::getControl(uint32_t id, int32_t& value) {
+    std::map<uint32_t, int32_t>::const_iterator it = values_.find(id);
+    if (it == values_.end()) return false;
+    value = it->second;
+    return true;
+}
+
+bool FakeControlDevice::setControl(uint32_t id, int32_t value) {
+    if (values_.find(id) == values_.end()) return false;
+    store(id, value);
+    writeCount_++;
+    return true;
+}
+
+FakeControlStats FakeControlDevice::controlStats(uint32_t id) const {
+    std::map<uint32_t, FakeControlStats>::const_iterator it = stats_.find(id);
+    return it != stats_.end() ? it->second : FakeControlStats();
+}
+
+// **Clamp, Then Round to the Step, as v4l2-ctrls Does for Integer Controls**
+void FakeControlDevice::store(uint32_t id, int32_t value) {
+    int32_t stored = value;
+    std::map<uint32_t, ControlRange>::const_iterator it = ranges_.find(id);
+    if (it != ranges_.end()) {
+        const ControlRange& range = it->second;
+        const int64_t step = std::max(1, range.step);
+        int64_t offset = static_cast<int64_t>(std::max(range.minimum, std::min(range.maximum, value))) - range.minimum;
+        offset = (offset + step / 2) / step * step;
+        stored = static_cast<int32_t>(range.minimum + offset);
+    }
+    values_[id] = stored;
+
+    FakeControlStats& stats = stats_[id];
+    stats.writes++;
+    if (stored != value) stats.adjusted++;
+}
+
+bool FakeControlDevice::queryControl(uint32_t id, ControlRange& range) {
+    std::map<uint32_t, int32_t>::const_iterator value = values_.find(id);
+    if (value == values_.end()) return false;
+    std::map<uint32_t, ControlRange>::const_iterator it = ranges_.find(id);
+    range = it != ranges_.end() ? it->second : ControlRange{INT32_MIN, INT32_MAX, 1, value->second};
+    return true;
+}
+
+bool FakeControlDevice::setControls(const std::vector<ControlValue>& controls) {
+    // Validate first so the batch is all-or-nothing, like S_EXT_CTRLS.
+    for (const ControlValue& c : controls) {
+        if (values_.find(c.id) == values_.end()) return false;
+    }
+    for (const ControlValue& c : controls) {
+        store(c.id, c.value);
+    }
+    writeCount_ += static_cast<int>(controls.size());
+    batchCount_++;
+    return true;
+}
+
+uint32_t controlIdFromName(const std::string& setting_name) {
+    if (setting_name == "brightness") return V4L2_CID_BRIGHTNESS;
+    if (setting_name == "contrast") return V4L2_CID_CONTRAST;
+    if (setting_name == "saturation") return V4L2_CID_SATURATION;
+    if (setting_name == "white_balance_temperature") return V4L2_CID_WHITE_BALANCE_TEMPERATURE;
+    if (setting_name == "white_balance_automatic" || setting_name == "white_balance_temperature_auto")
+        return V4L2_CID_AUTO_WHITE_BALANCE;
+    return 0;
+}
+
+CameraControls::CameraControls(CameraControlDevice& device)
+    : device_(device), last_{INT_MIN, INT_MIN, INT_MIN, INT_MIN} {}
+
+int CameraControls::get(const std::string& setting_name) {
+    uint32_t id = controlIdFromName(setting_name);
+    if (id == 0) {
+        std::cerr << "Error: Unknown camera control " << setting_name << "\n";
+        return -1;
+    }
+
+    int32_t value = 0;
+    if (!device_.getControl(id, value)) {
+        std::cerr << "Error: Could not read " << setting_name << "\n";
+        return -1;
+    }
+    return value;
+}
+
+bool CameraControls::query(const std::string& setting_name, ControlRange& range) {
+    uint32_t id = controlIdFromName(setting_name);
+    return id != 0 && device_.queryControl(id, range);
+}
+
+ControlWrite CameraControls::apply(const CameraSettings& settings) {
+    if (settings == last_) {
+        return ControlWrite::Unchanged;  // Skip if no changes
+    }
+
+    // Only changed controls go into the batch.
+    std::vector<ControlValue> batch;
+    batch.reserve(4);
+    if (settings.brightness != last_.brightness)
+        batch.push_back({V4L2_CID_BRIGHTNESS, settings.brightness});
+    if (settings.contrast != last_.contrast)
+        batch.push_back({V4L2_CID_CONTRAST, settings.contrast});
+    if (settings.saturation != last_.saturation)
+        batch.push_back({V4L2_CID_SATURATION, settings.saturation});
+    if (settings.whiteBalance != last_.whiteBalance)
+        batch.push_back({V4L2_CID_WHITE_BALANCE_TEMPERATURE, settings.whiteBalance});
+
+    bool ok = device_.setControls(batch);
+
+    // Remember the request even on partial failure, like the old v4l2-ctl
+    // path did, so a control the driver refuses is not retried every frame.
+    last_ = settings;
+    return ok ? ControlWrite::Written : ControlWrite::Failed;
+}
+
+ControlWrite CameraControls::applyWhiteBalance(int wb_value) {
+    if (wb_value == last_.whiteBalance) return ControlWrite::Unchanged;
+
+    bool ok = device_.setControl(V4L2_CID_WHITE_BALANCE_TEMPERATURE, wb_value);
+    last_.whiteBalance = wb_value;
+    return ok ? ControlWrite::Written : ControlWrite::Failed;
+}
+
+ControlWrite setCameraSettings(CameraControls& controls, int brightness, int contrast, int saturation, int wb_value) {
+    ControlWrite result = controls.apply({brightness, contrast, saturation, wb_value});
+    if (result != ControlWrite::Written) {
+        return result;  // Nothing changed, or the device reported the failure
+    }
+
+    // Logged off the frame loop; a WB ramp changes the settings every frame
+    static LogChannel settingsLog(5.0);
+    char line[128];
+    std::snprintf(line, sizeof(line), "Updated Settings -> Brightness: %d, Contrast: %d, Saturation: %d, White Balance: %dK",
+                  brightness, contrast, saturation, wb_value);
+    settingsLog.log(line);
+    return result;
+}
@@ -0,0 +1,174 @@
+// Camera control backend.
+// Opens the V4L2 device once and talks to it with ioctls instead of forking
+// v4l2-ctl for every read and write. The CameraControlDevice interface is also
+// implemented by an in-memory FakeControlDevice so the control path can be
+// exercised and timed without a camera attached.
+#pragma once
+
+#include <linux/videodev2.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// **One Control Write (id is a V4L2_CID_* value)**
+struct ControlValue {
+    uint32_t id;
+    int32_t value;
+};
+
+// **Range a Control Accepts (VIDIOC_QUERYCTRL)**
+struct ControlRange {
+    int32_t minimum;
+    int32_t maximum;
+    int32_t step;
+    int32_t defaultValue;
+};
+
+// **Abstract Camera Control Device**
+class CameraControlDevice {
+public:
+    virtual ~CameraControlDevice() = default;
+
+    virtual bool isOpen() const = 0;
+    virtual bool getControl(uint32_t id, int32_t& value) = 0;
+    virtual bool setControl(uint32_t id, int32_t value) = 0;
+
+    // Minimum, maximum and step the driver accepts for a control.
+    virtual bool queryControl(uint32_t id, ControlRange& range) = 0;
+
+    // Applies every control in one batch. Returns false if any write failed.
+    virtual bool setControls(const std::vector<ControlValue>& controls) = 0;
+};
+
+// **V4L2 Device Controlled Through VIDIOC_G_CTRL / S_CTRL / S_EXT_CTRLS**
+class V4L2ControlDevice : public CameraControlDevice {
+public:
+    explicit V4L2ControlDevice(const std::string& path = "/dev/video0");
+    ~V4L2ControlDevice() override;
+
+    V4L2ControlDevice(const V4L2ControlDevice&) = delete;
+    V4L2ControlDevice& operator=(const V4L2ControlDevice&) = delete;
+
+    bool isOpen() const override { return fd_ >= 0; }
+    bool getControl(uint32_t id, int32_t& value) override;
+    bool setControl(uint32_t id, int32_t value) override;
+    bool queryControl(uint32_t id, ControlRange& range) override;
+    bool setControls(const std::vector<ControlValue>& controls) override;
+
+    const std::string& path() const { return path_; }
+
+private:
+    std::string path_;
+    int fd_;
+    bool extControlsSupported_;
+};
+
+// **Writes to One Control of a FakeControlDevice**
+struct FakeControlStats {
+    int writes = 0;
+    int adjusted = 0;  // Clamped to the range or rounded to the step
+};
+
+// **In-Memory Device for Tests and Benchmarks**
+// Like a V4L2 driver for integer controls, a write outside the registered
+// range is clamped and one off the step is rounded to it, rather than
+// stored as given. Every such write is counted, so a test can catch a
+// caller that ignores the range.
+class FakeControlDevice : public CameraControlDevice {
+public:
+    FakeControlDevice();
+
+    bool isOpen() const override { return true; }
+    bool getControl(uint32_t id, int32_t& value) override;
+    bool setControl(uint32_t id, int32_t value) override;
+    bool queryControl(uint32_t id, ControlRange& range) override;
+    bool setControls(const std::vector<ControlValue>& controls) override;
+
+    // Registers a control with an initial value (writes to ids never added
+    // fail). Without a range, any value is stored as given.
+    void addControl(uint32_t id, int32_t value) { values_[id] = value; }
+    void addControl(uint32_t id, int32_t value, const ControlRange& range) {
+        values_[id] = value;
+        ranges_[id] = range;
+    }
+
+    // Controls written, whether one at a time or in a batch
+    int writeCount() const { return writeCount_; }
+    // setControls() calls that were applied
+    int batchCount() const { return batchCount_; }
+    // Writes to one control (zero counts for one never written)
+    FakeControlStats controlStats(uint32_t id) const;
+
+private:
+    // Stores value as the driver would, and counts the write
+    void store(uint32_t id, int32_t value);
+
+    std::map<uint32_t, int32_t> values_;
+    std::map<uint32_t, ControlRange> ranges_;
+    std::map<uint32_t, FakeControlStats> stats_;
+    int writeCount_;
+    int batchCount_;
+};
+
+// **Brightness / Contrast / Saturation / White Balance Written Together**
+struct CameraSettings {
+    int brightness;
+    int contrast;
+    int saturation;
+    int whiteBalance;
+
+    bool operator==(const CameraSettings& other) const {
+        return brightness == other.brightness && contrast == other.contrast &&
+               saturation == other.saturation && whiteBalance == other.whiteBalance;
+    }
+    bool operator!=(const CameraSettings& other) const { return !(*this == other); }
+};
+
+// **Outcome of a Settings Write**
+// "Nothing changed" is not a failure: callers that count failures or wait
+// for the device to settle must tell the two apart.
+enum class ControlWrite {
+    Unchanged,  // Same as the last write; the device was not touched
+    Written,
+    Failed,
+};
+
+// **Map a v4l2-ctl Control Name ("brightness", ...) to its V4L2_CID_* Id**
+// Returns 0 for names that are not known.
+uint32_t controlIdFromName(const std::string& setting_name);
+
+// **Camera Settings Front-End Shared by the Live Programs**
+// Keeps the last applied settings so unchanged values never reach the device.
+class CameraControls {
+public:
+    explicit CameraControls(CameraControlDevice& device);
+
+    // Returns the current value of a control, or -1 on error.
+    int get(const std::string& setting_name);
+
+    // Writes the controls that changed as one batch.
+    ControlWrite apply(const CameraSettings& settings);
+
+    // Records what the device holds now, so apply() only writes what differs
+    // (e.g. to leave white balance alone while auto WB owns it).
+    void assume(const CameraSettings& current) { last_ = current; }
+
+    // Range of a control by name; false if unknown or the query failed.
+    bool query(const std::string& setting_name, ControlRange& range);
+
+    // Writes only the white balance temperature, if it changed.
+    ControlWrite applyWhiteBalance(int wb_value);
+
+    CameraControlDevice& device() { return device_; }
+
+private:
+    CameraControlDevice& device_;
+    CameraSettings last_;
+};
+
+// **Apply Settings and Log the Change (Shared by the Live Programs)**
+// Logs "Updated Settings -> ..." only when something was written, through
+// the asynchronous logger (at most 5 lines a second).
+ControlWrite setCameraSettings(CameraControls& controls, int brightness, int contrast, int saturation, int wb_value);
@@ -0,0 +1,92 @@
+#include "control_worker.h"
+
+#include "latency_stats.h"
+
+CameraControlWorker::CameraControlWorker(WriteFunction write, double maxWritesPerSecond, const CameraSettings& current)
+    : write_(std::move(write)),
+      minInterval_(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double>(maxWritesPerSecond > 0 ? 1.0 / maxWritesPerSecond : 0.0))),
+      pending_(current), attempted_(current) {
+    status_.requested = current;
+    status_.applied = current;
+    status_.settled = true;
+    thread_ = std::thread(&CameraControlWorker::loop, this);
+}
+
+CameraControlWorker::CameraControlWorker(CameraControls& controls, double maxWritesPerSecond, const CameraSettings& current)
+    : CameraControlWorker(
+          [&controls](const CameraSettings& s) {
+              return setCameraSettings(controls, s.brightness, s.contrast, s.saturation, s.whiteBalance);
+          },
+          maxWritesPerSecond, current) {}
+
+CameraControlWorker::~CameraControlWorker() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    thread_.join();
+}
+
+void CameraControlWorker::request(const CameraSettings& settings) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        status_.requests++;
+        status_.requested = settings;
+        if (hasPending_) status_.coalesced++;  // Overwritten before the thread took it
+
+        // Asking for what is already on the device (or was just refused)
+        // needs no write; it also cancels a different value still pending
+        hasPending_ = settings != attempted_;
+        pending_ = settings;
+        status_.settled = !hasPending_ && status_.applied == settings;
+    }
+    wake_.notify_one();
+}
+
+ControlStatus CameraControlWorker::status() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return status_;
+}
+
+// **Control Thread: Take the Latest Request, Write It, Then Wait Out the Rate Limit**
+void CameraControlWorker::loop() {
+    LatencyHistogram& writeLatency = latencyRegistry().stage("camera-write");
+    auto nextWrite = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        wake_.wait(lock, [this] { return hasPending_ || stopping_; });
+        if (!hasPending_) return;  // Stopping with nothing left to write
+
+        // Requests arriving during the wait replace pending_
+        if (!stopping_) {
+            wake_.wait_until(lock, nextWrite, [this] { return stopping_ || !hasPending_; });
+            if (!hasPending_) continue;
+        }
+
+        CameraSettings settings = pending_;
+        hasPending_ = false;
+        attempted_ = settings;
+
+        lock.unlock();
+        ControlWrite result;
+        {
+            ScopedLatency timer(writeLatency);
+            result = write_(settings);
+        }
+        nextWrite = std::chrono::steady_clock::now() + minInterval_;
+        lock.lock();
+
+        if (result == ControlWrite::Unchanged) {
+            status_.unchanged++;  // The device holds them already
+            status_.applied = settings;
+        } else {
+            status_.writes++;
+            if (result == ControlWrite::Written) status_.applied = settings;
+            else status_.failures++;
+        }
+        status_.settled = !hasPending_ && status_.applied == status_.requested;
+    }
+}
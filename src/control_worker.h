@@ -0,0 +1,74 @@
+// Camera control writes off the frame loop.
+// A device write (S_EXT_CTRLS, or VideoCapture::set) can take milliseconds,
+// and while white balance is converging the loops ask for one nearly every
+// frame. CameraControlWorker owns a thread that does the writes: request()
+// drops the desired settings into a single-slot mailbox and returns, a
+// newer request overwrites one the thread has not picked up yet (only the
+// latest value matters), and writes are spaced to at most
+// maxWritesPerSecond. status() reports what was asked for and what the
+// device last accepted, so the overlay can show both.
+#pragma once
+
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "camera_control.h"
+
+// **Requested vs Applied Settings and Worker Counters**
+struct ControlStatus {
+    CameraSettings requested;  // Latest request
+    CameraSettings applied;    // Last settings the device accepted
+    bool settled = false;      // Nothing pending and applied == requested
+    uint64_t requests = 0;
+    uint64_t coalesced = 0;    // Requests replaced before they were written
+    uint64_t writes = 0;       // Writes that reached the device
+    uint64_t unchanged = 0;    // Writes the device already held (not failures)
+    uint64_t failures = 0;
+};
+
+class CameraControlWorker {
+public:
+    // Writes the settings to the device and says whether it did, found
+    // nothing to change, or failed.
+    using WriteFunction = std::function<ControlWrite(const CameraSettings&)>;
+
+    // current is what the device holds now (INT_MIN fields: unknown).
+    CameraControlWorker(WriteFunction write, double maxWritesPerSecond = 10.0,
+                        const CameraSettings& current = {INT_MIN, INT_MIN, INT_MIN, INT_MIN});
+
+    // Writes through setCameraSettings (batched ioctl, change logged).
+    CameraControlWorker(CameraControls& controls, double maxWritesPerSecond = 10.0,
+                        const CameraSettings& current = {INT_MIN, INT_MIN, INT_MIN, INT_MIN});
+
+    // Joins the thread; a request still waiting on the rate limit is written first.
+    ~CameraControlWorker();
+
+    CameraControlWorker(const CameraControlWorker&) = delete;
+    CameraControlWorker& operator=(const CameraControlWorker&) = delete;
+
+    // **Post the Desired Settings; Never Waits for the Device**
+    void request(const CameraSettings& settings);
+
+    ControlStatus status() const;
+
+private:
+    void loop();
+
+    WriteFunction write_;
+    std::chrono::steady_clock::duration minInterval_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    CameraSettings pending_;
+    bool hasPending_ = false;
+    bool stopping_ = false;
+    CameraSettings attempted_;  // Last value written or tried; not retried
+    ControlStatus status_;
+
+    std::thread thread_;
+};
@@ -0,0 +1,174 @@
+#include "denoise.h"
+
+#include <algorithm>
+
+namespace {
+
+struct TierInfo {
+    DenoiseTier tier;
+    const char* name;
+    double budget720p, budget1080p;  // ms; provisional, see denoise.h
+};
+
+const TierInfo kTiers[] = {
+    {DenoiseTier::Guided, "guided", 4, 8},
+    {DenoiseTier::Bilateral, "bilateral", 8, 18},
+    {DenoiseTier::NlMeansFast, "nlm-fast", 60, 135},
+    {DenoiseTier::NlMeans, "nlm", 0, 0},
+};
+
+const TierInfo& tierInfo(DenoiseTier tier) {
+    for (const auto& info : kTiers)
+        if (info.tier == tier) return info;
+    return kTiers[0];
+}
+
+// Rows per parallel stripe, as in the other kernels
+int stripeCount(int rows) {
+    return std::max(1, std::min(rows, cv::getNumThreads() * 4));
+}
+
+}  // namespace
+
+const char* denoiseTierName(DenoiseTier tier) {
+    return tierInfo(tier).name;
+}
+
+bool parseDenoiseTier(const std::string& name, DenoiseTier& tier) {
+    for (const auto& info : kTiers) {
+        if (name == info.name) {
+            tier = info.tier;
+            return true;
+        }
+    }
+    return false;
+}
+
+double denoiseBudgetMs(DenoiseTier tier, cv::Size size) {
+    const TierInfo& info = tierInfo(tier);
+    const double area = static_cast<double>(size.area());
+    const double area720p = 1280.0 * 720.0, area1080p = 1920.0 * 1080.0;
+    return area <= area720p ? info.budget720p * area / area720p
+                            : info.budget1080p * area / area1080p;
+}
+
+Denoiser::Denoiser(const DenoiseConfig& config) : config_(config) {
+    config_.h = std::max(config_.h, 0.0f);
+    config_.hColor = std::max(config_.hColor, 0.0f);
+}
+
+void Denoiser::apply(const cv::Mat& src, cv::Mat& dst) {
+    CV_Assert(src.type() == CV_8UC3 || src.type() == CV_8UC1);
+    CV_Assert(src.data != dst.data || src.empty());
+    if (src.empty()) {
+        dst.release();
+        return;
+    }
+
+    switch (config_.tier) {
+    case DenoiseTier::Guided:
+        guided(src, dst);
+        break;
+    case DenoiseTier::Bilateral:
+        bilateral(src, dst);
+        break;
+    case DenoiseTier::NlMeansFast:
+    case DenoiseTier::NlMeans: {
+        const int templateWindow = config_.tier == DenoiseTier::NlMeans ? 7 : 5;
+        const int searchWindow = config_.tier == DenoiseTier::NlMeans ? 21 : 11;
+        if (src.channels() == 3)
+            cv::fastNlMeansDenoisingColored(src, dst, config_.h, config_.hColor, templateWindow, searchWindow);
+        else
+            cv::fastNlMeansDenoising(src, dst, config_.h, templateWindow, searchWindow);
+        break;
+    }
+    }
+}
+
+// **Guided Filter with the Image as Its Own Guide**
+// Per channel, q = A * I + B with a = var / (var + eps), b = (1 - a) * mean
+// over a window and A, B the window means of a, b (He et al.). Flat areas
+// (var << eps) are averaged, edges (var >> eps) kept. The coefficients are
+// smooth, so they are computed at half resolution and upsampled ("fast
+// guided filter"); only the final A * I + B runs at full resolution.
+void Denoiser::guided(const cv::Mat& src, cv::Mat& dst) {
+    const int cn = src.channels();
+    const cv::Size window(5, 5);  // ~9x9 at full resolution
+    const float eps = std::max(4.0f * config_.h * config_.h, 1e-6f);  // (2h)^2 in 8-bit levels
+
+    cv::resize(src, small_, cv::Size((src.cols + 1) / 2, (src.rows + 1) / 2), 0, 0, cv::INTER_AREA);
+    small_.convertTo(smallF_, CV_32F);
+    cv::boxFilter(smallF_, mean_, -1, window);
+    cv::multiply(smallF_, smallF_, a_);
+    cv::boxFilter(a_, meanSq_, -1, window);
+
+    // a and b per pixel and channel (a_ held I^2 until now)
+    b_.create(smallF_.size(), smallF_.type());
+    const int smallRows = smallF_.rows, n = smallF_.cols * cn;
+    const int smallStripes = stripeCount(smallRows);
+    cv::parallel_for_(cv::Range(0, smallStripes), [&](const cv::Range& range) {
+        for (int s = range.start; s < range.end; s++) {
+            for (int y = smallRows * s / smallStripes; y < smallRows * (s + 1) / smallStripes; y++) {
+                const float* m = mean_.ptr<float>(y);
+                const float* sq = meanSq_.ptr<float>(y);
+                float* a = a_.ptr<float>(y);
+                float* b = b_.ptr<float>(y);
+                for (int i = 0; i < n; i++) {
+                    float var = std::max(sq[i] - m[i] * m[i], 0.0f);
+                    a[i] = var / (var + eps);
+                    b[i] = (1.0f - a[i]) * m[i];
+                }
+            }
+        }
+    });
+
+    cv::boxFilter(a_, mean_, -1, window);
+    cv::boxFilter(b_, meanSq_, -1, window);
+    cv::resize(mean_, fullA_, src.size(), 0, 0, cv::INTER_LINEAR);
+    cv::resize(meanSq_, fullB_, src.size(), 0, 0, cv::INTER_LINEAR);
+
+    // **q = A * I + B at Full Resolution**
+    dst.create(src.size(), src.type());
+    const int rows = src.rows, cols = src.cols * cn;
+    const int stripes = stripeCount(rows);
+    cv::parallel_for_(cv::Range(0, stripes), [&](const cv::Range& range) {
+        for (int s = range.start; s < range.end; s++) {
+            for (int y = rows * s / stripes; y < rows * (s + 1) / stripes; y++) {
+                const uchar* in = src.ptr<uchar>(y);
+                const float* A = fullA_.ptr<float>(y);
+                const float* B = fullB_.ptr<float>(y);
+                uchar* out = dst.ptr<uchar>(y);
+                for (int i = 0; i < cols; i++) out[i] = cv::saturate_cast<uchar>(A[i] * in[i] + B[i]);
+            }
+        }
+    });
+}
+
+// **Bilateral on Luma, Box Blur on Chroma**
+// Noise that matters visually is mostly in luma; chroma noise is blotchy
+// and low-contrast, so a 5x5 mean is enough there. One bilateral plane
+// with a 5-pixel diameter instead of three with 9 keeps it real-time.
+void Denoiser::bilateral(const cv::Mat& src, cv::Mat& dst) {
+    const int diameter = 5;
+    const double sigmaColor = 3.0 * config_.h, sigmaSpace = 3.0;
+
+    if (src.channels() == 1) {
+        cv::bilateralFilter(src, dst, diameter, sigmaColor, sigmaSpace);
+        return;
+    }
+
+    cv::cvtColor(src, ycrcb_, cv::COLOR_BGR2YCrCb);
+    cv::split(ycrcb_, planes_);
+    if (config_.h > 0) {
+        cv::bilateralFilter(planes_[0], filtered_, diameter, sigmaColor, sigmaSpace);
+        cv::swap(planes_[0], filtered_);
+    }
+    if (config_.hColor > 0) {
+        for (int c = 1; c < 3; c++) {
+            cv::blur(planes_[c], filtered_, cv::Size(5, 5));
+            cv::swap(planes_[c], filtered_);
+        }
+    }
+    cv::merge(planes_, 3, ycrcb_);
+    cv::cvtColor(ycrcb_, dst, cv::COLOR_YCrCb2BGR);
+}
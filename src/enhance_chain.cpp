@@ -0,0 +1,156 @@
+#include "enhance_chain.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <utility>
+
+namespace {
+
+std::string trim(const std::string& s) {
+    size_t b = s.find_first_not_of(" \t");
+    if (b == std::string::npos) return "";
+    size_t e = s.find_last_not_of(" \t");
+    return s.substr(b, e - b + 1);
+}
+
+// **Replace Each Run of Two or More Point Ops with a FusedPointStage**
+// A frame-dependent op needs the frame as it reaches it, so it always starts
+// a new run.
+void fusePointOpRuns(std::vector<std::unique_ptr<EnhanceStage>>& stages) {
+    std::vector<std::unique_ptr<EnhanceStage>> fused, run;
+    auto flush = [&]() {
+        if (run.size() == 1) fused.push_back(std::move(run[0]));
+        else if (run.size() > 1) fused.emplace_back(new FusedPointStage(std::move(run)));
+        run.clear();
+    };
+
+    for (auto& stage : stages) {
+        EnhanceStage::PointOpKind kind = stage->pointOpKind();
+        if (kind == EnhanceStage::NotPointOp) {
+            flush();
+            fused.push_back(std::move(stage));
+        } else {
+            if (kind == EnhanceStage::FramePointOp) flush();
+            run.push_back(std::move(stage));
+        }
+    }
+    flush();
+    stages = std::move(fused);
+}
+
+}  // namespace
+
+bool EnhanceChain::plan(cv::Size size, int type) {
+    buffers_.resize(stages_.empty() ? 0 : stages_.size() - 1);
+    stageMs_.resize(stages_.size(), 0.0);
+
+    int current = type;
+    for (size_t i = 0; i < stages_.size(); i++) {
+        int next = stages_[i]->outputType(current);
+        if (next < 0) {
+            std::cerr << "Error: Stage '" << stages_[i]->name() << "' cannot take "
+                      << cv::typeToString(current) << " input" << std::endl;
+            type_ = -1;
+            return false;
+        }
+        stages_[i]->prepare(size, current);
+        if (i + 1 < stages_.size()) buffers_[i].create(size, next);
+        current = next;
+    }
+
+    size_ = size;
+    type_ = type;
+    return true;
+}
+
+bool EnhanceChain::run(const cv::Mat& src, cv::Mat& dst) {
+    if (src.size() != size_ || src.type() != type_) {
+        if (!plan(src.size(), src.type())) return false;
+    }
+    if (stages_.empty()) {
+        src.copyTo(dst);
+        return true;
+    }
+    if (dst.data == src.data) dst.release();  // Stages never run in place
+
+    const double msPerTick = 1000.0 / cv::getTickFrequency();
+    const cv::Mat* in = &src;
+    for (size_t i = 0; i < stages_.size(); i++) {
+        cv::Mat* out = (i + 1 < stages_.size()) ? &buffers_[i] : &dst;
+        if (out == &dst) dst.create(size_, stages_[i]->outputType(in->type()));
+
+        int64_t start = cv::getTickCount();
+        stages_[i]->process(*in, *out);
+        stageMs_[i] += (cv::getTickCount() - start) * msPerTick;
+        in = out;
+    }
+    frames_++;
+    return true;
+}
+
+void EnhanceChain::resetTimes() {
+    std::fill(stageMs_.begin(), stageMs_.end(), 0.0);
+    frames_ = 0;
+}
+
+std::string EnhanceChain::describe() const {
+    std::string text;
+    for (size_t i = 0; i < stages_.size(); i++) {
+        if (i > 0) text += " -> ";
+        text += stages_[i]->name();
+    }
+    return text.empty() ? "(empty)" : text;
+}
+
+EnhanceChainBuilder& EnhanceChainBuilder::add(std::unique_ptr<EnhanceStage> stage) {
+    if (stage) stages_.push_back(std::move(stage));
+    else failed_ = true;
+    return *this;
+}
+
+bool EnhanceChainBuilder::parse(const std::string& spec) {
+    std::stringstream stream(spec);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        item = trim(item);
+        if (item.empty()) continue;
+
+        std::stringstream fields(item);
+        std::string name, field;
+        std::getline(fields, name, ':');
+        std::vector<double> args;
+        while (std::getline(fields, field, ':')) {
+            char* end = nullptr;
+            double value = std::strtod(field.c_str(), &end);
+            if (field.empty() || *end != '\0') {
+                std::cerr << "Error: Bad argument '" << field << "' for stage '" << name << "'" << std::endl;
+                failed_ = true;
+                return false;
+            }
+            args.push_back(value);
+        }
+
+        std::unique_ptr<EnhanceStage> stage = createEnhanceStage(trim(name), args);
+        if (!stage) {
+            failed_ = true;
+            return false;
+        }
+        stages_.push_back(std::move(stage));
+    }
+    return true;
+}
+
+bool EnhanceChainBuilder::build(cv::Size size, int type, EnhanceChain& chain) {
+    if (failed_) {
+        std::cerr << "Error: Enhancement chain has invalid stages" << std::endl;
+        return false;
+    }
+    if (fusePointOps_) fusePointOpRuns(stages_);
+
+    chain = EnhanceChain();
+    chain.stages_ = std::move(stages_);
+    stages_.clear();
+    return chain.plan(size, type);
+}
@@ -0,0 +1,94 @@
+// A planned sequence of EnhanceStages.
+// EnhanceChainBuilder collects stages (in code, or from a text spec such as
+// "denoise:1:2,sharpen,clahe-rgb:5") and build() checks once that every
+// stage accepts the type the previous one produces, then allocates every
+// intermediate buffer for the frame size. run() reuses those buffers on
+// every frame; it only re-plans if the input size or type changes.
+// Runs of consecutive per-channel point operations (gamma, darken, contrast,
+// white balance) are fused into one FusedPointStage, so N of them cost one
+// cv::LUT pass.
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "enhance_stages.h"
+
+class EnhanceChain {
+public:
+    EnhanceChain() = default;
+    EnhanceChain(EnhanceChain&&) = default;
+    EnhanceChain& operator=(EnhanceChain&&) = default;
+
+    // **Run Every Stage; dst Receives the Last Stage's Output**
+    // Returns false if the chain cannot take src's type. With no stages, dst
+    // is a copy of src.
+    bool run(const cv::Mat& src, cv::Mat& dst);
+
+    size_t size() const { return stages_.size(); }
+    EnhanceStage& stage(size_t i) { return *stages_[i]; }
+
+    // First stage of type S, or nullptr (e.g. to reach an OverlayStage)
+    template <typename S>
+    S* find() {
+        for (auto& stage : stages_)
+            if (S* s = dynamic_cast<S*>(stage.get())) return s;
+        return nullptr;
+    }
+
+    // **Accumulated Time per Stage Since the Last resetTimes()**
+    double stageMs(size_t i) const { return stageMs_[i]; }
+    uint64_t frames() const { return frames_; }
+    void resetTimes();
+
+    // "denoise -> sharpen -> clahe-rgb"
+    std::string describe() const;
+
+private:
+    friend class EnhanceChainBuilder;
+
+    bool plan(cv::Size size, int type);
+
+    std::vector<std::unique_ptr<EnhanceStage>> stages_;
+    std::vector<cv::Mat> buffers_;   // Output of each stage but the last
+    std::vector<double> stageMs_;
+    cv::Size size_;
+    int type_ = -1;
+    uint64_t frames_ = 0;
+};
+
+class EnhanceChainBuilder {
+public:
+    EnhanceChainBuilder& add(std::unique_ptr<EnhanceStage> stage);
+
+    template <typename S, typename... Args>
+    EnhanceChainBuilder& add(Args&&... args) {
+        return add(std::unique_ptr<EnhanceStage>(new S(std::forward<Args>(args)...)));
+    }
+
+    // **Append Stages from a Spec: "name[:arg...],name[:arg...],..."**
+    // See createEnhanceStage() for names and arguments. Returns false on the
+    // first unknown stage or malformed argument.
+    bool parse(const std::string& spec);
+
+    // Point-operation fusion is on by default; turn it off to time or
+    // compare the stages one by one.
+    EnhanceChainBuilder& fusePointOps(bool enable) {
+        fusePointOps_ = enable;
+        return *this;
+    }
+
+    // **Validate the Chain for Frames of This Size and Type, Allocate Buffers**
+    // Moves the stages into chain. Returns false (and prints the offending
+    // stage) if some stage cannot take its input type.
+    bool build(cv::Size size, int type, EnhanceChain& chain);
+
+private:
+    std::vector<std::unique_ptr<EnhanceStage>> stages_;
+    bool failed_ = false;
+    bool fusePointOps_ = true;
+};
@@ -0,0 +1,450 @@
+#include "enhance_stages.h"
+
+#include <cmath>
+#include <initializer_list>
+#include <iostream>
+#include <utility>
+
+#include "frame_stats.h"
+
+namespace {
+
+bool is8U(int type) {
+    return type == CV_8UC3 || type == CV_8UC1;
+}
+
+// **1 x 256 Ramp 0..255**
+cv::Mat identityLut() {
+    cv::Mat lut(1, 256, CV_8U);
+    for (int i = 0; i < 256; i++) lut.at<uchar>(i) = static_cast<uchar>(i);
+    return lut;
+}
+
+// **LUT of convertTo(alpha, beta)**
+// Built with convertTo itself, so applying the LUT gives exactly what the
+// programs got from Mat *= s, Mat /= s and convertTo(-1, 1, -50).
+cv::Mat scaleLut(double alpha, double beta = 0) {
+    cv::Mat lut;
+    identityLut().convertTo(lut, CV_8U, alpha, beta);
+    return lut;
+}
+
+cv::Mat mergeLuts(const cv::Mat& b, const cv::Mat& g, const cv::Mat& r) {
+    cv::Mat planes[] = {b, g, r};
+    cv::Mat lut;
+    cv::merge(planes, 3, lut);
+    return lut;
+}
+
+// **Replicate a Single-Channel Table for Every Image Channel**
+cv::Mat expandLut(const cv::Mat& lut, int channels) {
+    if (lut.channels() == channels) return lut;
+    std::vector<cv::Mat> planes(channels, lut);
+    cv::Mat expanded;
+    cv::merge(planes, expanded);
+    return expanded;
+}
+
+// **out = second(first(x)), Channel by Channel**
+void composeLuts(const cv::Mat& first, const cv::Mat& second, cv::Mat& out) {
+    const int cn = first.channels();
+    out.create(1, 256, first.type());
+    const uchar* a = first.ptr<uchar>();
+    const uchar* b = second.ptr<uchar>();
+    uchar* o = out.ptr<uchar>();
+    for (int i = 0; i < 256 * cn; i += cn)
+        for (int c = 0; c < cn; c++) o[i + c] = b[a[i + c] * cn + c];
+}
+
+DenoiseConfig nlMeansConfig(float h, float hColor) {
+    DenoiseConfig config;
+    config.tier = DenoiseTier::NlMeans;
+    config.h = h;
+    config.hColor = hColor;
+    return config;
+}
+
+WbConfig temperatureWbConfig(double targetTemp) {
+    WbConfig config;
+    config.estimator = WbEstimator::GrayWorld;
+    config.targetTemp = targetTemp;
+    return config;
+}
+
+double arg(const std::vector<double>& args, size_t i, double fallback) {
+    return i < args.size() ? args[i] : fallback;
+}
+
+// **Accepted Values of One Stage Argument**
+struct ArgRange {
+    const char* name;
+    double minimum;
+    double maximum;
+    bool integer;
+};
+
+// Checks the argument count and every given argument against its range;
+// prints what is wrong, naming the stage and the argument.
+bool checkArgs(const std::string& stage, const std::vector<double>& args, std::initializer_list<ArgRange> ranges) {
+    if (args.size() > ranges.size()) {
+        std::cerr << "Error: Enhancement stage '" << stage << "' takes at most " << ranges.size()
+                  << " argument(s), got " << args.size() << std::endl;
+        return false;
+    }
+    size_t i = 0;
+    for (const ArgRange& range : ranges) {
+        if (i == args.size()) break;
+        const double value = args[i++];
+        if (!(value >= range.minimum && value <= range.maximum)) {  // NaN fails too
+            std::cerr << "Error: Enhancement stage '" << stage << "': " << range.name << " = " << value
+                      << " is outside [" << range.minimum << ", " << range.maximum << "]" << std::endl;
+            return false;
+        }
+        if (range.integer && value != std::floor(value)) {
+            std::cerr << "Error: Enhancement stage '" << stage << "': " << range.name << " = " << value
+                      << " is not a whole number" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+// **Denoise**
+DenoiseStage::DenoiseStage(float h, float hColor) : DenoiseStage(nlMeansConfig(h, hColor)) {}
+
+DenoiseStage::DenoiseStage(const DenoiseConfig& config) : denoiser_(config), name_("denoise") {
+    if (config.tier != DenoiseTier::NlMeans) name_ += std::string("-") + denoiseTierName(config.tier);
+}
+
+int DenoiseStage::outputType(int inputType) const {
+    return is8U(inputType) ? inputType : -1;
+}
+
+void DenoiseStage::process(const cv::Mat& src, cv::Mat& dst) {
+    denoiser_.apply(src, dst);
+}
+
+// **Temporal Denoise**
+TemporalDenoiseStage::TemporalDenoiseStage(const TemporalDenoiseConfig& config) : denoiser_(config) {}
+
+int TemporalDenoiseStage::outputType(int inputType) const {
+    return CV_MAT_DEPTH(inputType) == CV_8U ? inputType : -1;
+}
+
+void TemporalDenoiseStage::process(const cv::Mat& src, cv::Mat& dst) {
+    denoiser_.apply(src, dst);
+}
+
+// **Sharpen**
+SharpenStage::SharpenStage()
+    : kernel_((cv::Mat_<float>(3,3) <<
+        0, -1,  0,
+       -1,  5, -1,
+        0, -1,  0)) {}
+
+int SharpenStage::outputType(int inputType) const {
+    return is8U(inputType) ? inputType : -1;
+}
+
+void SharpenStage::process(const cv::Mat& src, cv::Mat& dst) {
+    cv::filter2D(src, dst, -1, kernel_);
+}
+
+// **CLAHE**
+ClaheStage::ClaheStage(const LocalContrastConfig& config, Mode mode)
+    : mode_(mode), enhancers_(1, LocalContrastEnhancer(config)) {}
+
+int ClaheStage::outputType(int inputType) const {
+    return is8U(inputType) ? inputType : -1;
+}
+
+void ClaheStage::prepare(cv::Size size, int type) {
+    size_t planes = (mode_ == PerChannel && type == CV_8UC3) ? 3 : 1;
+    if (enhancers_.size() != planes) enhancers_.resize(planes, LocalContrastEnhancer(enhancers_[0].config()));
+    if (type == CV_8UC3) {
+        lab_.create(size, CV_8UC3);
+        plane_.create(size, CV_8UC1);
+    }
+}
+
+void ClaheStage::process(const cv::Mat& src, cv::Mat& dst) {
+    if (src.channels() == 1) {
+        enhancers_[0].apply(src, dst);
+    } else if (mode_ == Luma) {
+        cv::cvtColor(src, lab_, cv::COLOR_BGR2Lab);
+        cv::extractChannel(lab_, plane_, 0);
+        enhancers_[0].apply(plane_, plane_);
+        cv::insertChannel(plane_, lab_, 0);
+        cv::cvtColor(lab_, dst, cv::COLOR_Lab2BGR);
+    } else {
+        for (int c = 0; c < 3; c++) {
+            cv::extractChannel(src, plane_, c);
+            enhancers_[c].apply(plane_, plane_);
+            cv::insertChannel(plane_, dst, c);
+        }
+    }
+}
+
+// **Lookup Tables**
+int LutStage::outputType(int inputType) const {
+    return is8U(inputType) ? inputType : -1;
+}
+
+void LutStage::process(const cv::Mat& src, cv::Mat& dst) {
+    cv::LUT(src, lut_, dst);
+}
+
+void LutStage::pointLut(int type, const cv::Mat& frame, cv::Mat& lut) {
+    (void)frame;
+    lut = expandLut(lut_, CV_MAT_CN(type));
+}
+
+static cv::Mat gammaLut(double gamma) {
+    cv::Mat lut(1, 256, CV_8U);
+    uchar* p = lut.ptr();
+    for (int i = 0; i < 256; i++)
+        p[i] = cv::saturate_cast<uchar>(std::pow(i / 255.0, gamma) * 255.0);
+    return lut;
+}
+
+GammaStage::GammaStage(double gamma) : LutStage("gamma", gammaLut(gamma)) {}
+
+DarkenStage::DarkenStage(double amount) : LutStage("darken", scaleLut(1, -amount)) {}
+
+ContrastStage::ContrastStage(double alpha, double beta) : LutStage("contrast", scaleLut(alpha, beta)) {}
+
+// **Flash Reduction**
+FlashReduceStage::FlashReduceStage(const FlashReduceParams& params) : sharpenWeight_(params.sharpenWeight) {
+    buildFlashToneCurve(params, tone_);
+}
+
+int FlashReduceStage::outputType(int inputType) const {
+    return is8U(inputType) ? inputType : -1;
+}
+
+void FlashReduceStage::prepare(cv::Size size, int type) {
+    if (type == CV_8UC3) lab_.create(size, CV_8UC3);
+}
+
+void FlashReduceStage::process(const cv::Mat& src, cv::Mat& dst) {
+    if (src.channels() == 1) {
+        compressHighlights(src, dst, tone_, sharpenWeight_);
+        return;
+    }
+    cv::cvtColor(src, lab_, cv::COLOR_BGR2Lab);
+    compressHighlights(lab_, lab_, tone_, sharpenWeight_);  // L only, in place
+    cv::cvtColor(lab_, dst, cv::COLOR_Lab2BGR);
+}
+
+// **Saturation**
+SaturationStage::SaturationStage(double factor) {
+    cv::Mat identity = identityLut();
+    lut_ = mergeLuts(identity, scaleLut(factor), identity);
+}
+
+int SaturationStage::outputType(int inputType) const {
+    return inputType == CV_8UC3 ? inputType : -1;
+}
+
+void SaturationStage::prepare(cv::Size size, int type) {
+    (void)type;
+    hsv_.create(size, CV_8UC3);
+}
+
+void SaturationStage::process(const cv::Mat& src, cv::Mat& dst) {
+    cv::cvtColor(src, hsv_, cv::COLOR_BGR2HSV);
+    cv::LUT(hsv_, lut_, hsv_);
+    cv::cvtColor(hsv_, dst, cv::COLOR_HSV2BGR);
+}
+
+// **White Balance**
+WhiteBalanceStage::WhiteBalanceStage(double targetTemp) : balancer_(temperatureWbConfig(targetTemp)), name_("wb") {}
+
+WhiteBalanceStage::WhiteBalanceStage(const WbConfig& config) : balancer_(config), name_("wb-") {
+    name_ += config.estimator == WbEstimator::GrayWorld ? "gray"
+           : config.estimator == WbEstimator::WhitePatch ? "white" : "pct";
+}
+
+int WhiteBalanceStage::outputType(int inputType) const {
+    return inputType == CV_8UC3 ? inputType : -1;
+}
+
+void WhiteBalanceStage::pointLut(int type, const cv::Mat& frame, cv::Mat& lut) {
+    (void)type;
+    balancer_.measure(frame);
+    wbGainLut(estimateWbGains(balancer_.histograms(), balancer_.config()), lut);
+}
+
+void WhiteBalanceStage::process(const cv::Mat& src, cv::Mat& dst) {
+    balancer_.apply(src, dst);
+}
+
+// **Fused Point Operations**
+FusedPointStage::FusedPointStage(std::vector<std::unique_ptr<EnhanceStage>> stages)
+    : stages_(std::move(stages)) {
+    for (size_t i = 0; i < stages_.size(); i++) {
+        if (i > 0) name_ += "+";
+        name_ += stages_[i]->name();
+    }
+    frameDependent_ = !stages_.empty() && stages_[0]->pointOpKind() == FramePointOp;
+}
+
+int FusedPointStage::outputType(int inputType) const {
+    for (const auto& stage : stages_)
+        if (stage->outputType(inputType) != inputType) return -1;
+    return inputType;
+}
+
+void FusedPointStage::prepare(cv::Size size, int type) {
+    (void)size;
+    staticLut_ = expandLut(identityLut(), CV_MAT_CN(type));
+    cv::Mat stageLut, composed;
+    for (size_t i = frameDependent_ ? 1 : 0; i < stages_.size(); i++) {
+        stages_[i]->pointLut(type, cv::Mat(), stageLut);
+        composeLuts(staticLut_, stageLut, composed);
+        composed.copyTo(staticLut_);
+    }
+}
+
+void FusedPointStage::process(const cv::Mat& src, cv::Mat& dst) {
+    if (!frameDependent_) {
+        cv::LUT(src, staticLut_, dst);
+        return;
+    }
+    stages_[0]->pointLut(src.type(), src, frameLut_);
+    composeLuts(frameLut_, staticLut_, lut_);
+    cv::LUT(src, lut_, dst);
+}
+
+// **Bilateral**
+BilateralStage::BilateralStage(int diameter, double sigmaColor, double sigmaSpace)
+    : diameter_(diameter), sigmaColor_(sigmaColor), sigmaSpace_(sigmaSpace) {}
+
+int BilateralStage::outputType(int inputType) const {
+    return is8U(inputType) ? inputType : -1;
+}
+
+void BilateralStage::process(const cv::Mat& src, cv::Mat& dst) {
+    cv::bilateralFilter(src, dst, diameter_, sigmaColor_, sigmaSpace_);
+}
+
+// **Overlay**
+OverlayStage::OverlayStage(cv::Point origin, double scale, cv::Scalar colour)
+    : origin_(origin), scale_(scale), colour_(colour) {}
+
+int OverlayStage::outputType(int inputType) const {
+    return is8U(inputType) ? inputType : -1;
+}
+
+void OverlayStage::setText(const std::string& text) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    text_ = text;
+}
+
+void OverlayStage::process(const cv::Mat& src, cv::Mat& dst) {
+    src.copyTo(dst);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!text_.empty())
+        cv::putText(dst, text_, origin_, cv::FONT_HERSHEY_SIMPLEX, scale_, colour_, 2);
+}
+
+// **Factory**
+std::unique_ptr<EnhanceStage> createEnhanceStage(const std::string& name, const std::vector<double>& args) {
+    std::unique_ptr<EnhanceStage> stage;
+    DenoiseTier tier;
+    if (name == "denoise" || name == "denoise-nlm") {
+        if (!checkArgs(name, args, {{"h", 0, 100, false}, {"hColor", 0, 100, false}})) return nullptr;
+        stage.reset(new DenoiseStage(static_cast<float>(arg(args, 0, 1)), static_cast<float>(arg(args, 1, 2))));
+    } else if (name.compare(0, 8, "denoise-") == 0 && parseDenoiseTier(name.substr(8), tier)) {
+        // "denoise-" + the tier's name in denoise.h
+        if (tier == DenoiseTier::Guided ? !checkArgs(name, args, {{"h", 0, 100, false}})
+                                        : !checkArgs(name, args, {{"h", 0, 100, false}, {"hColor", 0, 100, false}})) {
+            return nullptr;
+        }
+        DenoiseConfig config;
+        config.tier = tier;
+        const double h = config.tier == DenoiseTier::NlMeansFast ? 1 : 3;
+        config.h = static_cast<float>(arg(args, 0, h));
+        config.hColor = static_cast<float>(arg(args, 1, config.tier == DenoiseTier::NlMeansFast ? 2 : 3));
+        stage.reset(new DenoiseStage(config));
+    } else if (name == "temporal") {
+        // strength 1 would freeze static pixels for good
+        if (!checkArgs(name, args, {{"strength", 0, 0.99, false}, {"noise", 0, 255, true}})) return nullptr;
+        TemporalDenoiseConfig config;
+        config.strength = arg(args, 0, 0.75);
+        config.noiseLevel = static_cast<int>(arg(args, 1, 6));
+        stage.reset(new TemporalDenoiseStage(config));
+    } else if (name == "sharpen") {
+        if (!checkArgs(name, args, {})) return nullptr;
+        stage.reset(new SharpenStage());
+    } else if (name == "clahe") {
+        if (!checkArgs(name, args, {{"clip", 0.1, 100, false}, {"temporal", 0, 0.99, false}, {"refresh", 1, 64, true}})) {
+            return nullptr;
+        }
+        LocalContrastConfig config;
+        config.clipLimit = arg(args, 0, 2.0);
+        config.temporalWeight = arg(args, 1, 0.0);
+        config.refreshInterval = static_cast<int>(arg(args, 2, 1));
+        stage.reset(new ClaheStage(config, ClaheStage::Luma));
+    } else if (name == "clahe-rgb") {
+        if (!checkArgs(name, args, {{"clip", 0.1, 100, false}})) return nullptr;
+        LocalContrastConfig config;
+        config.clipLimit = arg(args, 0, 2.0);
+        stage.reset(new ClaheStage(config, ClaheStage::PerChannel));
+    } else if (name == "gamma") {
+        if (!checkArgs(name, args, {{"g", 0.05, 10, false}})) return nullptr;
+        stage.reset(new GammaStage(arg(args, 0, 0.5)));
+    } else if (name == "darken") {
+        if (!checkArgs(name, args, {{"amount", 0, 255, false}})) return nullptr;
+        stage.reset(new DarkenStage(arg(args, 0, 50)));
+    } else if (name == "contrast") {
+        if (!checkArgs(name, args, {{"alpha", 0, 10, false}, {"beta", -255, 255, false}})) return nullptr;
+        stage.reset(new ContrastStage(arg(args, 0, 1.2), arg(args, 1, 0)));
+    } else if (name == "flash" || name == "flash-soft") {
+        if (name == "flash" ? !checkArgs(name, args, {{"threshold", 0, 255, true}, {"reduction", 0, 1, false},
+                                                      {"sharpen", 0, 1, false}})
+                            : !checkArgs(name, args, {{"threshold", 0, 255, true}, {"reduction", 0, 1, false}})) {
+            return nullptr;
+        }
+        FlashReduceParams params;
+        params.threshold = static_cast<int>(arg(args, 0, 200));
+        if (name == "flash") {
+            params.reduction = arg(args, 1, 0.7);
+            params.sharpenWeight = arg(args, 2, 0.4);
+        } else {
+            params.reduction = arg(args, 1, 0.75);
+            params.sharpenWeight = 0;
+            params.softKnee = true;
+        }
+        stage.reset(new FlashReduceStage(params));
+    } else if (name == "saturation") {
+        if (!checkArgs(name, args, {{"factor", 0, 10, false}})) return nullptr;
+        stage.reset(new SaturationStage(arg(args, 0, 1.3)));
+    } else if (name == "wb") {
+        if (!checkArgs(name, args, {{"target", 1000, 10000, false}})) return nullptr;  // Kelvin
+        stage.reset(new WhiteBalanceStage(arg(args, 0, 6500)));
+    } else if (name == "wb-gray" || name == "wb-white" || name == "wb-pct") {
+        if (name == "wb-pct" ? !checkArgs(name, args, {{"fraction", 0.5, 1, false}}) : !checkArgs(name, args, {})) {
+            return nullptr;
+        }
+        WbConfig config;
+        config.estimator = name == "wb-gray" ? WbEstimator::GrayWorld
+                         : name == "wb-white" ? WbEstimator::WhitePatch : WbEstimator::Percentile;
+        config.percentile = arg(args, 0, 0.99);
+        stage.reset(new WhiteBalanceStage(config));
+    } else if (name == "bilateral") {
+        if (!checkArgs(name, args, {{"d", 1, 50, true}, {"sigmaColor", 0.1, 1000, false},
+                                    {"sigmaSpace", 0.1, 1000, false}})) {
+            return nullptr;
+        }
+        stage.reset(new BilateralStage(static_cast<int>(arg(args, 0, 9)), arg(args, 1, 75), arg(args, 2, 75)));
+    } else if (name == "overlay") {
+        if (!checkArgs(name, args, {})) return nullptr;
+        stage.reset(new OverlayStage());
+    } else {
+        std::cerr << "Error: Unknown enhancement stage '" << name << "'" << std::endl;
+    }
+    return stage;
+}
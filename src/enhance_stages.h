@@ -0,0 +1,272 @@
+// Image enhancement operations as reusable stages.
+// These are the operations the still-image and live programs used to paste
+// into each main(): NL-means denoise, 3x3 sharpen, CLAHE, gamma, darken,
+// flash reduction, saturation boost, gray-world white balance, bilateral
+// smoothing and a text overlay. Each stage keeps its scratch buffers between
+// frames; EnhanceChain (enhance_chain.h) strings them together.
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "denoise.h"
+#include "flash_reduce.h"
+#include "local_contrast.h"
+#include "temporal_denoise.h"
+#include "white_balance.h"
+
+// **One Image Operation**
+class EnhanceStage {
+public:
+    virtual ~EnhanceStage() = default;
+
+    virtual const char* name() const = 0;
+
+    // Output type for an input of this type, or -1 if the stage cannot take it.
+    // Stages keep the frame size.
+    virtual int outputType(int inputType) const = 0;
+
+    // Called whenever the chain is planned for a new input size / type, so
+    // scratch buffers can be allocated before the first frame.
+    virtual void prepare(cv::Size size, int type) { (void)size; (void)type; }
+
+    // src and dst are different Mats; dst is already allocated by the chain.
+    virtual void process(const cv::Mat& src, cv::Mat& dst) = 0;
+
+    // **Per-Channel Point Operations (Fused into One LUT by the Chain)**
+    // A point op maps every channel value independently. Static ones have a
+    // fixed table; frame-dependent ones (white balance) derive it from their
+    // input, so a fused run can only start with one of them.
+    enum PointOpKind { NotPointOp, StaticPointOp, FramePointOp };
+    virtual PointOpKind pointOpKind() const { return NotPointOp; }
+
+    // Table for an input of this type: 1 x 256 with one channel per image
+    // channel. frame is the stage's input (used by FramePointOp only).
+    virtual void pointLut(int type, const cv::Mat& frame, cv::Mat& lut) {
+        (void)type; (void)frame; lut.release();
+    }
+};
+
+// **Denoise: NL-Means as in main1 / main2, or a Faster Tier (denoise.h)**
+class DenoiseStage : public EnhanceStage {
+public:
+    DenoiseStage(float h = 1.0f, float hColor = 2.0f);  // NL-means, 7x7 / 21x21
+    explicit DenoiseStage(const DenoiseConfig& config);
+    const char* name() const override { return name_.c_str(); }
+    int outputType(int inputType) const override;
+    void process(const cv::Mat& src, cv::Mat& dst) override;
+
+private:
+    Denoiser denoiser_;
+    std::string name_;  // "denoise", "denoise-guided", ...
+};
+
+// **Motion-Adaptive Temporal Denoise (Put It Before the Enhancement)**
+class TemporalDenoiseStage : public EnhanceStage {
+public:
+    explicit TemporalDenoiseStage(const TemporalDenoiseConfig& config = TemporalDenoiseConfig());
+    const char* name() const override { return "temporal"; }
+    int outputType(int inputType) const override;
+    void process(const cv::Mat& src, cv::Mat& dst) override;
+
+    TemporalDenoiser& denoiser() { return denoiser_; }
+
+private:
+    TemporalDenoiser denoiser_;
+};
+
+// **3x3 Sharpen Kernel [0 -1 0; -1 5 -1; 0 -1 0]**
+class SharpenStage : public EnhanceStage {
+public:
+    SharpenStage();
+    const char* name() const override { return "sharpen"; }
+    int outputType(int inputType) const override;
+    void process(const cv::Mat& src, cv::Mat& dst) override;
+
+private:
+    cv::Mat kernel_;
+};
+
+// **CLAHE on Lab L (main5 / main7) or on Each BGR Channel (main1 / main2)**
+class ClaheStage : public EnhanceStage {
+public:
+    enum Mode { Luma, PerChannel };
+
+    explicit ClaheStage(const LocalContrastConfig& config, Mode mode = Luma);
+    const char* name() const override { return mode_ == Luma ? "clahe" : "clahe-rgb"; }
+    int outputType(int inputType) const override;
+    void prepare(cv::Size size, int type) override;
+    void process(const cv::Mat& src, cv::Mat& dst) override;
+
+private:
+    Mode mode_;
+    std::vector<LocalContrastEnhancer> enhancers_;  // One per processed plane
+    cv::Mat lab_, plane_;
+};
+
+// **Per-Channel Lookup Table (Gamma, Darken)**
+class LutStage : public EnhanceStage {
+public:
+    const char* name() const override { return name_.c_str(); }
+    int outputType(int inputType) const override;
+    void process(const cv::Mat& src, cv::Mat& dst) override;
+    PointOpKind pointOpKind() const override { return StaticPointOp; }
+    void pointLut(int type, const cv::Mat& frame, cv::Mat& lut) override;
+
+    const cv::Mat& lut() const { return lut_; }
+
+protected:
+    LutStage(const std::string& name, const cv::Mat& lut) : name_(name), lut_(lut) {}
+
+private:
+    std::string name_;
+    cv::Mat lut_;  // 1 x 256 CV_8U
+};
+
+// **Gamma Curve (main2: 0.5 Darkens)**
+class GammaStage : public LutStage {
+public:
+    explicit GammaStage(double gamma = 0.5);
+};
+
+// **Subtract a Constant (main2: convertTo(-1, 1, -50))**
+class DarkenStage : public LutStage {
+public:
+    explicit DarkenStage(double amount = 50);
+};
+
+// **Linear Contrast / Brightness: convertTo(-1, alpha, beta)**
+class ContrastStage : public LutStage {
+public:
+    explicit ContrastStage(double alpha = 1.2, double beta = 0);
+};
+
+// **Flash (Highlight) Reduction on Lab L, or on a Grey Plane**
+class FlashReduceStage : public EnhanceStage {
+public:
+    explicit FlashReduceStage(const FlashReduceParams& params = FlashReduceParams());
+    const char* name() const override { return "flash"; }
+    int outputType(int inputType) const override;
+    void prepare(cv::Size size, int type) override;
+    void process(const cv::Mat& src, cv::Mat& dst) override;
+
+private:
+    uchar tone_[256];
+    double sharpenWeight_;
+    cv::Mat lab_;
+};
+
+// **Scale HSV Saturation (main5 / main7: x1.3)**
+class SaturationStage : public EnhanceStage {
+public:
+    explicit SaturationStage(double factor = 1.3);
+    const char* name() const override { return "saturation"; }
+    int outputType(int inputType) const override;
+    void prepare(cv::Size size, int type) override;
+    void process(const cv::Mat& src, cv::Mat& dst) override;
+
+private:
+    cv::Mat lut_;  // 1 x 256 CV_8UC3: identity on H and V, scaled S
+    cv::Mat hsv_;
+};
+
+// **Software White Balance (main8; white_balance.h)**
+// The temperature constructor keeps main8's correction: blue scaled by
+// target / estimate and red by its inverse, where the estimate is
+// FrameStats::colorTemperature() of the frame. The WbConfig one selects a
+// gray-world, white-patch or percentile estimator. The gains are applied in
+// one fixed-point pass, or folded into the chain's composite LUT.
+class WhiteBalanceStage : public EnhanceStage {
+public:
+    explicit WhiteBalanceStage(double targetTemp = 6500);
+    explicit WhiteBalanceStage(const WbConfig& config);
+    const char* name() const override { return name_.c_str(); }
+    int outputType(int inputType) const override;
+    void process(const cv::Mat& src, cv::Mat& dst) override;
+    PointOpKind pointOpKind() const override { return FramePointOp; }
+    void pointLut(int type, const cv::Mat& frame, cv::Mat& lut) override;
+
+private:
+    SoftwareWhiteBalancer balancer_;
+    std::string name_;
+};
+
+// **Edge-Preserving Bilateral Smoothing (main2: 9, 75, 75)**
+class BilateralStage : public EnhanceStage {
+public:
+    BilateralStage(int diameter = 9, double sigmaColor = 75, double sigmaSpace = 75);
+    const char* name() const override { return "bilateral"; }
+    int outputType(int inputType) const override;
+    void process(const cv::Mat& src, cv::Mat& dst) override;
+
+private:
+    int diameter_;
+    double sigmaColor_, sigmaSpace_;
+};
+
+// **Text Overlay in the Style of the Live Programs**
+// setText() may be called from any thread; the latest text is drawn.
+class OverlayStage : public EnhanceStage {
+public:
+    explicit OverlayStage(cv::Point origin = cv::Point(20, 40), double scale = 0.6,
+                          cv::Scalar colour = cv::Scalar(0, 255, 0));
+    const char* name() const override { return "overlay"; }
+    int outputType(int inputType) const override;
+    void process(const cv::Mat& src, cv::Mat& dst) override;
+
+    void setText(const std::string& text);
+
+private:
+    cv::Point origin_;
+    double scale_;
+    cv::Scalar colour_;
+    std::mutex mutex_;
+    std::string text_;
+};
+
+// **Consecutive Point Operations Applied as One Composite LUT**
+// Built by EnhanceChainBuilder: N gamma / darken / white-balance stages in a
+// row become one cv::LUT pass. The static part of the table is composed when
+// the chain is planned; a leading frame-dependent stage is composed with it
+// per frame (256 entries per channel). The result is identical to running
+// the stages one after another.
+class FusedPointStage : public EnhanceStage {
+public:
+    explicit FusedPointStage(std::vector<std::unique_ptr<EnhanceStage>> stages);
+    const char* name() const override { return name_.c_str(); }
+    int outputType(int inputType) const override;
+    void prepare(cv::Size size, int type) override;
+    void process(const cv::Mat& src, cv::Mat& dst) override;
+
+    size_t fusedCount() const { return stages_.size(); }
+
+private:
+    std::vector<std::unique_ptr<EnhanceStage>> stages_;
+    std::string name_;          // "wb+gamma+darken"
+    bool frameDependent_ = false;
+    cv::Mat staticLut_;         // Composite of the static stages
+    cv::Mat frameLut_, lut_;    // Per-frame table of the leading stage, and the composite
+};
+
+// **Create a Stage from Its Name and Numeric Arguments**
+// Names and arguments (defaults in brackets):
+//   denoise[:h=1[:hColor=2]]     sharpen      (denoise-nlm is the same)
+//   denoise-guided[:h=3]   denoise-bilateral[:h=3[:hColor=3]]
+//   denoise-nlm-fast[:h=1[:hColor=2]]   (NL-means with a reduced window)
+//   temporal[:strength=0.75[:noise=6]]
+//   clahe[:clip=2[:temporal=0[:refresh=1]]]   clahe-rgb[:clip=2]
+//   gamma[:g=0.5]                darken[:amount=50]
+//   contrast[:alpha=1.2[:beta=0]]
+//   flash[:threshold=200[:reduction=0.7[:sharpen=0.4]]]
+//   flash-soft[:threshold=200[:reduction=0.75]]   (main3 curve, no sharpen)
+//   saturation[:factor=1.3]      wb[:target=6500]
+//   wb-gray   wb-white   wb-pct[:fraction=0.99]   (gains relative to green)
+//   bilateral[:d=9[:sigmaColor=75[:sigmaSpace=75]]]   overlay
+// Returns nullptr (and prints an error naming the stage and argument) for
+// unknown names, more arguments than the stage takes, or a value out of
+// range (e.g. gamma outside [0.05, 10], temporal strength of 1 or more).
+std::unique_ptr<EnhanceStage> createEnhanceStage(const std::string& name, const std::vector<double>& args);
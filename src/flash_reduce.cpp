@@ -0,0 +1,214 @@
+#include "flash_reduce.h"
+
+#include <linux/videodev2.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+// BORDER_REFLECT_101 index, as used by filter2D's default border
+inline int reflect101(int i, int n) {
+    if (n == 1) return 0;
+    if (i < 0) return -i;
+    if (i >= n) return 2 * n - 2 - i;
+    return i;
+}
+
+// **Load Channel 0 of a Row Through the Tone LUT, with One Reflected Pixel Each Side**
+inline void loadToneRow(const uchar* src, int cols, int cn, const uchar* tone, uchar* out) {
+    for (int x = 0; x < cols; x++) out[x + 1] = tone[src[x * cn]];
+    out[0] = out[reflect101(-1, cols) + 1];
+    out[cols + 1] = out[reflect101(cols, cols) + 1];
+}
+
+// **Blend of Centre and Sharpened Values**
+// When 10 * w is an even integer, (1 - w) * c + w * s is a multiple of 0.2
+// and can never round from exactly .5, so integer arithmetic reproduces
+// saturate_cast<uchar> on the double exactly. Other weights use a table
+// built with the double expression itself.
+struct Blender {
+    int tenths;               // 10 * w, or -1 when the table is used
+    std::vector<uchar> table; // 256 x 256, indexed [centre][sharpened]
+
+    explicit Blender(double w) : tenths(-1) {
+        int k = cvRound(w * 10);
+        if (std::abs(w * 10 - k) < 1e-9 && k % 2 == 0 && k >= 0 && k <= 10) {
+            tenths = k;
+            return;
+        }
+        table.resize(256 * 256);
+        for (int c = 0; c < 256; c++)
+            for (int s = 0; s < 256; s++)
+                table[c * 256 + s] = cv::saturate_cast<uchar>((1.0 - w) * c + w * s);
+    }
+};
+
+// **One Output Row: Sharpen the Middle Row and Blend**
+inline void sharpenBlendRow(const uchar* up, const uchar* cur, const uchar* dn, int cols,
+                            const Blender& blend, uchar* out) {
+    if (blend.tenths >= 0) {
+        const int wc = 10 - blend.tenths, ws = blend.tenths;
+        for (int x = 0; x < cols; x++) {
+            int c = cur[x + 1];
+            int s = 5 * c - cur[x] - cur[x + 2] - up[x + 1] - dn[x + 1];
+            s = std::min(std::max(s, 0), 255);
+            out[x] = static_cast<uchar>((wc * c + ws * s + 5) / 10);
+        }
+    } else {
+        const uchar* table = blend.table.data();
+        for (int x = 0; x < cols; x++) {
+            int c = cur[x + 1];
+            int s = 5 * c - cur[x] - cur[x + 2] - up[x + 1] - dn[x + 1];
+            s = std::min(std::max(s, 0), 255);
+            out[x] = table[c * 256 + s];
+        }
+    }
+}
+
+}  // namespace
+
+void buildFlashToneCurve(const FlashReduceParams& params, uchar lut[256]) {
+    for (int i = 0; i < 256; i++) {
+        if (i <= params.threshold) {
+            lut[i] = static_cast<uchar>(i);
+        } else if (params.softKnee) {
+            // Same float arithmetic as the main3.cpp loop
+            float factor = params.reduction + (1.0 - params.reduction) * ((255 - i) / static_cast<double>(255 - params.threshold));
+            lut[i] = cv::saturate_cast<uchar>(i * factor);
+        } else {
+            lut[i] = cv::saturate_cast<uchar>(i * params.reduction);
+        }
+    }
+}
+
+void compressHighlights(const cv::Mat& src, cv::Mat& dst, const uchar toneLut[256], double sharpenWeight) {
+    CV_Assert(src.depth() == CV_8U);
+    const int rows = src.rows, cols = src.cols, cn = src.channels();
+
+    const bool inPlace = dst.data == src.data && dst.size() == src.size() && dst.type() == src.type();
+    if (!inPlace) {
+        if (cn > 1) src.copyTo(dst);  // Keep the channels we do not touch
+        else dst.create(src.size(), src.type());
+    }
+    if (rows == 0 || cols == 0) return;
+
+    const int stripes = std::max(1, std::min(rows, cv::getNumThreads() * 4));
+    auto stripeBegin = [&](int i) { return static_cast<int>(static_cast<int64_t>(rows) * i / stripes); };
+
+    // **Tone Curve Only (No Sharpen)**
+    if (sharpenWeight <= 0.0) {
+        cv::parallel_for_(cv::Range(0, stripes), [&](const cv::Range& range) {
+            for (int y = stripeBegin(range.start); y < stripeBegin(range.end); y++) {
+                const uchar* s = src.ptr<uchar>(y);
+                uchar* d = dst.ptr<uchar>(y);
+                for (int x = 0; x < cols; x++) d[x * cn] = toneLut[s[x * cn]];
+            }
+        });
+        return;
+    }
+
+    const Blender blend(sharpenWeight);
+    const int w = cols + 2;
+
+    // Rows just outside each stripe, read before any stripe writes, so the
+    // kernel also works in place. Scratch vectors are kept per thread, so
+    // steady-state frames do not allocate.
+    static thread_local std::vector<uchar> haloRows;
+    std::vector<uchar>& halo = haloRows;
+    halo.resize(static_cast<size_t>(stripes) * 2 * w);
+    for (int i = 0; i < stripes; i++) {
+        loadToneRow(src.ptr<uchar>(reflect101(stripeBegin(i) - 1, rows)), cols, cn, toneLut, &halo[(2 * i) * w]);
+        loadToneRow(src.ptr<uchar>(reflect101(stripeBegin(i + 1), rows)), cols, cn, toneLut, &halo[(2 * i + 1) * w]);
+    }
+
+    cv::parallel_for_(cv::Range(0, stripes), [&](const cv::Range& range) {
+        static thread_local std::vector<uchar> buffer;  // The worker thread's own
+        buffer.resize(4 * static_cast<size_t>(w));
+        for (int i = range.start; i < range.end; i++) {
+            const int y0 = stripeBegin(i), y1 = stripeBegin(i + 1);
+            uchar* up = &buffer[0];
+            uchar* cur = &buffer[w];
+            uchar* dn = &buffer[2 * w];
+            uchar* out = &buffer[3 * w];
+
+            std::copy(&halo[(2 * i) * w], &halo[(2 * i) * w] + w, up);
+            loadToneRow(src.ptr<uchar>(y0), cols, cn, toneLut, cur);
+
+            for (int y = y0; y < y1; y++) {
+                // Read the next source row before this row is written
+                if (y + 1 < y1) loadToneRow(src.ptr<uchar>(y + 1), cols, cn, toneLut, dn);
+                else std::copy(&halo[(2 * i + 1) * w], &halo[(2 * i + 1) * w] + w, dn);
+
+                uchar* d = dst.ptr<uchar>(y);
+                if (cn == 1) {
+                    sharpenBlendRow(up, cur, dn, cols, blend, d);
+                } else {
+                    sharpenBlendRow(up, cur, dn, cols, blend, out);
+                    for (int x = 0; x < cols; x++) d[x * cn] = out[x];
+                }
+
+                std::swap(up, cur);
+                std::swap(cur, dn);
+            }
+        }
+    });
+}
+
+void reduceFlashPlane(cv::Mat& plane, const FlashReduceParams& params) {
+    CV_Assert(plane.type() == CV_8UC1);
+
+    uchar tone[256];
+    buildFlashToneCurve(params, tone);
+    compressHighlights(plane, plane, tone, params.sharpenWeight);
+}
+
+bool hasLumaPlane(uint32_t pixelFormat) {
+    switch (pixelFormat) {
+    case V4L2_PIX_FMT_YUYV:
+    case V4L2_PIX_FMT_NV12:
+    case V4L2_PIX_FMT_YUV420:
+    case V4L2_PIX_FMT_GREY:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool reduceFlashLuma(cv::Mat& image, uint32_t pixelFormat, const FlashReduceParams& params) {
+    uchar tone[256];
+    buildFlashToneCurve(params, tone);
+
+    switch (pixelFormat) {
+    case V4L2_PIX_FMT_YUYV:
+        // Y is channel 0 of the CV_8UC2 view; chroma bytes are not touched
+        compressHighlights(image, image, tone, params.sharpenWeight);
+        return true;
+    case V4L2_PIX_FMT_NV12:
+    case V4L2_PIX_FMT_YUV420: {
+        // Y is the top two thirds of the buffer; edit it through a view
+        cv::Mat y = image.rowRange(0, image.rows * 2 / 3);
+        compressHighlights(y, y, tone, params.sharpenWeight);
+        return true;
+    }
+    case V4L2_PIX_FMT_GREY:
+        compressHighlights(image, image, tone, params.sharpenWeight);
+        return true;
+    default:
+        return false;
+    }
+}
+
+void reduceFlashBGR(const cv::Mat& bgr, cv::Mat& result, const FlashReduceParams& params) {
+    static thread_local cv::Mat labFrame;  // Reused between frames
+    cv::Mat& lab = labFrame;
+    cv::cvtColor(bgr, lab, cv::COLOR_BGR2Lab);
+
+    // Channel 0 of the interleaved Lab image is edited in place
+    uchar tone[256];
+    buildFlashToneCurve(params, tone);
+    compressHighlights(lab, lab, tone, params.sharpenWeight);
+
+    cv::cvtColor(lab, result, cv::COLOR_Lab2BGR);
+}
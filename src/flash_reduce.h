@@ -0,0 +1,49 @@
+// Flash (highlight) reduction on a single lightness plane.
+// main4.cpp used to convert every frame BGR -> Lab, split it, edit L, merge
+// and convert back. Highlight compression and the sharpen/blend only need
+// one 8-bit plane, so these functions work directly on the Y plane of a
+// native YUYV / NV12 / I420 frame and leave chroma untouched.
+//
+// The per-pixel work is done by compressHighlights(): the tone curve is a
+// 256-entry LUT, the 3x3 sharpen and the blend are fused into the same row
+// sweep, and row stripes run in parallel. Its output is bit-exact with the
+// original at<uchar> loops of main3.cpp and main4.cpp (see bench_flash_reduce).
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <cstdint>
+
+// **Flash Reduction Parameters (Defaults Match main4.cpp)**
+struct FlashReduceParams {
+    int threshold = 200;         // Pixels brighter than this are compressed
+    double reduction = 0.7;      // Multiplier applied above the threshold
+    double sharpenWeight = 0.4;  // Weight of the sharpened plane in the blend (0 = no sharpen)
+    bool softKnee = false;       // main3.cpp curve: multiplier falls from 1.0 at the
+                                 // threshold to 'reduction' at 255
+};
+
+// **Tone Curve of the Parameters as a 256-Entry LUT**
+void buildFlashToneCurve(const FlashReduceParams& params, uchar lut[256]);
+
+// **Fused Tone Curve + 3x3 Sharpen + Blend on Channel 0 of an 8-Bit Image**
+// out = round((1 - w) * T(L) + w * clamp(5 T(L) - T(N) - T(S) - T(E) - T(W)))
+// with BORDER_REFLECT_101, the same as LUT -> filter2D -> blend. Other
+// channels are copied unchanged. dst may be src (in place).
+void compressHighlights(const cv::Mat& src, cv::Mat& dst, const uchar toneLut[256], double sharpenWeight);
+
+// **Compress Highlights, Sharpen and Blend One CV_8UC1 Plane In Place**
+void reduceFlashPlane(cv::Mat& plane, const FlashReduceParams& params = FlashReduceParams());
+
+// **Whether reduceFlashLuma Handles the Format**
+// True for YUYV, NV12, YUV420 and GREY; false for BGR24, MJPEG and the rest.
+bool hasLumaPlane(uint32_t pixelFormat);
+
+// **Flash Reduction on a Native-Format Frame, In Place**
+// Supports V4L2_PIX_FMT_YUYV, NV12, YUV420 and GREY. Only luma is modified.
+// Returns false for formats without a separable luma plane.
+bool reduceFlashLuma(cv::Mat& image, uint32_t pixelFormat, const FlashReduceParams& params = FlashReduceParams());
+
+// **Flash Reduction on a BGR Frame via the Lab L Channel**
+// For sources that only deliver BGR (or MJPEG); costs two colour conversions.
+void reduceFlashBGR(const cv::Mat& bgr, cv::Mat& result, const FlashReduceParams& params = FlashReduceParams());
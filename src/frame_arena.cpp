@@ -0,0 +1,111 @@
+#include "frame_arena.h"
+
+#include <algorithm>
+#include <iostream>
+#include <utility>
+
+namespace {
+
+const size_t kAlignment = 64;  // Cache line; also satisfies SIMD loads
+
+size_t alignUp(size_t n) {
+    return (n + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+}  // namespace
+
+// **Lease**
+FrameArena::Lease::Lease(const Lease& other) : arena_(other.arena_), slot_(other.slot_) {
+    if (arena_) arena_->slots_[slot_].references.fetch_add(1, std::memory_order_relaxed);
+}
+
+FrameArena::Lease::Lease(Lease&& other) noexcept : arena_(other.arena_), slot_(other.slot_) {
+    other.arena_ = nullptr;
+    other.slot_ = -1;
+}
+
+FrameArena::Lease& FrameArena::Lease::operator=(Lease other) noexcept {
+    std::swap(arena_, other.arena_);
+    std::swap(slot_, other.slot_);
+    return *this;  // other releases what this held
+}
+
+FrameArena::Lease::~Lease() {
+    release();
+}
+
+void FrameArena::Lease::release() {
+    if (!arena_) return;
+    if (arena_->slots_[slot_].references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        arena_->giveBack(slot_);
+    }
+    arena_ = nullptr;
+    slot_ = -1;
+}
+
+// **Arena**
+FrameArena::FrameArena(size_t slots) : slots_(std::max<size_t>(1, slots)), inUse_(0), exhausted_(0) {
+    for (auto& slot : slots_) slot.references = 0;
+}
+
+FrameArena::~FrameArena() {
+    if (inUse_ > 0) {
+        std::cerr << "Error: FrameArena destroyed with " << inUse_ << " slot(s) still leased\n";
+    }
+    cv::fastFree(block_);
+}
+
+int FrameArena::reserve(cv::Size size, int type) {
+    sizes_.push_back(size);
+    types_.push_back(type);
+    return static_cast<int>(sizes_.size()) - 1;
+}
+
+bool FrameArena::allocate() {
+    if (sizes_.empty()) {
+        std::cerr << "Error: FrameArena has no buffers reserved\n";
+        return false;
+    }
+
+    // **Lay Out Every Slot's Buffers in One Block**
+    std::vector<size_t> offsets;
+    size_t perSlot = 0;
+    for (size_t i = 0; i < sizes_.size(); i++) {
+        offsets.push_back(perSlot);
+        perSlot += alignUp(static_cast<size_t>(sizes_[i].area()) * CV_ELEM_SIZE(types_[i]));
+    }
+    cv::fastFree(block_);
+    bytes_ = perSlot * slots_.size();
+    block_ = static_cast<uchar*>(cv::fastMalloc(bytes_));
+
+    free_.clear();
+    free_.reserve(slots_.size());
+    for (size_t s = 0; s < slots_.size(); s++) {
+        uchar* base = block_ + s * perSlot;
+        slots_[s].buffers.clear();
+        for (size_t i = 0; i < sizes_.size(); i++) {
+            slots_[s].buffers.push_back(cv::Mat(sizes_[i], types_[i], base + offsets[i]));
+        }
+        free_.push_back(static_cast<int>(slots_.size() - 1 - s));  // Slot 0 handed out first
+    }
+    return true;
+}
+
+FrameArena::Lease FrameArena::acquire() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_.empty()) {
+        exhausted_++;
+        return Lease();
+    }
+    int slot = free_.back();
+    free_.pop_back();
+    slots_[slot].references = 1;
+    inUse_++;
+    return Lease(this, slot);
+}
+
+void FrameArena::giveBack(int slot) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_.push_back(slot);  // Within the reserved capacity
+    inUse_--;
+}
@@ -0,0 +1,84 @@
+// Preallocated per-frame buffers for the live programs.
+// A FrameArena holds a fixed number of slots; each slot is a set of Mats
+// (e.g. the BGR frame and the enhanced result) sized once from the stream's
+// negotiated resolution and format. Every frame acquires a slot as a Lease,
+// writes into the slot's Mats (views into one block allocated up front) and
+// travels through the pipeline with it. Dropping the last copy of the Lease
+// puts the slot back, so steady-state frames never touch the allocator.
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+class FrameArena {
+public:
+    // **A Slot on Loan; Copies Share It, the Last One Returns It**
+    class Lease {
+    public:
+        Lease() = default;
+        Lease(const Lease& other);
+        Lease(Lease&& other) noexcept;
+        Lease& operator=(Lease other) noexcept;
+        ~Lease();
+
+        explicit operator bool() const { return arena_ != nullptr; }
+
+        // Buffer i of the slot (the index returned by FrameArena::reserve()).
+        // The Mat does not own its data; keep the Lease alive while using it.
+        cv::Mat operator[](int i) const { return arena_->slots_[slot_].buffers[i]; }
+
+    private:
+        friend class FrameArena;
+        Lease(FrameArena* arena, int slot) : arena_(arena), slot_(slot) {}
+        void release();
+
+        FrameArena* arena_ = nullptr;
+        int slot_ = -1;
+    };
+
+    explicit FrameArena(size_t slots);
+    ~FrameArena();
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // **Describe One Buffer per Slot; Returns Its Index**
+    // Call before allocate().
+    int reserve(cv::Size size, int type);
+
+    // **Allocate Every Slot's Buffers in One Block**
+    // Returns false (and prints an error) if nothing was reserved.
+    bool allocate();
+
+    // A free slot, or an empty Lease if every slot is in use (counted in
+    // exhausted()); never allocates.
+    Lease acquire();
+
+    size_t slotCount() const { return slots_.size(); }
+    size_t inUse() const { return inUse_; }
+    size_t bytes() const { return bytes_; }
+    uint64_t exhausted() const { return exhausted_; }
+
+private:
+    struct Slot {
+        std::vector<cv::Mat> buffers;  // Headers into block_
+        std::atomic<int> references;
+    };
+
+    void giveBack(int slot);
+
+    std::vector<Slot> slots_;
+    std::vector<cv::Size> sizes_;
+    std::vector<int> types_;
+    uchar* block_ = nullptr;
+    size_t bytes_ = 0;
+
+    std::mutex mutex_;
+    std::vector<int> free_;  // Capacity reserved up front
+    std::atomic<size_t> inUse_;
+    std::atomic<uint64_t> exhausted_;
+};
@@ -0,0 +1,121 @@
+// Fixed-capacity ring buffer connecting the pipeline threads.
+// The producer never grows the buffer: when it is full the overflow policy
+// decides whether the oldest queued frame is dropped, the new frame is
+// dropped, or the producer waits for space.
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// **What to Do When a Ring Is Full**
+enum class OverflowPolicy {
+    DropOldest,  // Replace the oldest queued item (lowest latency)
+    DropNewest,  // Discard the item being pushed
+    Block,       // Wait until the consumer frees a slot
+};
+
+template <typename T>
+class FrameRing {
+public:
+    FrameRing(size_t capacity, OverflowPolicy policy)
+        : slots_(std::max<size_t>(1, capacity)), policy_(policy),
+          head_(0), count_(0), closed_(false),
+          pushed_(0), popped_(0), dropped_(0), maxDepth_(0) {}
+
+    FrameRing(const FrameRing&) = delete;
+    FrameRing& operator=(const FrameRing&) = delete;
+
+    // Returns false if the item was not queued (dropped or ring closed).
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (policy_ == OverflowPolicy::Block) {
+            notFull_.wait(lock, [this] { return closed_ || count_ < slots_.size(); });
+        }
+        if (closed_) return false;
+
+        if (count_ == slots_.size()) {
+            dropped_++;
+            if (policy_ == OverflowPolicy::DropNewest) return false;
+            // DropOldest: overwrite the head slot and advance
+            slots_[head_] = std::move(item);
+            head_ = (head_ + 1) % slots_.size();
+            pushed_++;
+            notEmpty_.notify_one();
+            return true;
+        }
+
+        slots_[(head_ + count_) % slots_.size()] = std::move(item);
+        count_++;
+        pushed_++;
+        maxDepth_ = std::max<uint64_t>(maxDepth_, count_);
+        notEmpty_.notify_one();
+        return true;
+    }
+
+    // Blocks until an item is available. Returns false once the ring is
+    // closed and drained.
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        notEmpty_.wait(lock, [this] { return closed_ || count_ > 0; });
+        return popLocked(item);
+    }
+
+    // Non-blocking pop; returns false if the ring is empty.
+    bool tryPop(T& item) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return popLocked(item);
+    }
+
+    // Wakes every waiter; pushes fail from now on, pops drain what is left.
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        notEmpty_.notify_all();
+        notFull_.notify_all();
+    }
+
+    size_t capacity() const { return slots_.size(); }
+    size_t depth() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return count_;
+    }
+    uint64_t maxDepth() const { return maxDepth_; }
+    uint64_t pushed() const { return pushed_; }
+    uint64_t popped() const { return popped_; }
+    uint64_t dropped() const { return dropped_; }
+
+private:
+    bool popLocked(T& item) {
+        if (count_ == 0) return false;
+        item = std::move(slots_[head_]);
+        slots_[head_] = T();  // Release the slot's buffer right away
+        head_ = (head_ + 1) % slots_.size();
+        count_--;
+        popped_++;
+        notFull_.notify_one();
+        return true;
+    }
+
+    std::vector<T> slots_;
+    const OverflowPolicy policy_;
+    size_t head_;
+    size_t count_;
+    bool closed_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable notEmpty_;
+    std::condition_variable notFull_;
+
+    std::atomic<uint64_t> pushed_;
+    std::atomic<uint64_t> popped_;
+    std::atomic<uint64_t> dropped_;
+    std::atomic<uint64_t> maxDepth_;
+};
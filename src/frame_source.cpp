@@ -0,0 +1,342 @@
+#include "frame_source.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+// **ioctl That Retries When Interrupted by a Signal**
+static int xioctl(int fd, unsigned long request, void* arg) {
+    int r;
+    do {
+        r = ioctl(fd, request, arg);
+    } while (r == -1 && errno == EINTR);
+    return r;
+}
+
+cv::Mat wrapPixelBuffer(void* data, size_t bytes, cv::Size size, uint32_t pixelFormat, size_t bytesPerLine) {
+    switch (pixelFormat) {
+    case V4L2_PIX_FMT_YUYV:
+        return cv::Mat(size.height, size.width, CV_8UC2, data, bytesPerLine ? bytesPerLine : size.width * 2);
+    case V4L2_PIX_FMT_NV12:
+    case V4L2_PIX_FMT_YUV420:
+        return cv::Mat(size.height * 3 / 2, size.width, CV_8UC1, data, bytesPerLine ? bytesPerLine : size.width);
+    case V4L2_PIX_FMT_BGR24:
+        return cv::Mat(size.height, size.width, CV_8UC3, data, bytesPerLine ? bytesPerLine : size.width * 3);
+    case V4L2_PIX_FMT_GREY:
+        return cv::Mat(size.height, size.width, CV_8UC1, data, bytesPerLine ? bytesPerLine : size.width);
+    case V4L2_PIX_FMT_MJPEG:
+        return cv::Mat(1, static_cast<int>(bytes), CV_8UC1, data);
+    default:
+        return cv::Mat();
+    }
+}
+
+size_t frameBytes(cv::Size size, uint32_t pixelFormat) {
+    size_t pixels = static_cast<size_t>(size.width) * size.height;
+    switch (pixelFormat) {
+    case V4L2_PIX_FMT_YUYV: return pixels * 2;
+    case V4L2_PIX_FMT_NV12:
+    case V4L2_PIX_FMT_YUV420: return pixels * 3 / 2;
+    case V4L2_PIX_FMT_BGR24: return pixels * 3;
+    case V4L2_PIX_FMT_GREY: return pixels;
+    default: return 0;
+    }
+}
+
+bool convertToBGR(const cv::Mat& image, uint32_t pixelFormat, cv::Mat& bgr) {
+    if (image.empty()) return false;
+
+    switch (pixelFormat) {
+    case V4L2_PIX_FMT_YUYV:
+        cv::cvtColor(image, bgr, cv::COLOR_YUV2BGR_YUYV);
+        return true;
+    case V4L2_PIX_FMT_NV12:
+        cv::cvtColor(image, bgr, cv::COLOR_YUV2BGR_NV12);
+        return true;
+    case V4L2_PIX_FMT_YUV420:
+        cv::cvtColor(image, bgr, cv::COLOR_YUV2BGR_I420);
+        return true;
+    case V4L2_PIX_FMT_BGR24:
+        bgr = image;  // Already BGR; shares the source buffer
+        return true;
+    case V4L2_PIX_FMT_GREY:
+        cv::cvtColor(image, bgr, cv::COLOR_GRAY2BGR);
+        return true;
+    case V4L2_PIX_FMT_MJPEG:
+        bgr = cv::imdecode(image, cv::IMREAD_COLOR);
+        return !bgr.empty();
+    default:
+        std::cerr << "Error: Unsupported pixel format 0x" << std::hex << pixelFormat << std::dec << "\n";
+        return false;
+    }
+}
+
+// **Device State Kept Alive by Outstanding Leases**
+struct V4L2MmapSource::Device {
+    struct Buffer {
+        void* start;
+        size_t length;
+    };
+
+    int fd = -1;
+    int wakeFd = -1;  // eventfd written by interrupt()
+    bool streaming = false;
+    std::vector<Buffer> buffers;
+
+    bool requeue(uint32_t index) {
+        struct v4l2_buffer buf;
+        std::memset(&buf, 0, sizeof(buf));
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = index;
+        if (xioctl(fd, VIDIOC_QBUF, &buf) == -1) {
+            std::cerr << "Error: VIDIOC_QBUF failed: " << std::strerror(errno) << "\n";
+            return false;
+        }
+        return true;
+    }
+
+    ~Device() {
+        if (streaming) {
+            int type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            xioctl(fd, VIDIOC_STREAMOFF, &type);
+        }
+        for (const Buffer& b : buffers) munmap(b.start, b.length);
+        if (fd >= 0) close(fd);
+        if (wakeFd >= 0) close(wakeFd);
+    }
+};
+
+V4L2MmapSource::V4L2MmapSource(const std::string& path, cv::Size size, uint32_t pixelFormat, int bufferCount)
+    : device_(std::make_shared<Device>()), size_(size), pixelFormat_(pixelFormat),
+      bytesPerLine_(0), sequence_(0) {
+    Device& dev = *device_;
+
+    dev.fd = open(path.c_str(), O_RDWR);
+    if (dev.fd < 0) {
+        std::cerr << "Error: Cannot open " << path << ": " << std::strerror(errno) << "\n";
+        device_.reset();
+        return;
+    }
+
+    // **Check Streaming Capture Support**
+    struct v4l2_capability cap;
+    std::memset(&cap, 0, sizeof(cap));
+    if (xioctl(dev.fd, VIDIOC_QUERYCAP, &cap) == -1) {
+        std::cerr << "Error: " << path << " is not a V4L2 device\n";
+        device_.reset();
+        return;
+    }
+    uint32_t caps = (cap.capabilities & V4L2_CAP_DEVICE_CAPS) ? cap.device_caps : cap.capabilities;
+    if (!(caps & V4L2_CAP_VIDEO_CAPTURE) || !(caps & V4L2_CAP_STREAMING)) {
+        std::cerr << "Error: " << path << " does not support streaming capture\n";
+        device_.reset();
+        return;
+    }
+
+    // **Negotiate Resolution and Pixel Format**
+    struct v4l2_format fmt;
+    std::memset(&fmt, 0, sizeof(fmt));
+    fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    fmt.fmt.pix.width = size.width;
+    fmt.fmt.pix.height = size.height;
+    fmt.fmt.pix.pixelformat = pixelFormat;
+    fmt.fmt.pix.field = V4L2_FIELD_ANY;
+    if (xioctl(dev.fd, VIDIOC_S_FMT, &fmt) == -1) {
+        std::cerr << "Error: VIDIOC_S_FMT failed: " << std::strerror(errno) << "\n";
+        device_.reset();
+        return;
+    }
+    size_ = cv::Size(fmt.fmt.pix.width, fmt.fmt.pix.height);
+    pixelFormat_ = fmt.fmt.pix.pixelformat;
+    bytesPerLine_ = fmt.fmt.pix.bytesperline;
+    if (pixelFormat_ != pixelFormat) {
+        std::cerr << "Warning: Driver chose pixel format 0x" << std::hex << pixelFormat_ << std::dec << "\n";
+    }
+
+    // **Allocate and Map Driver Buffers**
+    struct v4l2_requestbuffers req;
+    std::memset(&req, 0, sizeof(req));
+    req.count = bufferCount;
+    req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    req.memory = V4L2_MEMORY_MMAP;
+    if (xioctl(dev.fd, VIDIOC_REQBUFS, &req) == -1 || req.count < 2) {
+        std::cerr << "Error: VIDIOC_REQBUFS failed: " << std::strerror(errno) << "\n";
+        device_.reset();
+        return;
+    }
+
+    for (uint32_t i = 0; i < req.count; i++) {
+        struct v4l2_buffer buf;
+        std::memset(&buf, 0, sizeof(buf));
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = i;
+        if (xioctl(dev.fd, VIDIOC_QUERYBUF, &buf) == -1) {
+            std::cerr << "Error: VIDIOC_QUERYBUF failed: " << std::strerror(errno) << "\n";
+            device_.reset();
+            return;
+        }
+
+        // Writable so in-place stages can edit the frame without a copy
+        void* start = mmap(nullptr, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, dev.fd, buf.m.offset);
+        if (start == MAP_FAILED) {
+            std::cerr << "Error: mmap failed: " << std::strerror(errno) << "\n";
+            device_.reset();
+            return;
+        }
+        dev.buffers.push_back({start, buf.length});
+
+        if (!dev.requeue(i)) {
+            device_.reset();
+            return;
+        }
+    }
+
+    dev.wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (dev.wakeFd < 0) {
+        std::cerr << "Error: eventfd failed: " << std::strerror(errno) << "\n";
+        device_.reset();
+        return;
+    }
+
+    int type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if (xioctl(dev.fd, VIDIOC_STREAMON, &type) == -1) {
+        std::cerr << "Error: VIDIOC_STREAMON failed: " << std::strerror(errno) << "\n";
+        device_.reset();
+        return;
+    }
+    dev.streaming = true;
+}
+
+V4L2MmapSource::~V4L2MmapSource() = default;
+
+bool V4L2MmapSource::isOpened() const {
+    return device_ && device_->streaming;
+}
+
+bool V4L2MmapSource::read(CapturedFrame& frame) {
+    if (!isOpened()) return false;
+
+    // **Wait for a Frame or for interrupt(), Whichever Comes First**
+    // DQBUF alone would block until the camera delivers, however long it stalls.
+    struct pollfd fds[2] = {{device_->fd, POLLIN, 0}, {device_->wakeFd, POLLIN, 0}};
+    int ready;
+    do {
+        ready = poll(fds, 2, -1);
+    } while (ready == -1 && errno == EINTR);
+    if (ready == -1) {
+        std::cerr << "Error: poll on the capture device failed: " << std::strerror(errno) << "\n";
+        return false;
+    }
+    if (fds[1].revents & POLLIN) return false;  // Interrupted; the eventfd stays readable
+
+    struct v4l2_buffer buf;
+    std::memset(&buf, 0, sizeof(buf));
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf.memory = V4L2_MEMORY_MMAP;
+    if (xioctl(device_->fd, VIDIOC_DQBUF, &buf) == -1) {
+        std::cerr << "Error: VIDIOC_DQBUF failed: " << std::strerror(errno) << "\n";
+        return false;
+    }
+
+    const Device::Buffer& b = device_->buffers[buf.index];
+    std::shared_ptr<Device> device = device_;
+    uint32_t index = buf.index;
+
+    frame.image = wrapPixelBuffer(b.start, buf.bytesused, size_, pixelFormat_, bytesPerLine_);
+    frame.pixelFormat = pixelFormat_;
+    frame.sequence = sequence_++;
+    frame.lease = std::shared_ptr<void>(b.start, [device, index](void*) { device->requeue(index); });
+    return true;
+}
+
+void V4L2MmapSource::interrupt() {
+    if (!device_ || device_->wakeFd < 0) return;
+    uint64_t one = 1;
+    if (write(device_->wakeFd, &one, sizeof(one)) != sizeof(one)) {
+        std::cerr << "Error: Cannot interrupt the capture device: " << std::strerror(errno) << "\n";
+    }
+}
+
+// **One Copy-on-Write Mapping of the Raw File**
+struct RawFileSource::Mapping {
+    void* start = MAP_FAILED;
+    size_t length = 0;
+
+    ~Mapping() {
+        if (start != MAP_FAILED) munmap(start, length);
+    }
+};
+
+RawFileSource::RawFileSource(const std::string& path, cv::Size size, uint32_t pixelFormat, bool loop)
+    : fd_(-1), size_(size), pixelFormat_(pixelFormat), loop_(loop),
+      frameBytes_(frameBytes(size, pixelFormat)), frameCount_(0), next_(0), sequence_(0) {
+    if (frameBytes_ == 0) {
+        std::cerr << "Error: Raw file frames must use an uncompressed pixel format\n";
+        return;
+    }
+
+    fd_ = open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+        std::cerr << "Error: Cannot open " << path << ": " << std::strerror(errno) << "\n";
+        return;
+    }
+
+    mapping_ = mapFile();
+    if (mapping_) frameCount_ = mapping_->length / frameBytes_;
+    if (frameCount_ == 0) {
+        std::cerr << "Error: " << path << " does not hold a single " << size.width << "x" << size.height
+                  << " frame\n";
+    }
+}
+
+RawFileSource::~RawFileSource() {
+    if (fd_ >= 0) close(fd_);
+}
+
+std::shared_ptr<RawFileSource::Mapping> RawFileSource::mapFile() const {
+    struct stat st;
+    if (fstat(fd_, &st) != 0 || st.st_size <= 0) return nullptr;
+
+    // Private mapping: in-place processing edits a copy-on-write page and
+    // never reaches the file.
+    std::shared_ptr<Mapping> mapping = std::make_shared<Mapping>();
+    mapping->length = static_cast<size_t>(st.st_size);
+    mapping->start = mmap(nullptr, mapping->length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd_, 0);
+    if (mapping->start == MAP_FAILED) {
+        std::cerr << "Error: mmap failed: " << std::strerror(errno) << "\n";
+        return nullptr;
+    }
+    return mapping;
+}
+
+bool RawFileSource::read(CapturedFrame& frame) {
+    if (!isOpened()) return false;
+
+    if (next_ == frameCount_) {
+        if (!loop_) return false;
+        // Remap so frames edited in place on the last pass read as recorded
+        std::shared_ptr<Mapping> fresh = mapFile();
+        if (!fresh) return false;
+        mapping_ = fresh;
+        next_ = 0;
+    }
+
+    uchar* data = static_cast<uchar*>(mapping_->start) + next_ * frameBytes_;
+    next_++;
+
+    frame.image = wrapPixelBuffer(data, frameBytes_, size_, pixelFormat_);
+    frame.pixelFormat = pixelFormat_;
+    frame.sequence = sequence_++;
+    frame.lease = std::shared_ptr<void>(mapping_, data);  // Aliases the mapping's lifetime
+    return true;
+}
@@ -0,0 +1,117 @@
+// Frame sources that hand out frames without copying them.
+// A CapturedFrame's image is a cv::Mat header over memory owned by the
+// source (a driver buffer or a mapped file) in the source's native pixel
+// format. The buffer stays valid, and is not reused, for as long as any copy
+// of the frame's lease is alive.
+#pragma once
+
+#include <linux/videodev2.h>
+#include <opencv2/opencv.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// **One Frame as Delivered by a FrameSource**
+struct CapturedFrame {
+    cv::Mat image;                // Non-owning header, native format
+    uint32_t pixelFormat = 0;     // V4L2_PIX_FMT_* of image
+    uint64_t sequence = 0;
+    std::shared_ptr<void> lease;  // Returns the buffer when the last copy is dropped
+};
+
+// **Abstract Frame Source**
+class FrameSource {
+public:
+    virtual ~FrameSource() = default;
+
+    virtual bool isOpened() const = 0;
+
+    // Waits for the next frame. Returns false at end of stream or on error.
+    virtual bool read(CapturedFrame& frame) = 0;
+
+    // Makes a read() that is waiting return false, and every later one too,
+    // so a capture thread stuck on a stalled device can be joined. Safe to
+    // call from any thread. Sources whose read() never blocks for long
+    // leave it a no-op.
+    virtual void interrupt() {}
+
+    virtual cv::Size frameSize() const = 0;
+    virtual uint32_t pixelFormat() const = 0;
+};
+
+// **Wrap Raw Bytes in a Mat Header for the Given Pixel Format**
+// YUYV -> CV_8UC2 (h x w), NV12 / YUV420 -> CV_8UC1 (h*3/2 x w),
+// BGR24 -> CV_8UC3, GREY -> CV_8UC1, MJPEG -> CV_8UC1 (1 x bytes).
+// Returns an empty Mat for unsupported formats.
+cv::Mat wrapPixelBuffer(void* data, size_t bytes, cv::Size size, uint32_t pixelFormat, size_t bytesPerLine = 0);
+
+// **Size in Bytes of One Tightly Packed Frame (0 for Compressed Formats)**
+size_t frameBytes(cv::Size size, uint32_t pixelFormat);
+
+// **Convert a Native-Format Frame to BGR (Copies Only When Needed)**
+bool convertToBGR(const cv::Mat& image, uint32_t pixelFormat, cv::Mat& bgr);
+
+// **Streaming V4L2 Capture with mmap'd Driver Buffers**
+// Uses VIDIOC_REQBUFS / QBUF / DQBUF; a dequeued buffer is requeued when the
+// last copy of its CapturedFrame lease is released.
+class V4L2MmapSource : public FrameSource {
+public:
+    V4L2MmapSource(const std::string& path, cv::Size size,
+                   uint32_t pixelFormat = V4L2_PIX_FMT_YUYV, int bufferCount = 8);
+    ~V4L2MmapSource() override;
+
+    V4L2MmapSource(const V4L2MmapSource&) = delete;
+    V4L2MmapSource& operator=(const V4L2MmapSource&) = delete;
+
+    bool isOpened() const override;
+    bool read(CapturedFrame& frame) override;
+    void interrupt() override;
+    cv::Size frameSize() const override { return size_; }
+    uint32_t pixelFormat() const override { return pixelFormat_; }
+
+private:
+    struct Device;  // Shared with outstanding leases
+
+    std::shared_ptr<Device> device_;
+    cv::Size size_;
+    uint32_t pixelFormat_;
+    size_t bytesPerLine_;
+    uint64_t sequence_;
+};
+
+// **Raw Frames Read from a Memory-Mapped File**
+// The file holds tightly packed frames of one size and format back to back,
+// e.g. recorded with `v4l2-ctl --stream-mmap --stream-to=frames.yuv`.
+class RawFileSource : public FrameSource {
+public:
+    RawFileSource(const std::string& path, cv::Size size,
+                  uint32_t pixelFormat = V4L2_PIX_FMT_YUYV, bool loop = true);
+    ~RawFileSource() override;
+
+    RawFileSource(const RawFileSource&) = delete;
+    RawFileSource& operator=(const RawFileSource&) = delete;
+
+    bool isOpened() const override { return frameCount_ > 0; }
+    bool read(CapturedFrame& frame) override;
+    cv::Size frameSize() const override { return size_; }
+    uint32_t pixelFormat() const override { return pixelFormat_; }
+
+    size_t frameCount() const { return frameCount_; }
+
+private:
+    struct Mapping;
+
+    std::shared_ptr<Mapping> mapFile() const;
+
+    int fd_;
+    std::shared_ptr<Mapping> mapping_;
+    cv::Size size_;
+    uint32_t pixelFormat_;
+    bool loop_;
+    size_t frameBytes_;
+    size_t frameCount_;
+    size_t next_;
+    uint64_t sequence_;
+};
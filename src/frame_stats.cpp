@@ -0,0 +1,354 @@
+#include "frame_stats.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// Fixed-point constants used by cv::cvtColor for 8-bit BGR2GRAY and BGR2HSV
+const int kLumaShift = 14;
+const int kB2Y = 1868, kG2Y = 9617, kR2Y = 4899;
+const int kHsvShift = 12;
+
+// Rows are summed in 32-bit lanes so the compiler can vectorise the loop;
+// this many pixels keep the squared-luma sum below 2^32.
+const int kMaxChunk = 16384;
+
+// **Reciprocal Table for S = 255 * (max - min) / max**
+struct SaturationTable {
+    int div[256];
+    SaturationTable() {
+        div[0] = 0;
+        for (int i = 1; i < 256; i++)
+            div[i] = cv::saturate_cast<int>((255 << kHsvShift) / (1. * i));
+    }
+};
+
+const SaturationTable& saturationTable() {
+    static const SaturationTable table;
+    return table;
+}
+
+struct StatsSums {
+    uint64_t b = 0, g = 0, r = 0, y = 0, yy = 0, s = 0;
+
+    void add(const StatsSums& o) {
+        b += o.b; g += o.g; r += o.r; y += o.y; yy += o.yy; s += o.s;
+    }
+};
+
+// **Accumulate One Row Segment of Interleaved BGR Pixels**
+void accumulateRow(const uchar* p, int count, const int* sdiv, StatsSums& out) {
+    for (int start = 0; start < count; start += kMaxChunk) {
+        int end = std::min(count, start + kMaxChunk);
+        uint32_t sb = 0, sg = 0, sr = 0, sy = 0, syy = 0, ss = 0;
+
+        for (int x = start; x < end; x++) {
+            int b = p[3 * x], g = p[3 * x + 1], r = p[3 * x + 2];
+            int y = (b * kB2Y + g * kG2Y + r * kR2Y + (1 << (kLumaShift - 1))) >> kLumaShift;
+            int v = std::max(b, std::max(g, r));
+            int vmin = std::min(b, std::min(g, r));
+            int s = ((v - vmin) * sdiv[v] + (1 << (kHsvShift - 1))) >> kHsvShift;
+
+            sb += b; sg += g; sr += r;
+            sy += y; syy += y * y;
+            ss += s;
+        }
+
+        out.b += sb; out.g += sg; out.r += sr;
+        out.y += sy; out.yy += syy; out.s += ss;
+    }
+}
+
+// **Sums Needed for the Sampled Statistics and Their Standard Errors**
+struct SampleSums {
+    uint64_t n = 0;
+    uint64_t b = 0, g = 0, r = 0, y = 0, s = 0;
+    uint64_t bb = 0, gg = 0, rr = 0, yy = 0, ss = 0, rb = 0;
+
+    void add(const SampleSums& o) {
+        n += o.n;
+        b += o.b; g += o.g; r += o.r; y += o.y; s += o.s;
+        bb += o.bb; gg += o.gg; rr += o.rr; yy += o.yy; ss += o.ss; rb += o.rb;
+    }
+};
+
+inline void accumulatePixel(const uchar* p, const int* sdiv, SampleSums& out) {
+    int b = p[0], g = p[1], r = p[2];
+    int y = (b * kB2Y + g * kG2Y + r * kR2Y + (1 << (kLumaShift - 1))) >> kLumaShift;
+    int v = std::max(b, std::max(g, r));
+    int vmin = std::min(b, std::min(g, r));
+    int s = ((v - vmin) * sdiv[v] + (1 << (kHsvShift - 1))) >> kHsvShift;
+
+    out.n++;
+    out.b += b; out.g += g; out.r += r; out.y += y; out.s += s;
+    out.bb += b * b; out.gg += g * g; out.rr += r * r;
+    out.yy += y * y; out.ss += s * s; out.rb += r * b;
+}
+
+// **Stateless Hash Used to Pick the Pixel in Each Random Cell**
+inline uint64_t mixBits(uint64_t x) {
+    x ^= x >> 30; x *= 0xBF58476D1CE4E5B9ull;
+    x ^= x >> 27; x *= 0x94D049BB133111EBull;
+    x ^= x >> 31;
+    return x;
+}
+
+// **Add One Pixel to the B / G / R / Luma / Saturation Histograms**
+inline void countPixel(const uchar* p, const int* sdiv, FrameHistograms& h) {
+    int b = p[0], g = p[1], r = p[2];
+    int y = (b * kB2Y + g * kG2Y + r * kR2Y + (1 << (kLumaShift - 1))) >> kLumaShift;
+    int v = std::max(b, std::max(g, r));
+    int vmin = std::min(b, std::min(g, r));
+    int s = ((v - vmin) * sdiv[v] + (1 << (kHsvShift - 1))) >> kHsvShift;
+
+    h.bins[FrameHistograms::Blue][b]++;
+    h.bins[FrameHistograms::Green][g]++;
+    h.bins[FrameHistograms::Red][r]++;
+    h.bins[FrameHistograms::Luma][y]++;
+    h.bins[FrameHistograms::Saturation][std::min(s, 255)]++;
+}
+
+}  // namespace
+
+FrameStats computeFrameStats(const cv::Mat& bgr) {
+    FrameStats stats;
+    if (bgr.empty() || bgr.type() != CV_8UC3) return stats;
+
+    const int* sdiv = saturationTable().div;
+    const int rows = bgr.rows, cols = bgr.cols;
+
+    // One partial sum per stripe, merged after the parallel loop. The vector
+    // is kept per calling thread, so steady-state frames do not allocate.
+    int stripes = std::max(1, std::min(rows, cv::getNumThreads() * 4));
+    static thread_local std::vector<StatsSums> partialSums;
+    std::vector<StatsSums>& partial = partialSums;
+    partial.assign(stripes, StatsSums());
+
+    cv::parallel_for_(cv::Range(0, stripes), [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; i++) {
+            int y0 = static_cast<int>(static_cast<int64_t>(rows) * i / stripes);
+            int y1 = static_cast<int>(static_cast<int64_t>(rows) * (i + 1) / stripes);
+            for (int y = y0; y < y1; y++)
+                accumulateRow(bgr.ptr<uchar>(y), cols, sdiv, partial[i]);
+        }
+    });
+
+    StatsSums total;
+    for (const StatsSums& s : partial) total.add(s);
+
+    double n = static_cast<double>(rows) * cols;
+    stats.meanB = total.b / n;
+    stats.meanG = total.g / n;
+    stats.meanR = total.r / n;
+    stats.lumaMean = total.y / n;
+    stats.lumaVariance = std::max(0.0, total.yy / n - stats.lumaMean * stats.lumaMean);
+    stats.saturationMean = total.s / n;
+    return stats;
+}
+
+SampledFrameStats computeFrameStats(const cv::Mat& bgr, const SamplingConfig& config) {
+    SampledFrameStats result;
+    if (bgr.empty() || bgr.type() != CV_8UC3) return result;
+
+    cv::Rect frameRect(0, 0, bgr.cols, bgr.rows);
+    cv::Rect roi = config.roi.empty() ? frameRect : (config.roi & frameRect);
+    if (roi.empty()) return result;
+
+    result.population = static_cast<size_t>(roi.width) * roi.height;
+    const int stride = std::max(1, config.stride);
+
+    if (config.mode == SamplingConfig::Full || stride == 1) {
+        result.stats = computeFrameStats(bgr(roi));
+        result.samples = result.population;
+        return result;  // Exact, so all errors stay zero
+    }
+
+    // One sample per stride x stride cell; edge cells may be smaller
+    const int cellRows = (roi.height + stride - 1) / stride;
+    const int cellCols = (roi.width + stride - 1) / stride;
+    const int* sdiv = saturationTable().div;
+    const bool random = config.mode == SamplingConfig::Random;
+
+    int stripes = std::max(1, std::min(cellRows, cv::getNumThreads() * 4));
+    static thread_local std::vector<SampleSums> partialSums;
+    std::vector<SampleSums>& partial = partialSums;
+    partial.assign(stripes, SampleSums());
+
+    cv::parallel_for_(cv::Range(0, stripes), [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; i++) {
+            int c0 = static_cast<int>(static_cast<int64_t>(cellRows) * i / stripes);
+            int c1 = static_cast<int>(static_cast<int64_t>(cellRows) * (i + 1) / stripes);
+            for (int cy = c0; cy < c1; cy++) {
+                int top = roi.y + cy * stride;
+                int cellH = std::min(stride, roi.y + roi.height - top);
+                for (int cx = 0; cx < cellCols; cx++) {
+                    int left = roi.x + cx * stride;
+                    int cellW = std::min(stride, roi.x + roi.width - left);
+                    int ox, oy;
+                    if (random) {
+                        uint64_t h = mixBits(config.seed ^ (static_cast<uint64_t>(cy) << 32 | static_cast<uint32_t>(cx)));
+                        ox = static_cast<int>((h & 0xFFFFFFFFu) % static_cast<uint32_t>(cellW));
+                        oy = static_cast<int>((h >> 32) % static_cast<uint32_t>(cellH));
+                    } else {
+                        ox = std::min(stride / 2, cellW - 1);
+                        oy = std::min(stride / 2, cellH - 1);
+                    }
+                    accumulatePixel(bgr.ptr<uchar>(top + oy) + 3 * (left + ox), sdiv, partial[i]);
+                }
+            }
+        }
+    });
+
+    SampleSums t;
+    for (const SampleSums& p : partial) t.add(p);
+
+    const double n = static_cast<double>(t.n);
+    const double N = static_cast<double>(result.population);
+    result.samples = t.n;
+
+    FrameStats& st = result.stats;
+    st.meanB = t.b / n;
+    st.meanG = t.g / n;
+    st.meanR = t.r / n;
+    st.lumaMean = t.y / n;
+    st.lumaVariance = std::max(0.0, t.yy / n - st.lumaMean * st.lumaMean);
+    st.saturationMean = t.s / n;
+
+    if (t.n < 2) return result;
+
+    // Sample variances (Bessel-corrected) and the finite population correction
+    const double bessel = n / (n - 1.0);
+    const double fpc = (N > 1.0) ? std::max(0.0, (N - n) / (N - 1.0)) : 0.0;
+    auto variance = [&](uint64_t sum, uint64_t sumSq) {
+        double m = sum / n;
+        return std::max(0.0, sumSq / n - m * m) * bessel;
+    };
+    auto standardError = [&](double var) { return std::sqrt(var / n * fpc); };
+
+    double varB = variance(t.b, t.bb);
+    double varR = variance(t.r, t.rr);
+    result.meanBError = standardError(varB);
+    result.meanGError = standardError(variance(t.g, t.gg));
+    result.meanRError = standardError(varR);
+    result.lumaMeanError = standardError(variance(t.y, t.yy));
+    result.saturationError = standardError(variance(t.s, t.ss));
+
+    // Standard deviation of a roughly normal population: sigma / sqrt(2n)
+    result.contrastError = st.contrast() * std::sqrt(fpc / (2.0 * n));
+
+    // Delta method for the ratio of two correlated means
+    double covRB = (t.rb / n - st.meanR * st.meanB) * bessel;
+    double ratio = st.redBlueRatio();
+    double denom = st.meanB + 1e-6;
+    double varRatio = (varR + ratio * ratio * varB - 2.0 * ratio * covRB) / (denom * denom);
+    result.redBlueRatioError = standardError(std::max(0.0, varRatio));
+
+    return result;
+}
+
+// **Histograms**
+void FrameHistograms::clear() {
+    std::memset(bins, 0, sizeof(bins));
+    pixels = 0;
+}
+
+void FrameHistograms::add(const FrameHistograms& other) {
+    for (int c = 0; c < kChannels; c++)
+        for (int i = 0; i < 256; i++) bins[c][i] += other.bins[c][i];
+    pixels += other.pixels;
+}
+
+double FrameHistograms::mean(Channel c) const {
+    if (pixels == 0) return 0.0;
+    uint64_t sum = 0;
+    for (int i = 0; i < 256; i++) sum += static_cast<uint64_t>(i) * bins[c][i];
+    return static_cast<double>(sum) / pixels;
+}
+
+double FrameHistograms::variance(Channel c) const {
+    if (pixels == 0) return 0.0;
+    uint64_t sum = 0, sumSq = 0;
+    for (int i = 0; i < 256; i++) {
+        sum += static_cast<uint64_t>(i) * bins[c][i];
+        sumSq += static_cast<uint64_t>(i * i) * bins[c][i];
+    }
+    double m = static_cast<double>(sum) / pixels;
+    return std::max(0.0, static_cast<double>(sumSq) / pixels - m * m);
+}
+
+int FrameHistograms::percentile(Channel c, double fraction) const {
+    if (pixels == 0) return 0;
+    const double target = std::min(std::max(fraction, 0.0), 1.0) * pixels;
+    uint64_t seen = 0;
+    for (int i = 0; i < 256; i++) {
+        seen += bins[c][i];
+        if (seen > 0 && seen >= target) return i;
+    }
+    return 255;
+}
+
+double FrameHistograms::fractionAbove(Channel c, int level) const {
+    if (pixels == 0) return 0.0;
+    uint64_t above = 0;
+    for (int i = std::max(level + 1, 0); i < 256; i++) above += bins[c][i];
+    return static_cast<double>(above) / pixels;
+}
+
+FrameStats FrameHistograms::frameStats() const {
+    FrameStats stats;
+    stats.meanB = mean(Blue);
+    stats.meanG = mean(Green);
+    stats.meanR = mean(Red);
+    stats.lumaMean = mean(Luma);
+    stats.lumaVariance = variance(Luma);
+    stats.saturationMean = mean(Saturation);
+    return stats;
+}
+
+// **Analyzer**
+FrameAnalyzer::FrameAnalyzer() {
+    histograms_.clear();
+}
+
+const FrameHistograms& FrameAnalyzer::analyze(const cv::Mat& bgr, uint64_t frameId, int stride) {
+    stride = std::max(1, stride);
+    if (valid_ && frameId == frameId_ && stride == stride_) return histograms_;
+
+    histograms_.clear();
+    valid_ = true;
+    frameId_ = frameId;
+    stride_ = stride;
+    if (bgr.empty() || bgr.type() != CV_8UC3) return histograms_;
+
+    const int* sdiv = saturationTable().div;
+    const int cellRows = (bgr.rows + stride - 1) / stride;
+    const int cellCols = (bgr.cols + stride - 1) / stride;
+
+    const int stripes = std::max(1, std::min(cellRows, cv::getNumThreads() * 4));
+    partial_.resize(stripes);
+
+    cv::parallel_for_(cv::Range(0, stripes), [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; i++) {
+            FrameHistograms& h = partial_[i];
+            h.clear();
+            int c0 = static_cast<int>(static_cast<int64_t>(cellRows) * i / stripes);
+            int c1 = static_cast<int>(static_cast<int64_t>(cellRows) * (i + 1) / stripes);
+            for (int cy = c0; cy < c1; cy++) {
+                // Centre of each cell, clamped into the (smaller) edge cells
+                int top = cy * stride;
+                const uchar* row = bgr.ptr<uchar>(top + std::min(stride / 2, bgr.rows - top - 1));
+                for (int cx = 0; cx < cellCols; cx++) {
+                    int left = cx * stride;
+                    countPixel(row + 3 * (left + std::min(stride / 2, bgr.cols - left - 1)), sdiv, h);
+                }
+            }
+            h.pixels = static_cast<uint64_t>(c1 - c0) * cellCols;
+        }
+    });
+
+    for (const FrameHistograms& h : partial_) histograms_.add(h);
+    return histograms_;
+}
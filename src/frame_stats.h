@@ -0,0 +1,151 @@
+// Fused single-pass frame statistics.
+// Reads a BGR frame once and produces everything the estimate* helpers used
+// to compute with separate cv::mean / cvtColor / meanStdDev passes. A sampled
+// mode reads only a subset of pixels and reports how far its estimates are
+// expected to be from the full-frame values. FrameAnalyzer goes one step
+// further and keeps 256-bin histograms of the frame, from which means,
+// variances, percentiles and clipped fractions all follow in O(256).
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// **Statistics of One BGR Frame**
+struct FrameStats {
+    double meanB = 0.0, meanG = 0.0, meanR = 0.0;  // Per-channel means
+    double lumaMean = 0.0;                         // Mean of BGR2GRAY luma
+    double lumaVariance = 0.0;                     // Population variance of luma
+    double saturationMean = 0.0;                   // Mean of HSV S channel (0-255)
+
+    // Same definition as estimateBrightness(): average of the channel means
+    double brightness() const { return (meanB + meanG + meanR) / 3.0; }
+
+    // Same definition as estimateContrast(): standard deviation of grayscale
+    double contrast() const { return std::sqrt(lumaVariance); }
+
+    // Same definition as estimateSaturation(): mean of the HSV S channel
+    double saturation() const { return saturationMean; }
+
+    // Red/blue ratio used by every colour temperature estimate in the repo
+    double redBlueRatio() const { return meanR / (meanB + 1e-6); }
+
+    // Same definition as estimateColorTemperature() in main8.cpp / main9.cpp
+    double colorTemperature() const {
+        double temp = 10000 * redBlueRatio();
+        return std::min(std::max(temp, 1000.0), 15000.0);
+    }
+};
+
+// **Colour Temperature from the R/B Ratio, Power-Law Fit (1000K - 10000K)**
+// The estimate used by main.cpp, main10.cpp, wb_smooth.cpp and WB_Rawwork.cpp
+// to drive the camera's white_balance_temperature control. Not rounded.
+inline double kelvinFromRedBlueRatio(double ratio) {
+    double temp = (ratio > 1.0) ? (4500.0 * std::pow(ratio, 1.2)) : (4500.0 / std::pow(1.0 / ratio, 1.2));
+    return std::min(std::max(temp, 1000.0), 10000.0);
+}
+
+// **Compute All Frame Metrics in One Pass Over a CV_8UC3 BGR Image**
+// Luma and saturation use the same fixed-point arithmetic as cv::cvtColor,
+// so the results match the old multi-pass estimators. No Mats are allocated.
+FrameStats computeFrameStats(const cv::Mat& bgr);
+
+// **Pixel Subset Used by the Sampled Statistics**
+struct SamplingConfig {
+    enum Mode {
+        Full,    // Every pixel
+        Grid,    // Centre pixel of every stride x stride cell
+        Random,  // One pseudo-random pixel per stride x stride cell
+    };
+
+    Mode mode = Full;
+    int stride = 4;          // 4 reads 1/16 of the pixels, 8 reads 1/64
+    cv::Rect roi;            // Empty = whole frame
+    uint64_t seed = 0x9E3779B97F4A7C15ull;  // Random mode only
+
+    static SamplingConfig grid(int stride) {
+        SamplingConfig c;
+        c.mode = Grid;
+        c.stride = stride;
+        return c;
+    }
+    static SamplingConfig random(int stride, uint64_t seed = 0x9E3779B97F4A7C15ull) {
+        SamplingConfig c;
+        c.mode = Random;
+        c.stride = stride;
+        c.seed = seed;
+        return c;
+    }
+};
+
+// **Sampled Statistics with Expected Error Against the Full Frame**
+// Errors are one standard error, estimated from the sample variance with the
+// finite population correction. They treat the subset as a random sample,
+// which is conservative for grid sampling of natural images.
+struct SampledFrameStats {
+    FrameStats stats;
+    size_t samples = 0;     // Pixels read
+    size_t population = 0;  // Pixels in the ROI
+
+    double meanBError = 0.0, meanGError = 0.0, meanRError = 0.0;
+    double lumaMeanError = 0.0;
+    double contrastError = 0.0;
+    double saturationError = 0.0;
+    double redBlueRatioError = 0.0;
+
+    // Error of FrameStats::colorTemperature(), ignoring the clamp
+    double colorTemperatureError() const { return 10000 * redBlueRatioError; }
+};
+
+// **Compute Frame Metrics on a Subset of a CV_8UC3 BGR Image**
+SampledFrameStats computeFrameStats(const cv::Mat& bgr, const SamplingConfig& config);
+
+// **256-Bin Histograms of One Frame: B, G, R, Luma and HSV Saturation**
+// Luma and saturation are the values computeFrameStats() averages, so
+// frameStats() reproduces it exactly for the same pixels.
+struct FrameHistograms {
+    enum Channel { Blue, Green, Red, Luma, Saturation, kChannels };
+
+    uint32_t bins[kChannels][256];
+    uint64_t pixels = 0;
+
+    void clear();
+    void add(const FrameHistograms& other);
+
+    double mean(Channel c) const;
+    double variance(Channel c) const;  // Population variance
+    // Smallest value with at least fraction of the pixels at or below it
+    int percentile(Channel c, double fraction) const;
+    // Share of pixels above level, e.g. fractionAbove(Luma, 250) for clipped highlights
+    double fractionAbove(Channel c, int level) const;
+
+    double redBlueRatio() const { return mean(Red) / (mean(Blue) + 1e-6); }
+    FrameStats frameStats() const;
+};
+
+// **Per-Frame Histogram Cache**
+// Stages and controllers that need statistics of the same frame call
+// analyze() with the frame's id (e.g. FramePacket::sequence); only the
+// first call reads pixels. Built in parallel stripes into buffers kept
+// between frames. stride > 1 reads the centre pixel of every
+// stride x stride cell, like SamplingConfig::grid().
+class FrameAnalyzer {
+public:
+    FrameAnalyzer();
+
+    const FrameHistograms& analyze(const cv::Mat& bgr, uint64_t frameId, int stride = 1);
+
+    const FrameHistograms& histograms() const { return histograms_; }
+    void invalidate() { valid_ = false; }
+
+private:
+    FrameHistograms histograms_;
+    bool valid_ = false;
+    uint64_t frameId_ = 0;
+    int stride_ = 1;
+    std::vector<FrameHistograms> partial_;  // One per stripe
+};
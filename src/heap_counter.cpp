@@ -0,0 +1,42 @@
+// Counting replacements for the global operator new / delete.
+// Kept out of openscope_core: a replacement operator new applies to the
+// whole program, so only the programs that report heap allocations per
+// frame (main4, main5, main7, main8) compile this file in. Every allocation
+// is counted through countHeapAllocation() and then served by malloc.
+
+#include <cstdlib>
+#include <new>
+
+#include "alloc_counter.h"
+
+void* operator new(std::size_t size) {
+    countHeapAllocation();
+    if (size == 0) size = 1;
+    for (;;) {
+        if (void* p = std::malloc(size)) return p;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+
+void* operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    countHeapAllocation();
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    countHeapAllocation();
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
@@ -0,0 +1,149 @@
+#include "latency_stats.h"
+
+#include <algorithm>
+
+namespace {
+
+// **Bucket of a Duration: Exact Below 32 us, Then 16 Sub-Buckets per Octave**
+int bucketOf(uint64_t us) {
+    if (us < 32) return static_cast<int>(us);
+    int octave = 63 - __builtin_clzll(us);  // >= 5
+    int sub = static_cast<int>((us >> (octave - 4)) & 15);
+    int index = 32 + (octave - 5) * 16 + sub;
+    return index < LatencyHistogram::kBuckets ? index : LatencyHistogram::kBuckets - 1;
+}
+
+// Midpoint of a bucket, in microseconds
+double bucketMidpoint(int index) {
+    if (index < 32) return index;
+    int octave = (index - 32) / 16 + 5, sub = (index - 32) % 16;
+    double width = static_cast<double>(1ull << (octave - 4));
+    return (16 + sub) * width + width / 2;
+}
+
+}  // namespace
+
+// **Histogram**
+LatencyHistogram::LatencyHistogram() : sumUs_(0), maxUs_(0) {
+    for (auto& bucket : buckets_) bucket.store(0, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::record(std::chrono::steady_clock::duration elapsed) {
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    recordMicros(us > 0 ? static_cast<uint64_t>(us) : 0);
+}
+
+void LatencyHistogram::recordMicros(uint64_t us) {
+    buckets_[bucketOf(us)].fetch_add(1, std::memory_order_relaxed);
+    sumUs_.fetch_add(us, std::memory_order_relaxed);
+    uint64_t max = maxUs_.load(std::memory_order_relaxed);
+    while (us > max && !maxUs_.compare_exchange_weak(max, us, std::memory_order_relaxed)) {}
+}
+
+LatencySummary LatencyHistogram::summarize(bool resetAfter) {
+    // Snapshot the buckets first; the total is taken from the snapshot so
+    // the percentiles are consistent with each other
+    std::array<uint64_t, kBuckets> counts;
+    uint64_t total = 0;
+    for (int i = 0; i < kBuckets; i++) {
+        counts[i] = resetAfter ? buckets_[i].exchange(0, std::memory_order_relaxed)
+                               : buckets_[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    uint64_t sum = resetAfter ? sumUs_.exchange(0, std::memory_order_relaxed) : sumUs_.load(std::memory_order_relaxed);
+    uint64_t max = resetAfter ? maxUs_.exchange(0, std::memory_order_relaxed) : maxUs_.load(std::memory_order_relaxed);
+
+    LatencySummary s;
+    s.count = total;
+    if (total == 0) return s;
+    s.meanMs = sum / 1000.0 / total;
+    s.maxMs = max / 1000.0;
+
+    const double targets[] = {0.50, 0.95, 0.99};
+    double* outputs[] = {&s.p50Ms, &s.p95Ms, &s.p99Ms};
+    uint64_t seen = 0;
+    int next = 0;
+    for (int i = 0; i < kBuckets && next < 3; i++) {
+        seen += counts[i];
+        while (next < 3 && seen >= targets[next] * total) {
+            *outputs[next] = std::min(bucketMidpoint(i) / 1000.0, s.maxMs);
+            next++;
+        }
+    }
+    return s;
+}
+
+// **Registry**
+LatencyHistogram& LatencyRegistry::stage(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int n = count_.load();
+    for (int i = 0; i < n; i++)
+        if (names_[i] == name) return *histograms_[i];
+
+    int slot = n < kMaxStages ? n : kMaxStages;
+    if (!histograms_[slot]) {
+        names_[slot] = n < kMaxStages ? name : "(other)";
+        histograms_[slot].reset(new LatencyHistogram());
+        count_.store(slot + 1);  // Published after the histogram exists
+    }
+    return *histograms_[slot];
+}
+
+void LatencyRegistry::print(std::FILE* out, bool resetAfter) {
+    const int n = count_.load();
+    for (int i = 0; i < n; i++) {
+        LatencySummary s = histograms_[i]->summarize(resetAfter);
+        if (s.count == 0) continue;
+        std::fprintf(out, "  %-22s n=%-7llu mean=%8.3f p50=%8.3f p95=%8.3f p99=%8.3f max=%8.3f ms\n",
+                     names_[i].c_str(), static_cast<unsigned long long>(s.count),
+                     s.meanMs, s.p50Ms, s.p95Ms, s.p99Ms, s.maxMs);
+    }
+    std::fflush(out);
+}
+
+LatencyRegistry& latencyRegistry() {
+    static LatencyRegistry registry;
+    return registry;
+}
+
+// **Reporter**
+LatencyReporter::LatencyReporter(LatencyRegistry& registry, double intervalSeconds, const std::string& path)
+    : registry_(registry), interval_(intervalSeconds > 0 ? intervalSeconds : 5.0),
+      out_(stdout), ownsFile_(false), last_(std::chrono::steady_clock::now()) {
+    if (!path.empty()) {
+        out_ = std::fopen(path.c_str(), "a");
+        ownsFile_ = out_ != nullptr;
+        if (!out_) {
+            std::fprintf(stderr, "Error: Cannot open latency log %s, using stdout\n", path.c_str());
+            out_ = stdout;
+        }
+    }
+    thread_ = std::thread(&LatencyReporter::loop, this);
+}
+
+LatencyReporter::~LatencyReporter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    thread_.join();
+    dump();
+    if (ownsFile_) std::fclose(out_);
+}
+
+void LatencyReporter::loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!wake_.wait_for(lock, interval_, [this] { return stopping_; })) {
+        lock.unlock();
+        dump();
+        lock.lock();
+    }
+}
+
+void LatencyReporter::dump() {
+    auto now = std::chrono::steady_clock::now();
+    std::fprintf(out_, "Latency (last %.1f s):\n", std::chrono::duration<double>(now - last_).count());
+    last_ = now;
+    registry_.print(out_, true);
+}
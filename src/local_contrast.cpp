@@ -0,0 +1,158 @@
+#include "local_contrast.h"
+
+#include <algorithm>
+#include <cmath>
+
+LocalContrastEnhancer::LocalContrastEnhancer(const LocalContrastConfig& config) : config_(config) {
+    config_.tileGrid.width = std::max(config_.tileGrid.width, 1);
+    config_.tileGrid.height = std::max(config_.tileGrid.height, 1);
+    config_.temporalWeight = std::min(std::max(config_.temporalWeight, 0.0), 0.99);
+    config_.refreshInterval = std::max(config_.refreshInterval, 1);
+}
+
+void LocalContrastEnhancer::reset() {
+    frames_ = 0;
+}
+
+void LocalContrastEnhancer::apply(const cv::Mat& src, cv::Mat& dst) {
+    CV_Assert(src.type() == CV_8UC1);
+    if (src.empty()) {
+        dst.release();
+        return;
+    }
+
+    // **(Re)size the Persistent Buffers When the Frame Size Changes**
+    const int tilesX = config_.tileGrid.width, tilesY = config_.tileGrid.height;
+    if (src.size() != frameSize_) {
+        frameSize_ = src.size();
+        int paddedW = (src.cols % tilesX == 0) ? src.cols : src.cols + tilesX - src.cols % tilesX;
+        int paddedH = (src.rows % tilesY == 0) ? src.rows : src.rows + tilesY - src.rows % tilesY;
+        tileSize_ = cv::Size(paddedW / tilesX, paddedH / tilesY);
+        mappings_.assign(static_cast<size_t>(tilesX) * tilesY * 256, 0.0f);
+
+        // Column interpolation terms are the same for every row
+        columnTile_.resize(src.cols);
+        columnWeight_.resize(src.cols);
+        const float invW = 1.0f / tileSize_.width;
+        for (int x = 0; x < src.cols; x++) {
+            float txf = x * invW - 0.5f;
+            int tx = cvFloor(txf);
+            columnTile_[x] = tx;
+            columnWeight_[x] = txf - tx;
+        }
+        frames_ = 0;
+    }
+
+    computeTileMappings(src);
+    dst.create(src.size(), CV_8UC1);
+    interpolate(src, dst);
+    frames_++;
+}
+
+void LocalContrastEnhancer::computeTileMappings(const cv::Mat& src) {
+    const int tilesX = config_.tileGrid.width, tilesY = config_.tileGrid.height;
+    const int tileCount = tilesX * tilesY;
+
+    // **Histogram Source: the Frame, or a Border-Extended Copy Like cv::CLAHE**
+    const cv::Mat* hsrc = &src;
+    if (src.cols % tilesX != 0 || src.rows % tilesY != 0) {
+        cv::copyMakeBorder(src, padded_, 0, tileSize_.height * tilesY - src.rows,
+                           0, tileSize_.width * tilesX - src.cols, cv::BORDER_REFLECT_101);
+        hsrc = &padded_;
+    }
+
+    const int tileArea = tileSize_.width * tileSize_.height;
+    int clipLimit = 0;
+    if (config_.clipLimit > 0.0) clipLimit = std::max(static_cast<int>(config_.clipLimit * tileArea / 256), 1);
+    const float lutScale = 255.0f / tileArea;
+
+    // Tiles re-histogrammed this frame; the first frame refreshes all of them
+    const bool first = frames_ == 0;
+    const int interval = first ? 1 : config_.refreshInterval;
+    const int phase = static_cast<int>(frames_ % interval);
+    const float keep = first ? 0.0f : static_cast<float>(config_.temporalWeight);
+
+    // **Clipped Histogram -> CDF Mapping, One Tile per Task**
+    cv::parallel_for_(cv::Range(0, tileCount), [&](const cv::Range& range) {
+        int hist[256];
+        for (int t = range.start; t < range.end; t++) {
+            if (t % interval != phase) continue;
+
+            std::fill(hist, hist + 256, 0);
+            const int tx = t % tilesX, ty = t / tilesX;
+            for (int y = 0; y < tileSize_.height; y++) {
+                const uchar* row = hsrc->ptr<uchar>(ty * tileSize_.height + y) + tx * tileSize_.width;
+                for (int x = 0; x < tileSize_.width; x++) hist[row[x]]++;
+            }
+
+            if (clipLimit > 0) {
+                int clipped = 0;
+                for (int i = 0; i < 256; i++) {
+                    if (hist[i] > clipLimit) {
+                        clipped += hist[i] - clipLimit;
+                        hist[i] = clipLimit;
+                    }
+                }
+                int batch = clipped / 256;
+                int residual = clipped - batch * 256;
+                for (int i = 0; i < 256; i++) hist[i] += batch;
+                if (residual != 0) {
+                    int step = std::max(256 / residual, 1);
+                    for (int i = 0; i < 256 && residual > 0; i += step, residual--) hist[i]++;
+                }
+            }
+
+            float* mapping = &mappings_[static_cast<size_t>(t) * 256];
+            int sum = 0;
+            for (int i = 0; i < 256; i++) {
+                sum += hist[i];
+                float fresh = cv::saturate_cast<uchar>(sum * lutScale);
+                mapping[i] = keep * mapping[i] + (1.0f - keep) * fresh;
+            }
+        }
+    });
+
+    int refreshed = 0;
+    for (int t = 0; t < tileCount; t++)
+        if (t % interval == phase) refreshed++;
+    tilesRefreshed_ = refreshed;
+}
+
+void LocalContrastEnhancer::interpolate(const cv::Mat& src, cv::Mat& dst) const {
+    const int tilesX = config_.tileGrid.width, tilesY = config_.tileGrid.height;
+    const int rows = src.rows, cols = src.cols;
+    const float invH = 1.0f / tileSize_.height;
+
+    const int stripes = std::max(1, std::min(rows, cv::getNumThreads() * 4));
+
+    // **Bilinear Blend of the Four Surrounding Tile Mappings**
+    cv::parallel_for_(cv::Range(0, stripes), [&](const cv::Range& range) {
+        int y0 = static_cast<int>(static_cast<int64_t>(rows) * range.start / stripes);
+        int y1 = static_cast<int>(static_cast<int64_t>(rows) * range.end / stripes);
+        for (int y = y0; y < y1; y++) {
+            float tyf = y * invH - 0.5f;
+            int ty1 = cvFloor(tyf);
+            int ty2 = ty1 + 1;
+            float ya = tyf - ty1, ya1 = 1.0f - ya;
+            ty1 = std::max(ty1, 0);
+            ty2 = std::min(ty2, tilesY - 1);
+
+            const float* plane1 = &mappings_[static_cast<size_t>(ty1) * tilesX * 256];
+            const float* plane2 = &mappings_[static_cast<size_t>(ty2) * tilesX * 256];
+            const uchar* s = src.ptr<uchar>(y);
+            uchar* d = dst.ptr<uchar>(y);
+
+            for (int x = 0; x < cols; x++) {
+                int tx1 = columnTile_[x];
+                int tx2 = tx1 + 1;
+                float xa = columnWeight_[x], xa1 = 1.0f - xa;
+                tx1 = std::max(tx1, 0) * 256 + s[x];
+                tx2 = std::min(tx2, tilesX - 1) * 256 + s[x];
+
+                float res = (plane1[tx1] * xa1 + plane1[tx2] * xa) * ya1 +
+                            (plane2[tx1] * xa1 + plane2[tx2] * xa) * ya;
+                d[x] = cv::saturate_cast<uchar>(res);
+            }
+        }
+    });
+}
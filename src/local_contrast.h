@@ -0,0 +1,53 @@
+// Persistent local-contrast enhancer (CLAHE) for video.
+// main5.cpp and main7.cpp used to call cv::createCLAHE() for every frame,
+// rebuilding the object, its buffers and every tile histogram from scratch.
+// LocalContrastEnhancer lives for the whole stream: it keeps its buffers,
+// builds the tile histograms in parallel, and can blend each tile's mapping
+// with the previous frame's, which removes the frame-to-frame flicker of
+// high clip limits. Optionally only part of the tiles is re-histogrammed per
+// frame. With temporalWeight = 0 and refreshInterval = 1 the output follows
+// cv::CLAHE (same clipping, redistribution and bilinear interpolation).
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// **Enhancer Settings**
+struct LocalContrastConfig {
+    double clipLimit = 2.0;                // Same meaning as cv::createCLAHE(clipLimit)
+    cv::Size tileGrid = cv::Size(8, 8);    // Same default as cv::createCLAHE
+    double temporalWeight = 0.0;           // Weight of the previous mapping (0 = none, < 1)
+    int refreshInterval = 1;               // Re-histogram 1/N of the tiles per frame
+};
+
+class LocalContrastEnhancer {
+public:
+    explicit LocalContrastEnhancer(const LocalContrastConfig& config = LocalContrastConfig());
+
+    // **Enhance a CV_8UC1 Plane (dst may be src)**
+    void apply(const cv::Mat& src, cv::Mat& dst);
+
+    // Forgets the previous frame's mappings, e.g. after a scene cut.
+    void reset();
+
+    const LocalContrastConfig& config() const { return config_; }
+
+    // Tiles whose histogram was recomputed on the last apply()
+    int tilesRefreshed() const { return tilesRefreshed_; }
+
+private:
+    void computeTileMappings(const cv::Mat& src);
+    void interpolate(const cv::Mat& src, cv::Mat& dst) const;
+
+    LocalContrastConfig config_;
+    cv::Size frameSize_;
+    cv::Size tileSize_;
+    cv::Mat padded_;                 // Border-extended copy when tiles do not divide the frame
+    std::vector<float> mappings_;    // tiles x 256, blended across frames
+    std::vector<int> columnTile_;    // Left tile index of each column
+    std::vector<float> columnWeight_; // Weight of the right tile for each column
+    uint64_t frames_ = 0;
+    int tilesRefreshed_ = 0;
+};
@@ -3,165 +3,223 @@
 #include <sstream>
 #include <fstream>
 #include <cmath>
-#include <regex>
-
-// **Function to Read V4L2 Camera Settings**
-int getCameraSetting(const std::string& setting_name) {
-    std::ostringstream command;
-    command << "v4l2-ctl --get-ctrl=" << setting_name;
-    FILE* pipe = popen(command.str().c_str(), "r");
-    if (!pipe) {
-        std::cerr << "Error: Failed to execute v4l2-ctl\n";
-        return -1;
-    }
-
-    char buffer[128];
-    std::string result;
-    while (fgets(buffer, sizeof(buffer), pipe) != nullptr) {
-        result += buffer;
-    }
-    pclose(pipe);
-
-    std::smatch match;
-    std::regex num_regex(R"(\d+)");
-    if (std::regex_search(result, match, num_regex)) {
-        try {
-            return std::stoi(match.str());
-        } catch (const std::exception& e) {
-            std::cerr << "Error: Invalid number format for " << setting_name << "\n";
-            return -1;
-        }
-    }
-
-    std::cerr << "Error: Could not extract numeric value for " << setting_name << "\n";
-    return -1;
-}
-
-// **Function to Set Camera Controls Using V4L2**
-void setCameraSettings(int brightness, int contrast, int saturation, int wb_value) {
-    static int last_brightness = -1, last_contrast = -1, last_saturation = -1, last_wb = -1;
-    
-    if (brightness == last_brightness && contrast == last_contrast && 
-        saturation == last_saturation && wb_value == last_wb) {
-        return;  // Skip if no changes
-    }
-
-    std::ostringstream command;
-    command << "v4l2-ctl --set-ctrl=brightness=" << brightness
-            << " --set-ctrl=contrast=" << contrast
-            << " --set-ctrl=saturation=" << saturation
-            << " --set-ctrl=white_balance_temperature=" << wb_value;
-    std::system(command.str().c_str());
-
-    last_brightness = brightness;
-    last_contrast = contrast;
-    last_saturation = saturation;
-    last_wb = wb_value;
-
-    std::cout << "Updated Settings -> Brightness: " << brightness 
-              << ", Contrast: " << contrast 
-              << ", Saturation: " << saturation 
-              << ", White Balance: " << wb_value << "K\n";
-}
+#include <atomic>
+#include <memory>
+
+#include "async_log.h"
+#include "awb_controller.h"
+#include "camera_control.h"
+#include "control_worker.h"
+#include "frame_stats.h"
+#include "latency_stats.h"
+#include "pipeline.h"
+#include "playback_source.h"
+#include "preview_sink.h"
+#include "recording_sink.h"
+#include "temporal_denoise.h"
 
 // **Function to Estimate Color Temperature (1000K - 10000K)**
-double estimateColorTemperature(const cv::Mat& image) {
-    cv::Scalar avgRGB = cv::mean(image);
-    double r = avgRGB[2], g = avgRGB[1], b = avgRGB[0];
-
-    double ratio = r / (b + 1e-6);  // Avoid division by zero
-    double temp = (ratio > 1.0) ? (4500.0 * std::pow(ratio, 1.2)) : (4500.0 / std::pow(1.0 / ratio, 1.2));
-
-    return std::round(std::min(std::max(temp, 1000.0), 10000.0));  // Clamp & round to nearest integer
-}
-
-// **Function to Smoothly Adjust White Balance Using Exponential Moving Average (EMA)**
-int smoothWhiteBalance(int currentWB, int targetWB, double alpha = 0.2) {
-    return static_cast<int>(alpha * targetWB + (1.0 - alpha) * currentWB);
+// Only the R/B ratio is needed, so the processing stage fills the stats from
+// histograms of a 1-in-16 pixel grid (see bench_sampling for the error
+// against the full-frame mean).
+double estimateColorTemperature(const FrameStats& stats) {
+    return std::round(kelvinFromRedBlueRatio(stats.redBlueRatio()));  // Clamp & round to nearest integer
 }
 
-int main() {
-    // **Open USB Camera**
-    cv::VideoCapture cap(0);
-    if (!cap.isOpened()) {
-        std::cerr << "Error: Cannot open webcam!" << std::endl;
-        return -1;
+int main(int argc, char** argv) {
+    // **Arguments: [--source SPEC --free-run ...] [--headless ...] [--record PREFIX ...]**
+    std::string sourceSpec = "0";
+    PlaybackOptions playback;
+    PreviewConfig previewConfig;
+    RecorderConfig recordConfig;
+    bool record = false;
+    for (int i = 1; i < argc; i++) {
+        if (parseSourceOption(argc, argv, i, sourceSpec, playback)) continue;
+        if (parsePreviewOption(argc, argv, i, previewConfig)) continue;
+        if (!parseRecorderOption(argc, argv, i, recordConfig, record)) {
+            std::cerr << "Error: Unknown argument " << argv[i] << std::endl;
+            return -1;
+        }
     }
 
-    // **Set Camera Resolution**
-    cap.set(cv::CAP_PROP_FRAME_WIDTH, 1280);
-    cap.set(cv::CAP_PROP_FRAME_HEIGHT, 720);
+    // **Open USB Camera at 1280x720 (or a File or Synthetic Source)**
+    std::unique_ptr<FrameSource> source = openFrameSource(sourceSpec, cv::Size(1280, 720), V4L2_PIX_FMT_YUYV, playback);
+    if (!source) return -1;  // openFrameSource reported why
+
+    // **Open Camera Controls Once (Same Device as the Source)**
+    // File and synthetic sources get a fake device, so the sliders and AWB
+    // still run but nothing touches a camera that is not being read.
+    const std::string controlPath = cameraDeviceForSource(sourceSpec);
+    std::unique_ptr<CameraControlDevice> controlDevice;
+    if (!controlPath.empty()) controlDevice.reset(new V4L2ControlDevice(controlPath));
+    else {
+        // Ranges of a typical UVC webcam, so the initial reads succeed
+        FakeControlDevice* fake = new FakeControlDevice();
+        fake->addControl(V4L2_CID_BRIGHTNESS, 8, ControlRange{0, 15, 1, 8});
+        fake->addControl(V4L2_CID_CONTRAST, 15, ControlRange{0, 30, 1, 15});
+        fake->addControl(V4L2_CID_SATURATION, 30, ControlRange{0, 60, 1, 30});
+        fake->addControl(V4L2_CID_WHITE_BALANCE_TEMPERATURE, 4600, ControlRange{2800, 6500, 10, 4600});
+        controlDevice.reset(fake);
+    }
+    CameraControls controls(*controlDevice);
+    // Without a camera, the overlay shows no device WB
+    const bool haveDevice = !controlPath.empty() && controlDevice->isOpen();
 
     // **Read Initial Camera Settings**
-    int brightness = getCameraSetting("brightness");
-    int contrast = getCameraSetting("contrast");
-    int saturation = getCameraSetting("saturation");
-    int whiteBalance = getCameraSetting("white_balance_temperature");
+    int brightness = controls.get("brightness");
+    int contrast = controls.get("contrast");
+    int saturation = controls.get("saturation");
+    int whiteBalance = controls.get("white_balance_temperature");
     int lastRecordedWB = whiteBalance; // Store last WB when AWB was OFF
+    CameraSettings deviceSettings{brightness, contrast, saturation, whiteBalance};  // Before clamping
 
     brightness = std::max(0, std::min(15, brightness));
     contrast = std::max(0, std::min(30, contrast));
     saturation = std::max(0, std::min(60, saturation));
     whiteBalance = std::max(1000, std::min(10000, whiteBalance));
 
-    cv::Mat frame;
-    bool autoWB = true;
+    // **Device Writes Happen on the Control Thread, at Most 10 per Second**
+    // The sink only posts the latest settings; intermediate values are dropped.
+    CameraControlWorker cameraWorker(controls, 10.0, deviceSettings);
 
-    while (true) {
-        cap >> frame;
-        if (frame.empty()) continue;
+    // **Manual WB Controller: 4 Decisions a Second, Device Step Size**
+    ControlRange wbRange{1000, 10000, 1, whiteBalance};
+    if (!controls.query("white_balance_temperature", wbRange)) {
+        std::cerr << "Warning: Cannot query the white balance range, assuming 1000-10000K in 1 K steps" << std::endl;
+    }
+    AwbController awb(AwbConfig(), wbRange);
+    LogChannel awbLog(0.2);  // Controller stats every 5 s while AWB is off
 
-        // **Estimate Corrected Color Temperature (1000K - 10000K)**
-        double colorTemperature = estimateColorTemperature(frame);
+    bool autoWB = true;
+    std::atomic<bool> temporalDenoise(true);  // Toggled with 'n'
+    TemporalDenoiser temporal;
+    FrameAnalyzer analyzer;  // Processing thread only
+
+    // **Per-Stage Latency, Summarised Every 5 s**
+    // Capture, processing and the whole sink are timed by the pipeline
+    LatencyRegistry& latency = latencyRegistry();
+    LatencyHistogram& colorTempLatency = latency.stage("color-temperature");
+    LatencyHistogram& cameraLatency = latency.stage("set-camera");
+    LatencyHistogram& overlayLatency = latency.stage("put-text");
+    LatencyHistogram& showLatency = latency.stage("preview-post");
+    LatencyHistogram& consoleLatency = latency.stage("console");
+    LatencyReporter reporter(latency, 5.0);
+    LogChannel statusLog(2.0);  // Status line at most twice a second, repeats dropped
+
+    // Encoding runs on the recorder's thread; the sink only queues a copy
+    std::unique_ptr<RecordingSink> recorder;
+    if (record) recorder.reset(new RecordingSink(recordConfig));
+    LogChannel recordLog(0.2);
+
+    // **Display and Keyboard Run on the Preview Thread**
+    PreviewSink preview(previewConfig);
+    const int window = preview.addWindow("Live Video - Camera Controls");
+
+    // **Capture and Frame Analysis Run on Their Own Threads**
+    // Camera controls, overlay and key handling stay on this thread.
+    PipelineConfig config;
+    if (playback.freeRun) {
+        config.capturePolicy = OverflowPolicy::Block;
+        config.outputPolicy = OverflowPolicy::Block;
+    }
+    FramePipeline pipeline(config, *source,
+        [&](FramePacket& packet) {
+            // Native formats of /dev/video sources; the sink skips empty frames
+            if (!convertPacketToBGR(packet)) {
+                packet.image.release();
+                return;
+            }
+            // Denoise against the previous frames before anything looks at the frame
+            if (temporalDenoise) temporal.apply(packet.image, packet.image);
+            else temporal.reset();
+            packet.stats = analyzer.analyze(packet.image, packet.sequence, 4).frameStats();
+        },
+        [&](FramePacket& packet) {
+            cv::Mat& frame = packet.image;
+            if (frame.empty()) return true;
+
+            // **Estimate Corrected Color Temperature (1000K - 10000K)**
+            double colorTemperature;
+            {
+                ScopedLatency timer(colorTempLatency);
+                colorTemperature = estimateColorTemperature(packet.stats);
+            }
 
-        // **If AWB is OFF, Gradually Adjust White Balance**
-        if (!autoWB) {
-            int targetWB = static_cast<int>(colorTemperature);
-            targetWB = std::min(std::max(targetWB, 1000), 10000);
+            // **If AWB is OFF, Gradually Adjust White Balance**
+            if (!autoWB) {
+                // **Controller Moves in Mired Steps, Only Past the Deadband**
+                int kelvin;
+                if (awb.update(colorTemperature, packet.captured, kelvin)) whiteBalance = kelvin;
+                awbLog.log(describeAwbStats(awb.stats()));
 
-            // **Use EMA to smooth WB changes**
-            double adaptiveAlpha = 0.05 + (std::abs(targetWB - whiteBalance) / 5000.0); // Adjust speed dynamically
-            adaptiveAlpha = std::min(std::max(adaptiveAlpha, 0.05), 0.3); // Clamp alpha
-            whiteBalance = smoothWhiteBalance(whiteBalance, targetWB, adaptiveAlpha);
+                lastRecordedWB = whiteBalance;  // Store last WB used in AWB OFF mode
+            }
 
-            lastRecordedWB = whiteBalance;  // Store last WB used in AWB OFF mode
-        }
+            // **Request Settings from the Control Thread**
+            ControlStatus control;
+            {
+                ScopedLatency timer(cameraLatency);
+                cameraWorker.request({brightness, contrast, saturation, whiteBalance});
+                control = cameraWorker.status();
+            }
 
-        // **Apply Settings to Camera**
-        setCameraSettings(brightness, contrast, saturation, whiteBalance);
-
-        // **Display Camera Settings on Video**
-        std::string text = "Brightness: " + std::to_string(brightness) +
-                           " | Contrast: " + std::to_string(contrast) +
-                           " | Saturation: " + std::to_string(saturation) +
-                           " | WB: " + std::to_string(whiteBalance) + "K | AWB: " + (autoWB ? "ON" : "OFF");
-        cv::putText(frame, text, cv::Point(20, 40), cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(0, 255, 0), 2);
-
-        cv::imshow("Live Video - Camera Controls", frame);
-
-        // **Keyboard Controls**
-        char key = cv::waitKey(1);
-        if (key == 'q') break;
-        if (key == 'w' && brightness < 15) brightness++;  
-        if (key == 's' && brightness > 0) brightness--;   
-        if (key == 'e' && contrast < 30) contrast++;      
-        if (key == 'd' && contrast > 0) contrast--;       
-        if (key == 'r' && saturation < 60) saturation++;  
-        if (key == 'f' && saturation > 0) saturation--;   
-        if (key == 't') { 
-            autoWB = !autoWB;
-            if (autoWB) {
-                whiteBalance = lastRecordedWB;  // Use the last recorded WB when turning AWB ON
-            } else {
-                whiteBalance = static_cast<int>(colorTemperature);
-                whiteBalance = std::min(std::max(whiteBalance, 1000), 10000);
+            // **Display Camera Settings on Video**
+            std::string text = "Brightness: " + std::to_string(brightness) +
+                               " | Contrast: " + std::to_string(contrast) +
+                               " | Saturation: " + std::to_string(saturation) +
+                               " | WB: " + std::to_string(whiteBalance) + "K | AWB: " + (autoWB ? "ON" : "OFF");
+            if (haveDevice && !control.settled) text += " | Device WB: " + std::to_string(control.applied.whiteBalance) + "K";
+            {
+                ScopedLatency timer(overlayLatency);
+                cv::putText(frame, text, cv::Point(20, 40), cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(0, 255, 0), 2);
+            }
+            if (recorder) {
+                recorder->push(frame);
+                recordLog.log(describeRecorderStats(recorder->stats()));
+            }
+            {
+                ScopedLatency timer(showLatency);
+                preview.post(window, frame);
             }
-        }
 
-        std::cout << text << std::endl;
-    }
+            // **Keyboard Controls (Keys Pressed Since the Last Frame)**
+            int key;
+            while (preview.pollKey(key)) {
+                if (key == 'q') return false;
+                if (key == 'w' && brightness < 15) brightness++;
+                if (key == 's' && brightness > 0) brightness--;
+                if (key == 'e' && contrast < 30) contrast++;
+                if (key == 'd' && contrast > 0) contrast--;
+                if (key == 'r' && saturation < 60) saturation++;
+                if (key == 'f' && saturation > 0) saturation--;
+                if (key == 'n') temporalDenoise = !temporalDenoise;
+                if (key == 't') {
+                    autoWB = !autoWB;
+                    if (autoWB) {
+                        whiteBalance = lastRecordedWB;  // Use the last recorded WB when turning AWB ON
+                    } else {
+                        awb.reset(static_cast<int>(colorTemperature));
+                        whiteBalance = awb.kelvin();  // Clamped to the device range and step
+                    }
+                }
+            }
 
-    cap.release();
-    cv::destroyAllWindows();
+            {
+                ScopedLatency timer(consoleLatency);
+                statusLog.log(text);
+            }
+            return true;
+        });
+    PipelineSignalStop signalStop(pipeline);  // Ctrl-C ends the run, the statistics still print
+    pipeline.run();
+    if (recorder) recorder->close();
+    AsyncLogger::instance().flush();
+    printPipelineCounters(pipeline.counters());
+
+    ControlStatus control = cameraWorker.status();
+    std::cout << "Camera controls: " << control.requests << " requests, " << control.writes << " writes, "
+              << control.coalesced << " coalesced, " << control.failures << " failed" << std::endl;
+    std::cout << describeAwbStats(awb.stats()) << std::endl;
+    if (recorder) std::cout << describeRecorderStats(recorder->stats()) << std::endl;
     return 0;
 }
@@ -5,31 +5,25 @@
 #include <fstream>
 #include <cmath>
 
+#include "async_log.h"
+#include "camera_control.h"
+#include "frame_stats.h"
+
 // **Better Color Temperature Estimation (1000K - 10000K)**
-double estimateColorTemperature(const cv::Mat& image) {
-    cv::Scalar avgRGB = cv::mean(image);
-    double r = avgRGB[2], g = avgRGB[1], b = avgRGB[0];
+double estimateColorTemperature(const FrameHistograms& histograms) {
+    double ratio = histograms.redBlueRatio();  // Channel means from the histogram cache
 
     // **Improved Nonlinear Scaling Formula for Color Temperature**
-    double temp;
-    double ratio = r / (b + 1e-6);  // Avoid division by zero
-
-    if (ratio > 1.0) {
-        temp = 4500.0 * std::pow(ratio, 1.2);  // Warmer colors
-    } else {
-        temp = 4500.0 / std::pow(1.0 / ratio, 1.2);  // Cooler colors
-    }
-
-    temp = std::min(std::max(temp, 1000.0), 10000.0);  // Clamp between 1000K - 10000K
-    return temp;
+    return kelvinFromRedBlueRatio(ratio);
 }
 
 // **Function to Set White Balance Using V4L2**
-void setWhiteBalanceV4L2(int wb_value) {
-    std::ostringstream command;
-    command << "v4l2-ctl --set-ctrl=white_balance_temperature=" << wb_value;
-    std::system(command.str().c_str());
-    std::cout << "Set White Balance to: " << wb_value << "K (V4L2)\n";
+// Called every frame in manual mode; only an actual write is logged, through
+// the asynchronous log rather than a console write on the frame loop.
+void setWhiteBalanceV4L2(CameraControls& controls, int wb_value, LogChannel& controlLog) {
+    if (controls.applyWhiteBalance(wb_value) == ControlWrite::Written) {
+        controlLog.log("Set White Balance to: " + std::to_string(wb_value) + "K (V4L2)");
+    }
 }
 
 int main() {
@@ -44,20 +38,31 @@ int main() {
     cap.set(cv::CAP_PROP_FRAME_WIDTH, 1280);
     cap.set(cv::CAP_PROP_FRAME_HEIGHT, 720);
 
+    // **Open Camera Controls Once (Same Device as cap(0))**
+    V4L2ControlDevice controlDevice("/dev/video0");
+    CameraControls controls(controlDevice);
+
     cv::Mat frame;
     bool autoWB = true;
     int manualWB = 4500;  // Default white balance temperature
 
+    // **Per-Frame Histograms on a 1-in-16 Pixel Grid (see bench_sampling)**
+    FrameAnalyzer analyzer;
+    uint64_t frameId = 0;
+
+    LogChannel statusLog(2.0);  // Status line at most twice a second, repeats dropped
+    LogChannel controlLog(5.0);
+
     while (true) {
         cap >> frame;
         if (frame.empty()) continue;
 
         // **Estimate Corrected Color Temperature (1000K - 10000K)**
-        double colorTemperature = estimateColorTemperature(frame);
+        double colorTemperature = estimateColorTemperature(analyzer.analyze(frame, ++frameId, 4));
 
         // **Apply Manual White Balance When AWB is OFF**
         if (!autoWB) {
-            setWhiteBalanceV4L2(manualWB);
+            setWhiteBalanceV4L2(controls, manualWB, controlLog);
         }
 
         // **Display Color Temperature & AWB Status**
@@ -74,13 +79,13 @@ int main() {
             if (!autoWB) {
                 manualWB = static_cast<int>(colorTemperature); // Read current value
                 manualWB = std::min(std::max(manualWB, 1000), 10000); // Clamp to 1000K - 10000K
-                setWhiteBalanceV4L2(manualWB); // Apply to camera
+                setWhiteBalanceV4L2(controls, manualWB, controlLog); // Apply to camera
             } else {
-                setWhiteBalanceV4L2(4500);  // Default to 4500K when switching AWB ON
+                setWhiteBalanceV4L2(controls, 4500, controlLog);  // Default to 4500K when switching AWB ON
             }
         }
 
-        std::cout << text << std::endl;
+        statusLog.log(text);
     }
 
     cap.release();
@@ -15,18 +15,10 @@
 #include <iostream>
 #include <sstream>
 #include <fstream>
+#include <climits>
 
-// **Function to Set Brightness, Contrast, and Saturation Using V4L2**
-void setCameraSettings(int brightness, int contrast, int saturation) {
-    std::ostringstream command;
-    command << "v4l2-ctl --set-ctrl=brightness=" << brightness
-            << " --set-ctrl=contrast=" << contrast
-            << " --set-ctrl=saturation=" << saturation;
-    std::system(command.str().c_str());
-    std::cout << "Set Brightness: " << brightness 
-              << ", Contrast: " << contrast 
-              << ", Saturation: " << saturation << " (V4L2)\n";
-}
+#include "async_log.h"
+#include "camera_control.h"
 
 int main() {
     // **Open USB Camera**
@@ -40,13 +32,23 @@ int main() {
     cap.set(cv::CAP_PROP_FRAME_WIDTH, 1280);
     cap.set(cv::CAP_PROP_FRAME_HEIGHT, 720);
 
+    // **Open Camera Controls Once (Same Device as cap(0))**
+    V4L2ControlDevice controlDevice("/dev/video0");
+    CameraControls controls(controlDevice);
+
     cv::Mat frame;
     int brightness = 0;   // Default Brightness (Range 0 - 15)
     int contrast = 13;    // Default Contrast (Range 0 - 30)
     int saturation = 9;  // Default Saturation (Range 0 - 60)
 
     // **Apply Initial Camera Settings**
-    setCameraSettings(brightness, contrast, saturation);
+    // White balance is left as the device has it; only changes are written
+    // (and logged, at most 5 lines a second).
+    const int whiteBalance = controls.get("white_balance_temperature");
+    controls.assume({INT_MIN, INT_MIN, INT_MIN, whiteBalance});
+    setCameraSettings(controls, brightness, contrast, saturation, whiteBalance);
+
+    LogChannel statusLog(2.0);  // Status line at most twice a second, repeats dropped
 
     while (true) {
         cap >> frame;
@@ -71,9 +73,9 @@ int main() {
         if (key == 'f' && saturation > 0) saturation--;   // Decrease Saturation
 
         // **Apply Settings to Camera**
-        setCameraSettings(brightness, contrast, saturation);
+        setCameraSettings(controls, brightness, contrast, saturation, whiteBalance);
 
-        std::cout << text << std::endl;
+        statusLog.log(text);
     }
 
     cap.release();
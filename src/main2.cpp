@@ -1,6 +1,9 @@
 // C++ program for the above approach 
 #include <iostream> 
 #include <opencv2/opencv.hpp> 
+
+#include "enhance_chain.h"
+
 using namespace cv; 
 using namespace std; 
   
@@ -28,29 +31,24 @@ int main(int argc, char** argv)
     int imageHeight = sz.height;
     cout << "Width " << imageWidth << " Height " << imageHeight <<endl;
     // Step 1: Denoise the image (preserve edges)
-    
-    cv::fastNlMeansDenoisingColored(img, denoised, 1, 2, 7, 21);
-
     // Step 2: Apply sharpening to restore edges
-    
-    cv::Mat kernel = (cv::Mat_<float>(3,3) <<  
-            0, -1,  0,  
-            -1,  5, -1,  
-            0, -1,  0);
-    cv::filter2D(denoised, sharpened, -1, kernel);
-
-    // Step 3: Apply CLAHE (Contrast Enhancement)
-    std::vector<cv::Mat> channels(3);
-    cv::split(sharpened, channels);
-    cv::Ptr<cv::CLAHE> clahe = cv::createCLAHE(5.0); // Clip limit = 4.0
-    clahe->apply(channels[0], channels[0]);
-    clahe->apply(channels[1], channels[1]);
-    clahe->apply(channels[2], channels[2]);
+    // Step 3: Apply CLAHE (Contrast Enhancement) to each channel
+    // The variants shown below run on the enhanced image; every chain is
+    // built once, before any processing, like the live programs do.
+    EnhanceChain chain, bilateralChain, darkenChain, gammaChain;
+    auto build = [&img](const char* spec, EnhanceChain& into) {
+        EnhanceChainBuilder builder;
+        if (builder.parse(spec) && builder.build(img.size(), img.type(), into)) return true;
+        cerr << "Error: Invalid enhancement chain '" << spec << "'" << endl;
+        return false;
+    };
+    if (!build("denoise:1:2,sharpen,clahe-rgb:5", chain) || !build("bilateral:9:75:75", bilateralChain) ||
+        !build("darken:50", darkenChain) || !build("gamma:0.5", gammaChain)) {
+        return -1;
+    }
 
     cv::Mat final_image;
-    cv::merge(channels, final_image);
-
-    
+    chain.run(img, final_image);
 
     // Show results
     cv::imshow("Original Image", img);
@@ -61,7 +59,7 @@ int main(int argc, char** argv)
     // Apply different smoothing methods
     cv::GaussianBlur(final_image, gaussian, cv::Size(5, 5), 0);
     cv::medianBlur(final_image, median, 5);
-    cv::bilateralFilter(final_image, bilateral, 9, 75, 75);
+    bilateralChain.run(final_image, bilateral);
     
     // Show results
     // cv::imshow("Original", img);
@@ -70,23 +68,17 @@ int main(int argc, char** argv)
     cv::imshow("Bilateral Filter", bilateral);
 
     cv::Mat darkened;
-    final_image.convertTo(darkened, -1, 1, -50);
+    darkenChain.run(final_image, darkened);
     cv::imshow("Darkened Image", darkened);
 
     cv::Mat gamma_corrected, gamma_bilateral;
-    cv::Mat lookUpTable(1, 256, CV_8U);
-    uchar* p = lookUpTable.ptr();
-    double gamma = 0.5; // Lower value = darker image
-    for (int i = 0; i < 256; i++)
-        p[i] = cv::saturate_cast<uchar>(pow(i / 255.0, gamma) * 255.0);
-
-    cv::LUT(final_image, lookUpTable, gamma_corrected);
+    gammaChain.run(final_image, gamma_corrected); // Lower value = darker image
     cv::imshow("Gamma Corrected Image", gamma_corrected);
 
     cv::Mat hsv;
     cv::cvtColor(img, hsv, cv::COLOR_BGR2HSV);
 
-    // std::vector<cv::Mat> channels(3);
+    std::vector<cv::Mat> channels(3);
     cv::split(hsv, channels);
 
     // Reduce illuminance (V channel)
@@ -1,6 +1,8 @@
 #include <opencv2/opencv.hpp>
 #include <iostream>
 
+#include "flash_reduce.h"
+
 int main() {
     cv::Mat image = imread("../image2.jpeg", cv::IMREAD_COLOR);
     if (image.empty()) {
@@ -19,17 +21,12 @@ int main() {
     cv::split(lab, lab_channels);
 
     // Process only the Luminance (L) channel
-    for (int y = 0; y < lab_channels[0].rows; y++) {
-        for (int x = 0; x < lab_channels[0].cols; x++) {
-            uchar& L = lab_channels[0].at<uchar>(y, x);
-            if (L > 200) { // If pixel is too bright
-                float reduction_factor = 0.75 + 0.25 * ((255 - L) / 55.0); // Dynamic adjustment
-                L = cv::saturate_cast<uchar>(L * reduction_factor); // Reduce intensity smoothly
-                
-            }
-        }
-        
-    }
+    FlashReduceParams params;
+    params.threshold = 200;     // If pixel is too bright
+    params.reduction = 0.75;    // Reduce intensity smoothly, down to 75% at 255
+    params.softKnee = true;     // Dynamic adjustment
+    params.sharpenWeight = 0;   // No sharpening here
+    reduceFlashPlane(lab_channels[0], params);
 
     // Merge LAB channels and convert back to BGR
     cv::merge(lab_channels, lab);
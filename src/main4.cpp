@@ -1,71 +1,135 @@
 #include <opencv2/opencv.hpp>
 #include <iostream>
+#include <memory>
+#include <string>
 
-int main() {
-    // Open webcam (0 = default camera)
-    cv::VideoCapture cap(0);
-    if (!cap.isOpened()) {
-        std::cerr << "Error: Cannot open webcam!" << std::endl;
-        return -1;
+#include "alloc_counter.h"
+#include "async_log.h"
+#include "flash_reduce.h"
+#include "frame_arena.h"
+#include "latency_stats.h"
+#include "pipeline.h"
+#include "playback_source.h"
+#include "preview_sink.h"
+#include "recording_sink.h"
+#include "temporal_denoise.h"
+
+int main(int argc, char** argv) {
+    installAllocationCounter();
+
+    // **Arguments: [source] [--free-run --preload ...] [--headless ...] [--record PREFIX ...]**
+    std::string sourceSpec = "/dev/video0";
+    PlaybackOptions playback;
+    PreviewConfig previewConfig;
+    RecorderConfig recordConfig;
+    bool record = false;
+    bool positionalSource = false;
+    for (int i = 1; i < argc; i++) {
+        if (parseSourceOption(argc, argv, i, sourceSpec, playback)) continue;
+        if (parsePreviewOption(argc, argv, i, previewConfig)) continue;
+        if (parseRecorderOption(argc, argv, i, recordConfig, record)) continue;
+        if (argv[i][0] == '-' || positionalSource) {
+            std::cerr << "Error: Unknown argument " << argv[i] << std::endl;
+            return -1;
+        }
+        sourceSpec = argv[i];  // The one positional argument
+        positionalSource = true;
+    }
+
+    // **Open Webcam with Zero-Copy mmap Streaming (or a Raw, Video, Image or Synthetic Source)**
+    std::unique_ptr<FrameSource> source =
+        openFrameSource(sourceSpec, cv::Size(1280, 720), V4L2_PIX_FMT_YUYV, playback);
+    if (!source) return -1;
+
+    // **Frame Buffers, Allocated Once for the Negotiated Resolution**
+    PipelineConfig config;
+    if (playback.freeRun) {
+        // Every frame is processed and shown; the run goes as fast as processing
+        config.capturePolicy = OverflowPolicy::Block;
+        config.outputPolicy = OverflowPolicy::Block;
     }
+    FrameArena arena(processedFramesInFlight(config));
+    const int originalBuffer = arena.reserve(source->frameSize(), CV_8UC3);
+    const int resultBuffer = arena.reserve(source->frameSize(), CV_8UC3);
+    if (!arena.allocate()) return -1;
+    FrameAllocationMeter meter;
+    TemporalDenoiser temporal;  // Runs on the native frame, before flash reduction
+
+    // **Capture / Process / Display Latency, Summarised Every 5 s**
+    LatencyReporter reporter(latencyRegistry(), 5.0);
+
+    // **Optional Recording of the Flash-Reduced Stream, Encoded Off-Thread**
+    std::unique_ptr<RecordingSink> recorder;
+    if (record) recorder.reset(new RecordingSink(recordConfig));
+    LogChannel recordLog(0.2);
 
-    // // Set resolution to 640x480
-    cap.set(cv::CAP_PROP_FRAME_WIDTH, 1280);
-    cap.set(cv::CAP_PROP_FRAME_HEIGHT, 720);
-
-    cv::Mat frame;
-    while (true) {
-        cap >> frame;  // Capture frame
-        if (frame.empty()) break;
-
-        // Convert to LAB color space
-        cv::Mat lab;
-        cv::cvtColor(frame, lab, cv::COLOR_BGR2Lab);
-
-        // Split LAB channels
-        std::vector<cv::Mat> lab_channels;
-        cv::split(lab, lab_channels);
-
-        // Reduce brightness in bright spots
-        for (int y = 0; y < lab_channels[0].rows; y++) {
-            for (int x = 0; x < lab_channels[0].cols; x++) {
-                uchar& L = lab_channels[0].at<uchar>(y, x);
-                if (L > 200) {  // If pixel is too bright
-                    L = cv::saturate_cast<uchar>(L * 0.7);  // Reduce intensity by 30%
-                }
+    // **Scaled-Down Preview on Its Own Thread (None with --headless)**
+    PreviewSink preview(previewConfig);
+    const int originalWindow = preview.addWindow("Original Video");
+    const int resultWindow = preview.addWindow("Flash Reduced Video");
+
+    // **Capture, Processing and Display Run on Separate Threads**
+    FramePipeline pipeline(config, *source,
+        [&](FramePacket& packet) {
+            FrameAllocationScope frame(meter);  // Counted on every path out, early returns too
+            packet.buffers = arena.acquire();  // Empty if exhausted: the frame allocates
+            cv::Mat original;
+            if (packet.buffers) {
+                original = packet.buffers[originalBuffer];
+                packet.result = packet.buffers[resultBuffer];
             }
-        }
 
-        // Apply sharpening
-        cv::Mat sharpened;
-        cv::Mat kernel = (cv::Mat_<float>(3,3) <<  
-            0, -1,  0,  
-           -1,  5, -1,  
-            0, -1,  0);
-        cv::filter2D(lab_channels[0], sharpened, -1, kernel);
-
-        // Blend sharpened result with brightness-reduced frame
-        for (int y = 0; y < lab_channels[0].rows; y++) {
-            for (int x = 0; x < lab_channels[0].cols; x++) {
-                uchar& L = lab_channels[0].at<uchar>(y, x);
-                L = cv::saturate_cast<uchar>(0.6 * L + 0.4 * sharpened.at<uchar>(y, x));  // Blend
+            // Original is converted only because it is displayed
+            if (packet.pixelFormat == V4L2_PIX_FMT_BGR24) {
+                packet.image.copyTo(original);  // BGR24 would alias the buffer edited below
+            } else if (!convertToBGR(packet.image, packet.pixelFormat, original)) {
+                return;
             }
-        }
 
-        // Merge LAB channels and convert back to BGR
-        cv::merge(lab_channels, lab);
-        cv::Mat result;
-        cv::cvtColor(lab, result, cv::COLOR_Lab2BGR);
+            // Denoise against the previous frames, then reduce flash. With a
+            // luma plane, both edit the native frame in place and chroma is
+            // passed through; otherwise (BGR24, MJPEG) both work on the
+            // decoded copy, leaving original as it was captured
+            if (hasLumaPlane(packet.pixelFormat)) {
+                temporal.apply(packet.image, packet.image);
+                reduceFlashLuma(packet.image, packet.pixelFormat);
+                convertToBGR(packet.image, packet.pixelFormat, packet.result);
+            } else {
+                temporal.apply(original, packet.result);
+                reduceFlashBGR(packet.result, packet.result);
+            }
+
+            packet.image = original;
+            packet.pixelFormat = V4L2_PIX_FMT_BGR24;
+            packet.lease.reset();  // Both images are copies now
+        },
+        [&](FramePacket& packet) {
+            if (packet.result.empty()) return true;
+
+            if (recorder) {
+                recorder->push(packet.result);
+                recordLog.log(describeRecorderStats(recorder->stats()));
+            }
 
-        // Show video stream
-        cv::imshow("Original Video", frame);
-        cv::imshow("Flash Reduced Video", result);
+            // Show video stream (copied only when the preview is due)
+            preview.post(originalWindow, packet.image);
+            preview.post(resultWindow, packet.result);
 
-        // Exit on 'q' key press
-        if (cv::waitKey(1) == 'q') break;
+            // Exit on 'q' key press
+            int key;
+            while (preview.pollKey(key)) {
+                if (key == 'q') return false;
+            }
+            return true;
+        });
+    PipelineSignalStop signalStop(pipeline);  // Ctrl-C ends the run, the statistics still print
+    pipeline.run();
+    if (recorder) {
+        recorder->close();
+        std::cout << describeRecorderStats(recorder->stats()) << "\n";
     }
+    printPipelineCounters(pipeline.counters());
+    printAllocationMeter("processing", meter);
 
-    cap.release();
-    cv::destroyAllWindows();
     return 0;
-}
\ No newline at end of file
+}
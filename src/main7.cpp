@@ -1,61 +1,121 @@
 #include <opencv2/opencv.hpp>
 #include <iostream>
+#include <memory>
+#include <string>
 
-int main() {
-    // Open webcam
-    cv::VideoCapture cap(0);
-    if (!cap.isOpened()) {
-        std::cerr << "Error: Cannot open webcam!" << std::endl;
-        return -1;
-    }
+#include "alloc_counter.h"
+#include "async_log.h"
+#include "enhance_chain.h"
+#include "frame_arena.h"
+#include "latency_stats.h"
+#include "pipeline.h"
+#include "playback_source.h"
+#include "preview_sink.h"
 
-    // Set resolution (optional)
-    cap.set(cv::CAP_PROP_FRAME_WIDTH, 1280);
-    cap.set(cv::CAP_PROP_FRAME_HEIGHT, 720);
+int main(int argc, char** argv) {
+    installAllocationCounter();
 
-    cv::Mat frame, lab, enhanced, hsv;
-    while (true) {
-        cap >> frame;
-        if (frame.empty()) {
-            std::cerr << "Warning: Empty frame! Skipping..." << std::endl;
-            continue;
+    // **Enhancement Chain (Override with --chain "stage:args,...")**
+    // Temporal denoise first, so sensor noise is not amplified by what
+    // follows: CLAHE on L (clip limit 5.0; strong clipping flickers, so tile
+    // mappings are blended with the previous frame and half the tiles are
+    // refreshed per frame), then saturation +30%
+    std::string chainSpec = "temporal:0.75:6,clahe:5:0.75:2,saturation:1.3";
+    std::string sourceSpec = "/dev/video0";
+    PlaybackOptions playback;
+    PreviewConfig previewConfig;
+    bool positionalSource = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--chain" && i + 1 < argc) chainSpec = argv[++i];
+        else if (parseSourceOption(argc, argv, i, sourceSpec, playback)) continue;
+        else if (parsePreviewOption(argc, argv, i, previewConfig)) continue;
+        else if (arg[0] == '-' || positionalSource) {
+            std::cerr << "Error: Unknown argument " << arg << std::endl;
+            return -1;
+        } else {
+            sourceSpec = arg;  // The one positional argument
+            positionalSource = true;
         }
+    }
 
-        // **Step 1: Convert to LAB color space for Contrast Enhancement**
-        cv::cvtColor(frame, lab, cv::COLOR_BGR2Lab);
-        std::vector<cv::Mat> lab_channels;
-        cv::split(lab, lab_channels);
+    // **Open Webcam with Zero-Copy mmap Streaming (or a Raw, Video, Image or Synthetic Source)**
+    std::unique_ptr<FrameSource> source =
+        openFrameSource(sourceSpec, cv::Size(1280, 720), V4L2_PIX_FMT_YUYV, playback);
+    if (!source) return -1;
 
-        // **Apply CLAHE to L-channel (prevent over-processing)**
-        cv::Ptr<cv::CLAHE> clahe = cv::createCLAHE(5.0); // Lower clip limit = 2.0
-        clahe->apply(lab_channels[0], lab_channels[0]);
+    // **Plan the Chain Once for the Stream's Frame Size**
+    EnhanceChainBuilder builder;
+    EnhanceChain chain;
+    if (!builder.parse(chainSpec) || !builder.build(source->frameSize(), CV_8UC3, chain)) {
+        std::cerr << "Error: Invalid enhancement chain '" << chainSpec << "'" << std::endl;
+        return -1;
+    }
+    std::cout << "Enhancement: " << chain.describe() << "\n";
 
-        // Merge LAB and convert back to BGR
-        cv::merge(lab_channels, lab);
-        cv::cvtColor(lab, enhanced, cv::COLOR_Lab2BGR);
+    // **Frame Buffers, Allocated Once for the Negotiated Resolution**
+    // Each processed frame leases a slot; it returns to the arena when the
+    // sink (or a full queue) drops the packet.
+    PipelineConfig config;
+    if (playback.freeRun) {
+        // Every frame is processed and shown; the run goes as fast as processing
+        config.capturePolicy = OverflowPolicy::Block;
+        config.outputPolicy = OverflowPolicy::Block;
+    }
+    FrameArena arena(processedFramesInFlight(config));
+    const int bgrBuffer = arena.reserve(source->frameSize(), CV_8UC3);
+    const int resultBuffer = arena.reserve(source->frameSize(), CV_8UC3);
+    if (!arena.allocate()) return -1;
+    FrameAllocationMeter meter;
 
-        // **Step 2: Convert to HSV for Saturation Boost**
-        cv::cvtColor(enhanced, hsv, cv::COLOR_BGR2HSV);
-        std::vector<cv::Mat> hsv_channels;
-        cv::split(hsv, hsv_channels);
+    // **Capture / Process / Display Latency, Summarised Every 5 s**
+    LatencyReporter reporter(latencyRegistry(), 5.0);
 
-        // **Increase Saturation (Avoid Over-Saturation)**
-        hsv_channels[1] = hsv_channels[1] * 1.3; // Increase saturation by 30%
-        cv::merge(hsv_channels, hsv);
-        cv::cvtColor(hsv, enhanced, cv::COLOR_HSV2BGR);
+    LogChannel warnings(1.0, true, LogLevel::Warning);
 
-        // **Step 3: Apply a slight Gaussian Blur for smoothness**
-        // cv::GaussianBlur(enhanced, enhanced, cv::Size(3, 3), 0);
+    // **Scaled-Down Preview on Its Own Thread (None with --headless)**
+    PreviewSink preview(previewConfig);
+    const int originalWindow = preview.addWindow("Original Video");
+    const int resultWindow = preview.addWindow("Enhanced Color Video");
 
-        // Show video stream
-        cv::imshow("Original Video", frame);
-        cv::imshow("Enhanced Color Video", enhanced);
+    // **Capture, Processing and Display Run on Separate Threads**
+    FramePipeline pipeline(config, *source,
+        [&](FramePacket& packet) {
+            FrameAllocationScope frame(meter);  // Counted on every path out, early returns too
+            packet.buffers = arena.acquire();  // Empty if exhausted: the frame allocates
+            cv::Mat bgr;
+            if (packet.buffers) {
+                bgr = packet.buffers[bgrBuffer];
+                packet.result = packet.buffers[resultBuffer];
+            }
 
-        // Exit on 'q' key press
-        if (cv::waitKey(1) == 'q') break;
-    }
+            // Native YUYV is converted once, on the processing thread
+            if (convertPacketToBGR(packet, bgr)) chain.run(packet.image, packet.result);
+        },
+        [&](FramePacket& packet) {
+            if (packet.result.empty()) {
+                warnings.log("Warning: Empty frame! Skipping...");
+                return true;
+            }
+
+            // Show video stream (copied only when the preview is due)
+            preview.post(originalWindow, packet.image);
+            preview.post(resultWindow, packet.result);
+
+            // Exit on 'q' key press
+            int key;
+            while (preview.pollKey(key)) {
+                if (key == 'q') return false;
+            }
+            return true;
+        });
+    PipelineSignalStop signalStop(pipeline);  // Ctrl-C ends the run, the statistics still print
+    pipeline.run();
+    printPipelineCounters(pipeline.counters());
+    printAllocationMeter("processing", meter);
+    std::cout << "Frame arena -> Slots: " << arena.slotCount()
+              << ", Bytes: " << arena.bytes()
+              << ", Exhausted: " << arena.exhausted() << "\n";
 
-    cap.release();
-    cv::destroyAllWindows();
     return 0;
 }
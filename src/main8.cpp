@@ -1,51 +1,14 @@
 #include <opencv2/opencv.hpp>
 #include <iostream>
 
-double estimateBrightness(const cv::Mat& image) {
-    cv::Scalar meanIntensity = cv::mean(image);
-    return (meanIntensity[0] + meanIntensity[1] + meanIntensity[2]) / 3.0;
-}
-
-double estimateContrast(const cv::Mat& image) {
-    cv::Mat gray;
-    cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
-    cv::Scalar mean, stddev;
-    cv::meanStdDev(gray, mean, stddev);
-    return stddev[0];
-}
-
-double estimateSaturation(const cv::Mat& image) {
-    cv::Mat hsv;
-    cv::cvtColor(image, hsv, cv::COLOR_BGR2HSV);
-    std::vector<cv::Mat> hsvChannels;
-    cv::split(hsv, hsvChannels);
-    return cv::mean(hsvChannels[1])[0];
-}
-
-double estimateColorTemperature(const cv::Mat& image) {
-    cv::Scalar avgRGB = cv::mean(image);
-    double r = avgRGB[2], g = avgRGB[1], b = avgRGB[0];
-
-    // Approximate color temperature (based on RGB ratio)
-    double temp = 10000 * (r / (b + 1e-6));  // Avoid division by zero
-    temp = std::min(std::max(temp, 1000.0), 15000.0);  // Keep within range
-    return temp;
-}
-
-void adjustWhiteBalance(cv::Mat& image, double targetTemp = 6500) {
-    double colorTemp = estimateColorTemperature(image);
-    double scaleFactor = targetTemp / (colorTemp + 1e-6);
-
-    std::vector<cv::Mat> bgrChannels;
-    cv::split(image, bgrChannels);
-    
-    bgrChannels[0] *= scaleFactor; // Blue
-    bgrChannels[2] /= scaleFactor; // Red
-
-    cv::merge(bgrChannels, image);
-}
+#include "async_log.h"
+#include "alloc_counter.h"
+#include "frame_stats.h"
+#include "white_balance.h"
 
 int main() {
+    installAllocationCounter();
+
     // Open USB Camera
     cv::VideoCapture cap(0);
     if (!cap.isOpened()) {
@@ -60,24 +23,44 @@ int main() {
     cv::Mat frame;
     bool autoWB = true;
 
+    // **One Histogram Pass Feeds the Metrics and the WB Gains**
+    // The gains are then applied in place in a second pass. Starts with the
+    // original correction toward 6500K; 'e' cycles estimators.
+    FrameAnalyzer analyzer;
+    uint64_t frameId = 0;
+    WbConfig wbConfig;
+    wbConfig.targetTemp = 6500;
+    SoftwareWhiteBalancer whiteBalance;  // Gains come from estimateWbGains() below
+    FrameAllocationMeter meter;  // Analysis and white balance only, not the display
+
+    LogChannel statusLog(2.0);  // Status line at most twice a second, repeats dropped
+
     while (true) {
         cap >> frame;
         if (frame.empty()) continue;
 
-        // **Estimate Metrics**
-        double brightness = estimateBrightness(frame);
-        double contrast = estimateContrast(frame);
-        double saturation = estimateSaturation(frame);
-        double colorTemperature = estimateColorTemperature(frame);
+        // **Estimate Metrics (Single Pass Over the Frame)**
+        meter.beginFrame();
+        const FrameHistograms& histograms = analyzer.analyze(frame, ++frameId);
+        FrameStats stats = histograms.frameStats();
+        double brightness = stats.brightness();
+        double contrast = stats.contrast();
+        double saturation = stats.saturation();
+        double colorTemperature = stats.colorTemperature();
 
         // **Auto White Balance Adjustment**
-        if (autoWB) adjustWhiteBalance(frame, 6500);
+        if (autoWB) {
+            whiteBalance.applyGains(frame, frame, estimateWbGains(histograms, wbConfig));
+        }
+        meter.endFrame();
 
         // **Display Metrics on Video**
         std::string text = "Brightness: " + std::to_string(brightness) +
                            " | Contrast: " + std::to_string(contrast) +
                            " | Saturation: " + std::to_string(saturation) +
-                           " | Temp: " + std::to_string(colorTemperature) + "K";
+                           " | Temp: " + std::to_string(colorTemperature) + "K" +
+                           " | WB: " + wbEstimatorName(wbConfig.estimator) +
+                           (wbConfig.estimator == WbEstimator::GrayWorld && wbConfig.targetTemp > 0 ? " 6500K" : "");
 
         cv::putText(frame, text, cv::Point(20, 40), cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(0, 255, 0), 2);
 
@@ -87,10 +70,24 @@ int main() {
         char key = cv::waitKey(1);
         if (key == 'q') break;
         if (key == 't') autoWB = !autoWB; // Toggle Auto White Balance
-
-        std::cout << text << std::endl;
+        if (key == 'e') {
+            // 6500K target -> gray-world -> white-patch -> percentile -> 6500K target
+            if (wbConfig.estimator == WbEstimator::GrayWorld && wbConfig.targetTemp > 0) {
+                wbConfig.targetTemp = 0;
+            } else if (wbConfig.estimator == WbEstimator::GrayWorld) {
+                wbConfig.estimator = WbEstimator::WhitePatch;
+            } else if (wbConfig.estimator == WbEstimator::WhitePatch) {
+                wbConfig.estimator = WbEstimator::Percentile;
+            } else {
+                wbConfig.estimator = WbEstimator::GrayWorld;
+                wbConfig.targetTemp = 6500;
+            }
+        }
+
+        statusLog.log(text);
     }
 
+    printAllocationMeter("analysis + white balance", meter);
     cap.release();
     cv::destroyAllWindows();
     return 0;
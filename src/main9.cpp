@@ -1,49 +1,42 @@
 #include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cmath>
 #include <iostream>
-
-double estimateBrightness(const cv::Mat& image) {
-    return cv::mean(image)[0];  // Average intensity
-}
-
-double estimateContrast(const cv::Mat& image) {
-    cv::Mat gray;
-    cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
-    cv::Scalar mean, stddev;
-    cv::meanStdDev(gray, mean, stddev);
-    return stddev[0];  // Standard deviation as contrast measure
+#include <vector>
+
+#include "async_log.h"
+#include "camera_control.h"
+#include "control_worker.h"
+#include "frame_stats.h"
+
+// **Normalised Value (0..1, as VideoCapture::set Takes It) to a Control Write**
+// Controls the device does not have are left out of the batch.
+static void addNormalized(CameraControlDevice& device, uint32_t id, double fraction, std::vector<ControlValue>& batch) {
+    ControlRange range;
+    if (!device.queryControl(id, range)) return;
+    fraction = std::min(std::max(fraction, 0.0), 1.0);
+    batch.push_back({id, static_cast<int32_t>(std::lround(range.minimum + fraction * (range.maximum - range.minimum)))});
 }
 
-double estimateSaturation(const cv::Mat& image) {
-    cv::Mat hsv;
-    cv::cvtColor(image, hsv, cv::COLOR_BGR2HSV);
-    std::vector<cv::Mat> hsvChannels;
-    cv::split(hsv, hsvChannels);
-    return cv::mean(hsvChannels[1])[0];  // Mean of saturation channel
-}
-
-double estimateColorTemperature(const cv::Mat& image) {
-    cv::Scalar avgRGB = cv::mean(image);
-    double r = avgRGB[2], g = avgRGB[1], b = avgRGB[0];
-
-    // Approximate color temperature (based on RGB ratio)
-    double temp = 10000 * (r / (b + 1e-6));  // Avoid division by zero
-    temp = std::min(std::max(temp, 1000.0), 15000.0);  // Keep within reasonable range
-    return temp;
-}
-
-void applySettingsToCamera(cv::VideoCapture& cap, double brightness, double contrast, double saturation, double colorTemp) {
-    cap.set(cv::CAP_PROP_BRIGHTNESS, brightness / 255.0);  // Normalize brightness to camera scale
-    cap.set(cv::CAP_PROP_CONTRAST, contrast / 128.0);  // Normalize contrast
-    cap.set(cv::CAP_PROP_SATURATION, saturation / 128.0);  // Normalize saturation
+// Written on the control device, not through cap: VideoCapture is not
+// thread-safe, and the control thread must not wait for a frame read.
+ControlWrite applySettingsToCamera(CameraControlDevice& device, double brightness, double contrast, double saturation,
+                                   double colorTemp) {
+    std::vector<ControlValue> batch;
+    addNormalized(device, V4L2_CID_BRIGHTNESS, brightness / 255.0, batch);  // Normalize brightness to camera scale
+    addNormalized(device, V4L2_CID_CONTRAST, contrast / 128.0, batch);  // Normalize contrast
+    addNormalized(device, V4L2_CID_SATURATION, saturation / 128.0, batch);  // Normalize saturation
 
     // Adjust White Balance (if camera supports manual WB control)
     if (colorTemp < 5000) {
-        cap.set(cv::CAP_PROP_WHITE_BALANCE_BLUE_U, 0.5);  // Cooler adjustment
-        cap.set(cv::CAP_PROP_WHITE_BALANCE_RED_V, 1.5);  
+        addNormalized(device, V4L2_CID_BLUE_BALANCE, 0.5, batch);  // Cooler adjustment
+        addNormalized(device, V4L2_CID_RED_BALANCE, 1.5, batch);
     } else {
-        cap.set(cv::CAP_PROP_WHITE_BALANCE_BLUE_U, 1.5);  // Warmer adjustment
-        cap.set(cv::CAP_PROP_WHITE_BALANCE_RED_V, 0.5);  
+        addNormalized(device, V4L2_CID_BLUE_BALANCE, 1.5, batch);  // Warmer adjustment
+        addNormalized(device, V4L2_CID_RED_BALANCE, 0.5, batch);
     }
+    if (batch.empty()) return ControlWrite::Unchanged;  // No such controls (or no device)
+    return device.setControls(batch) ? ControlWrite::Written : ControlWrite::Failed;
 }
 
 int main() {
@@ -58,22 +51,34 @@ int main() {
     cap.set(cv::CAP_PROP_FRAME_WIDTH, 1280);
     cap.set(cv::CAP_PROP_FRAME_HEIGHT, 720);
 
+    // **Camera Writes Run on the Control Thread, at Most 5 per Second**
+    // They go through their own handle on the device (same as cap(0)), so
+    // the frame loop never waits for a write and reads need no lock.
+    V4L2ControlDevice controlDevice("/dev/video0");
+    CameraControlWorker cameraWorker([&controlDevice](const CameraSettings& s) {
+        return applySettingsToCamera(controlDevice, s.brightness, s.contrast, s.saturation, s.whiteBalance);
+    }, 5.0);
+
     cv::Mat frame;
     bool autoAdjust = false;
 
+    LogChannel statusLog(2.0);  // Status line at most twice a second, repeats dropped
+
     while (true) {
         cap >> frame;
         if (frame.empty()) continue;
 
-        // **Estimate Metrics**
-        double brightness = estimateBrightness(frame);
-        double contrast = estimateContrast(frame);
-        double saturation = estimateSaturation(frame);
-        double colorTemperature = estimateColorTemperature(frame);
+        // **Estimate Metrics (Single Pass Over the Frame)**
+        FrameStats stats = computeFrameStats(frame);
+        double brightness = stats.meanB;  // Average intensity of the first channel
+        double contrast = stats.contrast();
+        double saturation = stats.saturation();
+        double colorTemperature = stats.colorTemperature();
 
         // **Apply Settings to Camera (if enabled)**
         if (autoAdjust) {
-            applySettingsToCamera(cap, brightness, contrast, saturation, colorTemperature);
+            cameraWorker.request({static_cast<int>(std::lround(brightness)), static_cast<int>(std::lround(contrast)),
+                                  static_cast<int>(std::lround(saturation)), static_cast<int>(std::lround(colorTemperature))});
         }
 
         // **Display Metrics on Video**
@@ -91,9 +96,13 @@ int main() {
         if (key == 'q') break;
         if (key == 'a') autoAdjust = !autoAdjust; // Toggle Auto Adjustment
 
-        std::cout << text << std::endl;
+        statusLog.log(text);
     }
 
+    ControlStatus control = cameraWorker.status();
+    std::cout << "Camera controls: " << control.requests << " requests, " << control.writes << " writes, "
+              << control.coalesced << " coalesced, " << control.failures << " failed" << std::endl;
+
     cap.release();
     cv::destroyAllWindows();
     return 0;
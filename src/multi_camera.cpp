@@ -0,0 +1,352 @@
+#include "multi_camera.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <utility>
+
+#include "awb_controller.h"
+#include "camera_control.h"
+#include "control_worker.h"
+#include "enhance_chain.h"
+#include "frame_ring.h"
+#include "frame_source.h"
+#include "frame_stats.h"
+#include "latency_stats.h"
+
+// **State of One Camera**
+// The capture thread owns source and the FPS credit; the other fields
+// below ring are only touched by the one worker processing the camera.
+struct MultiCameraRuntime::Camera {
+    CameraConfig config;
+    size_t index = 0;
+
+    std::unique_ptr<V4L2MmapSource> source;
+    std::thread thread;
+    double credit = 1.0;  // Frames that may be handed on (FPS target)
+    std::chrono::steady_clock::time_point lastFrame;
+
+    FrameRing<FramePacket> ring{2, OverflowPolicy::DropOldest};
+    std::atomic<bool> scheduled{false};
+
+    std::unique_ptr<V4L2ControlDevice> controlDevice;
+    std::unique_ptr<CameraControls> controls;
+    std::unique_ptr<CameraControlWorker> controlWorker;
+    std::unique_ptr<AwbController> awb;
+    CameraSettings settings{0, 0, 0, 0};
+
+    EnhanceChain chain;
+    bool hasChain = false;
+    FrameAnalyzer analyzer;
+    cv::Mat bgr;
+
+    std::mutex latestMutex;
+    cv::Mat latest;
+    bool hasLatest = false;
+
+    LatencyHistogram* processLatency = nullptr;
+    LatencyHistogram* endToEnd = nullptr;
+    std::atomic<uint64_t> captured{0}, skipped{0}, processed{0};
+    uint64_t reportedCaptured = 0, reportedProcessed = 0, reportedDropped = 0;  // Reporter only
+};
+
+namespace {
+
+uint32_t pixelFormatFromName(const std::string& name) {
+    if (name.size() != 4) return 0;
+    return v4l2_fourcc(name[0], name[1], name[2], name[3]);
+}
+
+template <typename T>
+void readOptional(const cv::FileNode& node, T& value) {
+    if (!node.empty()) node >> value;
+}
+
+}  // namespace
+
+bool loadMultiCameraConfig(const std::string& path, MultiCameraConfig& config) {
+    cv::FileStorage fs(path, cv::FileStorage::READ);
+    if (!fs.isOpened()) {
+        std::cerr << "Error: Cannot open camera config " << path << "\n";
+        return false;
+    }
+
+    readOptional(fs["workers"], config.workers);
+    readOptional(fs["workerCore"], config.workerCore);
+    readOptional(fs["reportInterval"], config.reportInterval);
+
+    cv::FileNode cameras = fs["cameras"];
+    if (!cameras.isSeq() || cameras.size() == 0) {
+        std::cerr << "Error: " << path << " has no 'cameras' list\n";
+        return false;
+    }
+
+    config.cameras.clear();
+    for (cv::FileNodeIterator it = cameras.begin(); it != cameras.end(); ++it) {
+        cv::FileNode n = *it;
+        CameraConfig c;
+        c.name = "cam" + std::to_string(config.cameras.size());
+        readOptional(n["name"], c.name);
+        readOptional(n["device"], c.device);
+        readOptional(n["width"], c.size.width);
+        readOptional(n["height"], c.size.height);
+        readOptional(n["fps"], c.targetFps);
+        readOptional(n["chain"], c.chain);
+        readOptional(n["core"], c.captureCore);
+        int awb = 0;
+        readOptional(n["awb"], awb);
+        c.autoWhiteBalance = awb != 0;
+
+        std::string format;
+        readOptional(n["format"], format);
+        if (!format.empty()) {
+            c.pixelFormat = pixelFormatFromName(format);
+            if (c.pixelFormat == 0) {
+                std::cerr << "Error: Camera " << c.name << ": unknown format '" << format << "'\n";
+                return false;
+            }
+        }
+        config.cameras.push_back(c);
+    }
+    return true;
+}
+
+// **Runtime**
+MultiCameraRuntime::MultiCameraRuntime(const MultiCameraConfig& config, SinkFn sink)
+    : config_(config), sink_(std::move(sink)), running_(false) {}
+
+MultiCameraRuntime::~MultiCameraRuntime() {
+    stop();
+}
+
+const CameraConfig& MultiCameraRuntime::cameraConfig(size_t camera) const {
+    return cameras_[camera]->config;
+}
+
+bool MultiCameraRuntime::openCamera(Camera& camera) {
+    const CameraConfig& c = camera.config;
+    camera.source.reset(new V4L2MmapSource(c.device, c.size, c.pixelFormat));
+    if (!camera.source->isOpened()) {
+        std::cerr << "Error: Camera " << c.name << ": cannot open " << c.device << "\n";
+        return false;
+    }
+
+    // **Chain Planned Once for the Negotiated Size**
+    if (!c.chain.empty()) {
+        EnhanceChainBuilder builder;
+        if (!builder.parse(c.chain) || !builder.build(camera.source->frameSize(), CV_8UC3, camera.chain)) {
+            std::cerr << "Error: Camera " << c.name << ": invalid enhancement chain '" << c.chain << "'\n";
+            return false;
+        }
+        camera.hasChain = true;
+    }
+
+    // **Control State: Writes Go Through the Camera's Own Control Thread**
+    camera.controlDevice.reset(new V4L2ControlDevice(c.device));
+    camera.controls.reset(new CameraControls(*camera.controlDevice));
+    if (camera.controlDevice->isOpen()) {
+        camera.settings = {camera.controls->get("brightness"), camera.controls->get("contrast"),
+                           camera.controls->get("saturation"), camera.controls->get("white_balance_temperature")};
+        camera.controlWorker.reset(new CameraControlWorker(*camera.controls, 10.0, camera.settings));
+
+        if (c.autoWhiteBalance) {
+            ControlRange range{1000, 10000, 1, camera.settings.whiteBalance};
+            camera.controls->query("white_balance_temperature", range);
+            camera.controlDevice->setControl(V4L2_CID_AUTO_WHITE_BALANCE, 0);
+            camera.awb.reset(new AwbController(AwbConfig(), range));
+            camera.awb->reset(camera.settings.whiteBalance);
+        }
+    }
+
+    camera.processLatency = &latencyRegistry().stage(c.name + ".process");
+    camera.endToEnd = &latencyRegistry().stage(c.name + ".end-to-end");
+    const cv::Size size = camera.source->frameSize();
+    std::cout << "Camera " << c.name << ": " << c.device << " " << size.width << "x" << size.height
+              << (c.targetFps > 0 ? ", " + std::to_string(c.targetFps) + " fps target" : "")
+              << (camera.hasChain ? ", " + camera.chain.describe() : "") << "\n";
+    return true;
+}
+
+bool MultiCameraRuntime::start() {
+    for (const CameraConfig& c : config_.cameras) {
+        std::unique_ptr<Camera> camera(new Camera());
+        camera->config = c;
+        camera->index = cameras_.size();
+        if (openCamera(*camera)) cameras_.push_back(std::move(camera));
+    }
+    if (cameras_.empty()) {
+        std::cerr << "Error: No camera could be opened" << std::endl;
+        return false;
+    }
+
+    pool_.reset(new WorkerPool(config_.workers, config_.workerCore));
+    running_ = true;
+    for (std::unique_ptr<Camera>& camera : cameras_) {
+        Camera& cam = *camera;
+        cam.thread = std::thread(&MultiCameraRuntime::captureLoop, this, std::ref(cam));
+        if (cam.config.captureCore >= 0) pinThreadToCore(cam.thread, cam.config.captureCore);
+    }
+
+    lastReport_ = std::chrono::steady_clock::now();
+    if (config_.reportInterval > 0) reportThread_ = std::thread(&MultiCameraRuntime::reportLoop, this);
+    return true;
+}
+
+void MultiCameraRuntime::stop() {
+    const bool wasRunning = running_.exchange(false);
+    for (std::unique_ptr<Camera>& camera : cameras_) {
+        camera->source->interrupt();  // A stalled camera would keep its thread in DQBUF
+        if (camera->thread.joinable()) camera->thread.join();
+    }
+    {
+        std::lock_guard<std::mutex> lock(reportMutex_);
+        stopping_ = true;
+    }
+    reportWake_.notify_all();
+    if (reportThread_.joinable()) reportThread_.join();
+
+    // Nothing is pushed any more. Frames already queued are processed while
+    // the pool is alive, since processNext() schedules the camera again
+    // through pool_; once the pool is idle, no task can touch it.
+    if (pool_) pool_->drain();
+    pool_.reset();
+    if (wasRunning) printReport(stdout);
+}
+
+// **Capture Thread: Read, Apply the FPS Target, Queue, Schedule**
+void MultiCameraRuntime::captureLoop(Camera& camera) {
+    LatencyHistogram& captureLatency = latencyRegistry().stage(camera.config.name + ".capture");
+    uint64_t sequence = 0;
+    camera.lastFrame = std::chrono::steady_clock::now();
+
+    while (running_) {
+        CapturedFrame frame;
+        {
+            ScopedLatency timer(captureLatency);
+            if (!camera.source->read(frame)) break;
+        }
+        auto now = std::chrono::steady_clock::now();
+        camera.captured++;
+
+        // Credit grows at the target rate and each processed frame spends
+        // one, so 30 fps in and 20 fps out keeps two frames of every three
+        if (camera.config.targetFps > 0) {
+            double elapsed = std::chrono::duration<double>(now - camera.lastFrame).count();
+            camera.credit = std::min(1.0, camera.credit + elapsed * camera.config.targetFps);
+            camera.lastFrame = now;
+            if (camera.credit < 1.0 - 1e-3) {
+                camera.skipped++;
+                continue;  // The lease is dropped here, so the buffer is requeued at once
+            }
+            camera.credit -= 1.0;
+        }
+
+        FramePacket packet;
+        packet.image = frame.image;
+        packet.pixelFormat = frame.pixelFormat;
+        packet.lease = std::move(frame.lease);
+        packet.sequence = sequence++;
+        packet.captured = now;
+        camera.ring.push(std::move(packet));
+        schedule(camera);
+    }
+}
+
+void MultiCameraRuntime::schedule(Camera& camera) {
+    if (camera.scheduled.exchange(true)) return;  // Already queued or being processed
+    Camera* cam = &camera;
+    pool_->submit([this, cam] { processNext(*cam); });
+}
+
+// **Worker: One Frame of One Camera, Then Back of the Queue**
+void MultiCameraRuntime::processNext(Camera& camera) {
+    FramePacket packet;
+    if (camera.ring.tryPop(packet)) {
+        {
+            ScopedLatency timer(*camera.processLatency);
+            const bool native = packet.pixelFormat == V4L2_PIX_FMT_BGR24;
+            if (convertPacketToBGR(packet, camera.bgr)) {
+                if (!native) camera.bgr = packet.image;  // Conversion buffer reused next frame
+
+                const FrameHistograms& histograms = camera.analyzer.analyze(packet.image, packet.sequence, 4);
+                packet.stats = histograms.frameStats();
+                if (camera.hasChain) camera.chain.run(packet.image, packet.result);
+                else packet.result = packet.image;
+
+                int kelvin;
+                if (camera.awb && camera.awb->update(kelvinFromRedBlueRatio(histograms.redBlueRatio()),
+                                                     packet.captured, kelvin)) {
+                    camera.settings.whiteBalance = kelvin;
+                    camera.controlWorker->request(camera.settings);
+                }
+
+                if (sink_) sink_(camera.index, packet);
+                {
+                    std::lock_guard<std::mutex> lock(camera.latestMutex);
+                    packet.result.copyTo(camera.latest);
+                    camera.hasLatest = true;
+                }
+            }
+        }
+        camera.processed++;
+        camera.endToEnd->record(std::chrono::steady_clock::now() - packet.captured);
+    }
+
+    // A frame pushed after the pop above saw scheduled == true and did not
+    // schedule, so check again once the flag is clear
+    camera.scheduled = false;
+    if (camera.ring.depth() > 0) schedule(camera);
+}
+
+bool MultiCameraRuntime::latestFrame(size_t camera, cv::Mat& out) {
+    Camera& cam = *cameras_[camera];
+    std::lock_guard<std::mutex> lock(cam.latestMutex);
+    if (!cam.hasLatest) return false;
+    cam.latest.copyTo(out);
+    return true;
+}
+
+// **Report**
+void MultiCameraRuntime::printReport(std::FILE* out) {
+    auto now = std::chrono::steady_clock::now();
+    double seconds = std::max(1e-3, std::chrono::duration<double>(now - lastReport_).count());
+    lastReport_ = now;
+
+    std::fprintf(out, "Cameras (last %.1f s):\n", seconds);
+    double totalIn = 0, totalOut = 0;
+    uint64_t totalDropped = 0;
+    for (std::unique_ptr<Camera>& camera : cameras_) {
+        Camera& c = *camera;
+        uint64_t captured = c.captured, processed = c.processed, dropped = c.ring.dropped();
+        double in = (captured - c.reportedCaptured) / seconds;
+        double done = (processed - c.reportedProcessed) / seconds;
+        uint64_t newlyDropped = dropped - c.reportedDropped;
+        c.reportedCaptured = captured;
+        c.reportedProcessed = processed;
+        c.reportedDropped = dropped;
+        totalIn += in;
+        totalOut += done;
+        totalDropped += newlyDropped;
+
+        char target[32] = "-";
+        if (c.config.targetFps > 0) std::snprintf(target, sizeof(target), "%.1f", c.config.targetFps);
+        std::fprintf(out, "  %-10s %-14s in %6.1f fps  processed %6.1f fps (target %s)  dropped %llu\n",
+                     c.config.name.c_str(), c.config.device.c_str(), in, done, target,
+                     static_cast<unsigned long long>(newlyDropped));
+    }
+    std::fprintf(out, "  %-10s %-14s in %6.1f fps  processed %6.1f fps  dropped %llu  (%d workers, %zu queued)\n",
+                 "total", "", totalIn, totalOut, static_cast<unsigned long long>(totalDropped),
+                 pool_ ? pool_->size() : 0, pool_ ? pool_->pending() : static_cast<size_t>(0));
+    std::fprintf(out, "Latency:\n");
+    latencyRegistry().print(out, true);
+}
+
+void MultiCameraRuntime::reportLoop() {
+    std::unique_lock<std::mutex> lock(reportMutex_);
+    auto interval = std::chrono::duration<double>(config_.reportInterval);
+    while (!reportWake_.wait_for(lock, interval, [this] { return stopping_; })) {
+        lock.unlock();
+        printReport(stdout);
+        lock.lock();
+    }
+}
@@ -0,0 +1,120 @@
+// Several cameras in one process.
+// Rigs with four to eight USB cameras used to run one process per camera,
+// each with its own capture, processing and OpenCV threads, all competing
+// for the same cores. MultiCameraRuntime opens every camera of a config
+// file. Each camera gets its own capture thread (zero-copy mmap streaming),
+// frame queue, enhancement chain and control state (CameraControls, a
+// CameraControlWorker and optionally an AwbController). Processing for all
+// of them runs on one shared WorkerPool. A camera has at most one frame in
+// processing at a time, so its chain sees frames in order. It goes to the
+// back of the pool's queue after each frame, so one busy camera cannot
+// starve the others. Capture threads and workers can be pinned to cores. A
+// per-camera FPS target hands only that many frames a second to processing.
+// Throughput of every camera, the total, and per-camera latency are
+// reported together every reportInterval seconds.
+//
+// Config (YAML or JSON, read with cv::FileStorage):
+//
+//   workers: 4            # Shared processing threads (0 = one per core)
+//   workerCore: 4         # Pin worker i to core 4 + i (-1 = no pinning)
+//   reportInterval: 5
+//   cameras:
+//     - { name: left, device: /dev/video0, width: 1280, height: 720,
+//         format: YUYV, fps: 15, chain: "temporal,clahe:2", awb: 1, core: 0 }
+//     - { name: right, device: /dev/video2, fps: 30, core: 1 }
+#pragma once
+
+#include <linux/videodev2.h>
+#include <opencv2/opencv.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "pipeline.h"
+#include "worker_pool.h"
+
+// **One Camera of the Rig**
+struct CameraConfig {
+    std::string name;                    // Report and latency-stage prefix
+    std::string device = "/dev/video0";
+    cv::Size size = cv::Size(1280, 720);
+    uint32_t pixelFormat = V4L2_PIX_FMT_YUYV;
+    double targetFps = 0;                // Frames processed per second; 0 = every frame
+    std::string chain;                   // EnhanceChain spec; empty = analysis only
+    bool autoWhiteBalance = false;       // Drive white_balance_temperature (AwbController)
+    int captureCore = -1;                // Pin the capture thread; -1 = no pinning
+};
+
+struct MultiCameraConfig {
+    int workers = 0;                     // Shared processing threads; 0 = one per core
+    int workerCore = -1;                 // First core for the workers; -1 = no pinning
+    double reportInterval = 5.0;         // Seconds; 0 = no periodic report
+    std::vector<CameraConfig> cameras;
+};
+
+// **Read a Config File (Format in the Comment Above)**
+// Unknown keys are ignored; missing ones keep their defaults.
+bool loadMultiCameraConfig(const std::string& path, MultiCameraConfig& config);
+
+class MultiCameraRuntime {
+public:
+    // Called on a worker thread with each processed packet (result filled,
+    // BGR); must not block for long. The image and result buffers are reused
+    // for the camera's next frame, so copy what is kept.
+    using SinkFn = std::function<void(size_t camera, FramePacket& packet)>;
+
+    explicit MultiCameraRuntime(const MultiCameraConfig& config, SinkFn sink = SinkFn());
+
+    // Stops capture, finishes queued processing, prints a final report.
+    ~MultiCameraRuntime();
+
+    MultiCameraRuntime(const MultiCameraRuntime&) = delete;
+    MultiCameraRuntime& operator=(const MultiCameraRuntime&) = delete;
+
+    // Opens every camera and starts capturing. Cameras that fail to open
+    // are reported and left out; returns false if none opened.
+    bool start();
+    // Wakes and joins the capture threads, even if a camera has stalled,
+    // processes the frames already queued, then prints the final report.
+    void stop();
+
+    size_t cameraCount() const { return cameras_.size(); }
+    const CameraConfig& cameraConfig(size_t camera) const;
+
+    // Copies the camera's latest processed frame; false if there is none yet.
+    bool latestFrame(size_t camera, cv::Mat& out);
+
+    // Per-camera and total frame rates since the previous report, then the
+    // latency of every stage.
+    void printReport(std::FILE* out);
+
+private:
+    struct Camera;
+
+    bool openCamera(Camera& camera);
+    void captureLoop(Camera& camera);
+    void schedule(Camera& camera);
+    void processNext(Camera& camera);
+    void reportLoop();
+
+    MultiCameraConfig config_;
+    SinkFn sink_;
+    std::vector<std::unique_ptr<Camera>> cameras_;
+    std::unique_ptr<WorkerPool> pool_;  // Destroyed before the cameras it works on
+
+    std::atomic<bool> running_;
+    std::chrono::steady_clock::time_point lastReport_;
+    std::mutex reportMutex_;
+    std::condition_variable reportWake_;
+    bool stopping_ = false;
+    std::thread reportThread_;
+};
@@ -0,0 +1,51 @@
+// Runs every camera of a rig in one process: one capture thread per camera,
+// one shared processing pool, one report (see multi_camera.h for the config).
+//   ./multicam cameras.yml
+#include <opencv2/opencv.hpp>
+#include <cmath>
+#include <iostream>
+
+#include "multi_camera.h"
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " cameras.yml" << std::endl;
+        return -1;
+    }
+
+    MultiCameraConfig config;
+    if (!loadMultiCameraConfig(argv[1], config)) return -1;
+
+    // Parallelism comes from the pool; nested OpenCV threads would oversubscribe
+    if (config.workers != 1) cv::setNumThreads(1);
+
+    MultiCameraRuntime runtime(config);
+    if (!runtime.start()) return -1;
+
+    // **Mosaic of the Latest Frames, Refreshed at ~15 Hz on the Main Thread**
+    const int count = static_cast<int>(runtime.cameraCount());
+    const int columns = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(count))));
+    const int rows = (count + columns - 1) / columns;
+    const cv::Size tileSize(640, 360);
+    cv::Mat mosaic(rows * tileSize.height, columns * tileSize.width, CV_8UC3, cv::Scalar::all(0));
+    cv::Mat frame;
+
+    while (true) {
+        for (int i = 0; i < count; i++) {
+            if (!runtime.latestFrame(i, frame)) continue;
+            cv::Mat tile = mosaic(cv::Rect((i % columns) * tileSize.width, (i / columns) * tileSize.height,
+                                           tileSize.width, tileSize.height));
+            cv::resize(frame, tile, tileSize, 0, 0, cv::INTER_AREA);
+            cv::putText(tile, runtime.cameraConfig(i).name, cv::Point(10, 25), cv::FONT_HERSHEY_SIMPLEX, 0.6,
+                        cv::Scalar(0, 255, 0), 2);
+        }
+        cv::imshow("Cameras", mosaic);
+
+        char key = cv::waitKey(66);
+        if (key == 'q') break;
+    }
+
+    runtime.stop();
+    cv::destroyAllWindows();
+    return 0;
+}
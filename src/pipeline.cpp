@@ -0,0 +1,202 @@
+#include "pipeline.h"
+
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+#include "latency_stats.h"
+
+FramePipeline::FramePipeline(const PipelineConfig& config, CaptureFn capture, ProcessFn process, SinkFn sink)
+    : process_(std::move(process)), sink_(std::move(sink)),
+      captureRing_(config.captureQueue, config.capturePolicy),
+      outputRing_(config.outputQueue, config.outputPolicy),
+      running_(false), captured_(0), processed_(0), delivered_(0) {
+    capture_ = [capture](FramePacket& packet) { return capture(packet.image); };
+}
+
+FramePipeline::FramePipeline(const PipelineConfig& config, FrameSource& source, ProcessFn process, SinkFn sink)
+    : process_(std::move(process)), sink_(std::move(sink)),
+      captureRing_(config.captureQueue, config.capturePolicy),
+      outputRing_(config.outputQueue, config.outputPolicy),
+      running_(false), captured_(0), processed_(0), delivered_(0) {
+    source_ = &source;
+    capture_ = [&source](FramePacket& packet) {
+        CapturedFrame frame;
+        if (!source.read(frame)) return false;
+        packet.image = frame.image;
+        packet.pixelFormat = frame.pixelFormat;
+        packet.lease = std::move(frame.lease);
+        return true;
+    };
+}
+
+FramePipeline::~FramePipeline() {
+    stop();
+    join();
+}
+
+int FramePipeline::run() {
+    running_ = true;
+    captureThread_ = std::thread(&FramePipeline::captureLoop, this);
+    processThread_ = std::thread(&FramePipeline::processLoop, this);
+
+    // **Sink Runs on the Calling Thread**
+    LatencyHistogram& sinkLatency = latencyRegistry().stage("pipeline.sink");
+    LatencyHistogram& endToEnd = latencyRegistry().stage("pipeline.end-to-end");
+    FramePacket packet;
+    while (outputRing_.pop(packet)) {
+        delivered_++;
+        bool keepGoing;
+        {
+            ScopedLatency timer(sinkLatency);
+            keepGoing = sink_(packet);
+        }
+        endToEnd.record(std::chrono::steady_clock::now() - packet.captured);
+        if (!keepGoing) break;
+    }
+
+    stop();
+    join();
+    return 0;
+}
+
+void FramePipeline::stop() {
+    running_ = false;
+    if (source_) source_->interrupt();
+    captureRing_.close();
+    outputRing_.close();
+}
+
+void FramePipeline::join() {
+    if (captureThread_.joinable()) captureThread_.join();
+    if (processThread_.joinable()) processThread_.join();
+}
+
+void FramePipeline::captureLoop() {
+    LatencyHistogram& captureLatency = latencyRegistry().stage("pipeline.capture");
+    uint64_t sequence = 0;
+    while (running_) {
+        FramePacket packet;
+        {
+            ScopedLatency timer(captureLatency);
+            if (!capture_(packet)) break;  // End of stream
+        }
+        if (packet.image.empty()) continue;
+
+        packet.sequence = sequence++;
+        packet.captured = std::chrono::steady_clock::now();
+        captured_++;
+        captureRing_.push(std::move(packet));
+    }
+    captureRing_.close();  // Lets processing drain and finish
+}
+
+void FramePipeline::processLoop() {
+    LatencyHistogram& processLatency = latencyRegistry().stage("pipeline.process");
+    FramePacket packet;
+    while (captureRing_.pop(packet)) {
+        {
+            ScopedLatency timer(processLatency);
+            process_(packet);
+        }
+        processed_++;
+        outputRing_.push(std::move(packet));
+    }
+    outputRing_.close();
+}
+
+PipelineCounters FramePipeline::counters() const {
+    PipelineCounters c;
+    c.captured = captured_;
+    c.processed = processed_;
+    c.delivered = delivered_;
+    c.droppedCapture = captureRing_.dropped();
+    c.droppedOutput = outputRing_.dropped();
+    c.captureDepth = captureRing_.depth();
+    c.captureMaxDepth = captureRing_.maxDepth();
+    c.outputDepth = outputRing_.depth();
+    c.outputMaxDepth = outputRing_.maxDepth();
+    return c;
+}
+
+bool convertPacketToBGR(FramePacket& packet, const cv::Mat& into) {
+    if (packet.pixelFormat == V4L2_PIX_FMT_BGR24) return !packet.image.empty();
+
+    cv::Mat bgr = into;  // Header only; cvtColor keeps the buffer if it fits
+    if (!convertToBGR(packet.image, packet.pixelFormat, bgr)) return false;
+
+    packet.image = bgr;
+    packet.pixelFormat = V4L2_PIX_FMT_BGR24;
+    packet.lease.reset();
+    return true;
+}
+
+void printPipelineCounters(const PipelineCounters& c) {
+    std::cout << "Pipeline -> Captured: " << c.captured
+              << ", Processed: " << c.processed
+              << ", Delivered: " << c.delivered
+              << ", Dropped (capture/output): " << c.droppedCapture << "/" << c.droppedOutput
+              << ", Queue depth (capture/output): " << c.captureDepth << "/" << c.outputDepth
+              << ", Max depth: " << c.captureMaxDepth << "/" << c.outputMaxDepth << "\n";
+}
+
+// **Signal Handling**
+namespace {
+
+int stopPipe[2] = {-1, -1};  // Written by the handler, read by the watcher
+const char kSignalled = 's';
+const char kQuit = 'q';
+
+void onStopSignal(int) {
+    const int savedErrno = errno;
+    ssize_t written = write(stopPipe[1], &kSignalled, 1);  // Async-signal-safe
+    (void)written;
+    errno = savedErrno;
+}
+
+}  // namespace
+
+PipelineSignalStop::PipelineSignalStop(FramePipeline& pipeline) : signalled_(false) {
+    if (pipe(stopPipe) == -1) {
+        std::cerr << "Error: Cannot create the signal pipe: " << std::strerror(errno) << "\n";
+        return;
+    }
+
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_handler = onStopSignal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESETHAND;  // The next signal kills as usual
+    sigaction(SIGINT, &action, &previousInt_);
+    sigaction(SIGTERM, &action, &previousTerm_);
+    installed_ = true;
+    thread_ = std::thread(&PipelineSignalStop::watch, this, std::ref(pipeline));
+}
+
+PipelineSignalStop::~PipelineSignalStop() {
+    if (!installed_) return;
+    sigaction(SIGINT, &previousInt_, nullptr);
+    sigaction(SIGTERM, &previousTerm_, nullptr);
+    ssize_t written = write(stopPipe[1], &kQuit, 1);
+    (void)written;
+    thread_.join();
+    close(stopPipe[0]);
+    close(stopPipe[1]);
+    stopPipe[0] = stopPipe[1] = -1;
+}
+
+void PipelineSignalStop::watch(FramePipeline& pipeline) {
+    char c;
+    for (;;) {
+        ssize_t n = read(stopPipe[0], &c, 1);
+        if (n == -1 && errno == EINTR) continue;
+        if (n != 1 || c == kQuit) return;
+        if (!signalled_.exchange(true)) {
+            std::cerr << "Stopping (signal again to quit at once)\n";
+            pipeline.stop();
+        }
+    }
+}
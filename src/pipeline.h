@@ -0,0 +1,148 @@
+// Capture / process / sink runtime for the live programs.
+// Capture and processing each run on their own thread; the sink (imshow,
+// waitKey, camera controls) runs on the thread that calls run(), so GUI code
+// stays on the main thread. Stages are connected by FrameRings, so a slow
+// stage drops or delays frames according to its policy instead of stalling
+// the camera.
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <signal.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+
+#include "frame_arena.h"
+#include "frame_ring.h"
+#include "frame_source.h"
+#include "frame_stats.h"
+
+// **One Frame Travelling Through the Pipeline**
+struct FramePacket {
+    cv::Mat image;       // Captured frame (BGR unless pixelFormat says otherwise)
+    cv::Mat result;      // Output of the processing stage
+    FrameStats stats;    // Filled in by processing stages that analyse the frame
+                         // (histograms stay in the stage's FrameAnalyzer)
+    uint64_t sequence = 0;
+    std::chrono::steady_clock::time_point captured;
+
+    uint32_t pixelFormat = V4L2_PIX_FMT_BGR24;
+    std::shared_ptr<void> lease;  // Keeps a zero-copy source buffer alive
+    FrameArena::Lease buffers;    // Preallocated buffers image / result may point into
+};
+
+// **Queue Sizes and Overflow Policies**
+struct PipelineConfig {
+    size_t captureQueue = 2;
+    size_t outputQueue = 2;
+    OverflowPolicy capturePolicy = OverflowPolicy::DropOldest;
+    OverflowPolicy outputPolicy = OverflowPolicy::DropOldest;
+};
+
+// **Processed Packets That Can Be Alive at Once**
+// The output queue, the packet being processed, the one the sink holds and
+// one being dropped from the full queue. Size a FrameArena used by the
+// processing stage with this, so acquire() never comes back empty.
+inline size_t processedFramesInFlight(const PipelineConfig& config) {
+    return config.outputQueue + 3;
+}
+
+// **Snapshot of the Pipeline Counters**
+struct PipelineCounters {
+    uint64_t captured = 0;
+    uint64_t processed = 0;
+    uint64_t delivered = 0;
+    uint64_t droppedCapture = 0;  // Dropped between capture and processing
+    uint64_t droppedOutput = 0;   // Dropped between processing and the sink
+    size_t captureDepth = 0, captureMaxDepth = 0;
+    size_t outputDepth = 0, outputMaxDepth = 0;
+};
+
+class FramePipeline {
+public:
+    // Fills the Mat with the next frame; returns false at end of stream.
+    using CaptureFn = std::function<bool(cv::Mat&)>;
+    // Processes packet.image into packet.result (and packet.stats if wanted).
+    using ProcessFn = std::function<void(FramePacket&)>;
+    // Consumes a processed packet; returns false to stop the pipeline.
+    using SinkFn = std::function<bool(FramePacket&)>;
+
+    FramePipeline(const PipelineConfig& config, CaptureFn capture, ProcessFn process, SinkFn sink);
+
+    // Captures from a FrameSource without copying: packets carry the
+    // source's native-format image and lease, and the buffer goes back to
+    // the source when the last stage drops the packet.
+    FramePipeline(const PipelineConfig& config, FrameSource& source, ProcessFn process, SinkFn sink);
+
+    ~FramePipeline();
+
+    FramePipeline(const FramePipeline&) = delete;
+    FramePipeline& operator=(const FramePipeline&) = delete;
+
+    // Runs until the sink returns false or capture ends. Returns 0.
+    int run();
+
+    // Asks every stage to finish; safe to call from any thread. Interrupts
+    // the FrameSource, so a capture waiting on a stalled camera returns too.
+    void stop();
+
+    PipelineCounters counters() const;
+
+private:
+    void captureLoop();
+    void processLoop();
+    void join();
+
+    std::function<bool(FramePacket&)> capture_;
+    FrameSource* source_ = nullptr;  // Null with a CaptureFn
+    ProcessFn process_;
+    SinkFn sink_;
+
+    FrameRing<FramePacket> captureRing_;
+    FrameRing<FramePacket> outputRing_;
+
+    std::atomic<bool> running_;
+    std::atomic<uint64_t> captured_, processed_, delivered_;
+    std::thread captureThread_;
+    std::thread processThread_;
+};
+
+// **Convert packet.image to BGR**
+// When the conversion copies the data out of a zero-copy source buffer, the
+// lease is dropped at once so the buffer goes straight back to the source.
+// If into is a preallocated Mat of the frame's size (e.g. from a FrameArena
+// lease), the conversion writes there instead of allocating.
+bool convertPacketToBGR(FramePacket& packet, const cv::Mat& into = cv::Mat());
+
+// **Print the Counters in One Line**
+void printPipelineCounters(const PipelineCounters& c);
+
+// **Ctrl-C and SIGTERM Stop the Pipeline Instead of Killing the Process**
+// So run() returns and the program still closes its recording and prints
+// its statistics. The handler only writes to a pipe; a watcher thread calls
+// pipeline.stop(). A second signal gets the default action, for a pipeline
+// that does not wind down. One instance at a time; the previous handlers
+// are restored when it is destroyed.
+class PipelineSignalStop {
+public:
+    explicit PipelineSignalStop(FramePipeline& pipeline);
+    ~PipelineSignalStop();
+
+    PipelineSignalStop(const PipelineSignalStop&) = delete;
+    PipelineSignalStop& operator=(const PipelineSignalStop&) = delete;
+
+    bool signalled() const { return signalled_; }
+
+private:
+    void watch(FramePipeline& pipeline);
+
+    bool installed_ = false;
+    std::atomic<bool> signalled_;
+    struct sigaction previousInt_, previousTerm_;
+    std::thread thread_;
+};
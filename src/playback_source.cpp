@@ -0,0 +1,370 @@
+#include "playback_source.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <utility>
+
+namespace {
+
+// Captured, queued, processed, displayed and dropped frames at once (see
+// processedFramesInFlight), plus the one being produced
+const size_t kBuffers = 8;
+// Preloading stops here rather than exhausting memory on a long file
+const size_t kMaxPreloadBytes = size_t(2) << 30;
+
+// **A Buffer on Loan; Keeps the Arena Alive Until It Is Returned**
+struct HeldBuffer {
+    std::shared_ptr<FrameArena> arena;
+    FrameArena::Lease lease;  // Destroyed first
+};
+
+std::string lowercaseExtension(const std::string& path) {
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of('/');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return "";
+    std::string ext = path.substr(dot + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+    return ext;
+}
+
+bool isImageExtension(const std::string& ext) {
+    return ext == "jpg" || ext == "jpeg" || ext == "png" || ext == "bmp" || ext == "tif" || ext == "tiff";
+}
+
+bool isVideoExtension(const std::string& ext) {
+    return ext == "mp4" || ext == "avi" || ext == "mkv" || ext == "mov" || ext == "webm";
+}
+
+bool isDirectory(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+// Copies src into out, scaling if the sizes differ; out keeps its buffer
+// when it already has the right size.
+void fitInto(const cv::Mat& src, cv::Size size, cv::Mat& out) {
+    if (src.size() == size) src.copyTo(out);
+    else cv::resize(src, out, size, 0, 0, cv::INTER_AREA);
+}
+
+}  // namespace
+
+// **Playback Base**
+PlaybackSource::PlaybackSource(const PlaybackOptions& options) : options_(options) {}
+
+PlaybackSource::~PlaybackSource() = default;
+
+void PlaybackSource::finishOpen(cv::Size size, double nativeFps, bool paced) {
+    size_ = size;
+    paced_ = paced;
+    fps_ = options_.fps > 0 ? options_.fps : (nativeFps > 0 ? nativeFps : 30.0);
+    if (size_.area() <= 0) return;
+
+    arena_ = std::make_shared<FrameArena>(kBuffers);
+    bufferIndex_ = arena_->reserve(size_, CV_8UC3);
+    if (!arena_->allocate()) return;
+
+    // **Decode Everything Now, So the Run Measures Only the Processing**
+    if (options_.preload && paced_) {
+        const size_t bytesPerFrame = size_.area() * 3;
+        cv::Mat frame;
+        while ((options_.maxFrames == 0 || preloaded_.size() < options_.maxFrames)) {
+            if ((preloaded_.size() + 1) * bytesPerFrame > kMaxPreloadBytes) {
+                std::cerr << "Warning: Preloading stopped at " << preloaded_.size() << " frames (memory limit)\n";
+                break;
+            }
+            frame.create(size_, CV_8UC3);
+            if (!produce(frame)) break;
+            preloaded_.push_back(frame);
+            frame.release();  // The next frame gets its own buffer
+        }
+        if (preloaded_.empty()) {
+            std::cerr << "Error: Nothing to preload\n";
+            return;
+        }
+        std::cout << "Preloaded " << preloaded_.size() << " frames ("
+                  << preloaded_.size() * bytesPerFrame / (1024 * 1024) << " MiB)\n";
+    }
+
+    opened_ = true;
+    deadline_ = std::chrono::steady_clock::now();
+}
+
+bool PlaybackSource::read(CapturedFrame& frame) {
+    if (!opened_) return false;
+
+    FrameArena::Lease lease = arena_->acquire();  // Empty if all are out: the frame allocates
+    cv::Mat out;
+    if (lease) out = lease[bufferIndex_];
+    if (!nextFrame(out)) return false;
+    if (paced_ && !options_.freeRun) pace();
+
+    frame.image = out;
+    frame.pixelFormat = V4L2_PIX_FMT_BGR24;
+    frame.sequence = sequence_++;
+    if (lease) frame.lease = std::make_shared<HeldBuffer>(HeldBuffer{arena_, std::move(lease)});
+    else frame.lease.reset();  // out owns its data
+    return true;
+}
+
+// **Next Frame of the Pass; Starts Over at the End When Looping**
+bool PlaybackSource::nextFrame(cv::Mat& out) {
+    const size_t passLength = !preloaded_.empty() ? preloaded_.size() : options_.maxFrames;  // 0 = until the end
+    if (passLength == 0 || position_ < passLength) {
+        if (!preloaded_.empty()) {
+            preloaded_[position_].copyTo(out);  // Processing may edit the frame in place
+            position_++;
+            return true;
+        }
+        if (produce(out)) {
+            position_++;
+            return true;
+        }
+    }
+
+    // Nothing to loop over if the pass was empty
+    if (!options_.loop || position_ == 0) return false;
+    position_ = 0;
+    if (preloaded_.empty() && !rewind()) return false;
+    return nextFrame(out);
+}
+
+// **Deliver at fps, Like a Camera**
+// A late frame resets the schedule instead of bursting to catch up.
+void PlaybackSource::pace() {
+    auto now = std::chrono::steady_clock::now();
+    auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / fps_));
+    if (deadline_ + period < now) deadline_ = now;
+    else if (deadline_ > now) std::this_thread::sleep_until(deadline_);
+    deadline_ += period;
+}
+
+// **cv::VideoCapture: Camera or Video File**
+VideoCaptureSource::VideoCaptureSource(int camera, cv::Size size, const PlaybackOptions& options)
+    : PlaybackSource(options), live_(true) {
+    if (!capture_.open(camera)) {
+        std::cerr << "Error: Cannot open camera " << camera << "\n";
+        return;
+    }
+    capture_.set(cv::CAP_PROP_FRAME_WIDTH, size.width);
+    capture_.set(cv::CAP_PROP_FRAME_HEIGHT, size.height);
+    cv::Size actual(static_cast<int>(capture_.get(cv::CAP_PROP_FRAME_WIDTH)),
+                    static_cast<int>(capture_.get(cv::CAP_PROP_FRAME_HEIGHT)));
+    finishOpen(actual.area() > 0 ? actual : size, capture_.get(cv::CAP_PROP_FPS), false);
+}
+
+VideoCaptureSource::VideoCaptureSource(const std::string& path, const PlaybackOptions& options)
+    : PlaybackSource(options), live_(false) {
+    if (!capture_.open(path)) {
+        std::cerr << "Error: Cannot open video " << path << "\n";
+        return;
+    }
+    cv::Size size(static_cast<int>(capture_.get(cv::CAP_PROP_FRAME_WIDTH)),
+                  static_cast<int>(capture_.get(cv::CAP_PROP_FRAME_HEIGHT)));
+    if (size.area() <= 0) {
+        // Some containers report no size: take it from the first frame
+        if (!capture_.read(decoded_) || !rewind()) {
+            std::cerr << "Error: " << path << " has no readable frames\n";
+            return;
+        }
+        size = decoded_.size();
+    }
+    finishOpen(size, capture_.get(cv::CAP_PROP_FPS));
+}
+
+bool VideoCaptureSource::produce(cv::Mat& out) {
+    // A camera occasionally returns an empty frame; a file only at its end
+    const int attempts = live_ ? 5 : 1;
+    for (int i = 0; i < attempts; i++) {
+        if (capture_.read(decoded_) && !decoded_.empty()) {
+            fitInto(decoded_, frameSize(), out);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool VideoCaptureSource::rewind() {
+    return !live_ && capture_.set(cv::CAP_PROP_POS_FRAMES, 0);
+}
+
+// **Image Sequence**
+ImageSequenceSource::ImageSequenceSource(const std::string& pattern, const PlaybackOptions& options)
+    : PlaybackSource(options) {
+    std::vector<cv::String> found;
+    if (isDirectory(pattern)) {
+        cv::glob(pattern, found, false);
+    } else if (pattern.find_first_of("*?") != std::string::npos) {
+        cv::glob(pattern, found, false);
+    } else {
+        found.push_back(pattern);
+    }
+    for (const cv::String& f : found) {
+        if (isImageExtension(lowercaseExtension(f))) files_.push_back(f);
+    }
+    std::sort(files_.begin(), files_.end());
+    if (files_.empty()) {
+        std::cerr << "Error: No images match " << pattern << "\n";
+        return;
+    }
+
+    cv::Mat first = cv::imread(files_[0], cv::IMREAD_COLOR);
+    if (first.empty()) {
+        std::cerr << "Error: Cannot read " << files_[0] << "\n";
+        return;
+    }
+    finishOpen(first.size(), 0);
+}
+
+bool ImageSequenceSource::produce(cv::Mat& out) {
+    while (next_ < files_.size()) {
+        cv::Mat image = cv::imread(files_[next_++], cv::IMREAD_COLOR);
+        if (image.empty()) {
+            std::cerr << "Warning: Skipping unreadable " << files_[next_ - 1] << "\n";
+            continue;
+        }
+        fitInto(image, frameSize(), out);
+        return true;
+    }
+    return false;
+}
+
+bool ImageSequenceSource::rewind() {
+    next_ = 0;
+    return true;
+}
+
+// **Synthetic Pattern**
+SyntheticSource::SyntheticSource(cv::Size size, Pattern pattern, const PlaybackOptions& options, uint64_t seed)
+    : PlaybackSource(options), pattern_(pattern), seed_(seed) {
+    if (size.area() <= 0) {
+        std::cerr << "Error: Invalid synthetic frame size\n";
+        return;
+    }
+
+    base_.create(size, CV_8UC3);
+    if (pattern_ == Pattern::Gradient) {
+        for (int y = 0; y < size.height; y++) {
+            cv::Vec3b* row = base_.ptr<cv::Vec3b>(y);
+            for (int x = 0; x < size.width; x++) {
+                uchar u = static_cast<uchar>(x * 255 / std::max(1, size.width - 1));
+                uchar v = static_cast<uchar>(y * 255 / std::max(1, size.height - 1));
+                row[x] = cv::Vec3b(u, v, static_cast<uchar>(255 - u));
+            }
+        }
+    } else {
+        // Seven bars over a gray ramp
+        static const cv::Scalar bars[] = {
+            {235, 235, 235}, {16, 235, 235}, {235, 235, 16}, {16, 235, 16},
+            {235, 16, 235}, {16, 16, 235}, {235, 16, 16},
+        };
+        const int barRows = size.height * 2 / 3;
+        for (int i = 0; i < 7; i++) {
+            int x0 = size.width * i / 7, x1 = size.width * (i + 1) / 7;
+            base_(cv::Rect(x0, 0, x1 - x0, barRows)).setTo(bars[i]);
+        }
+        for (int x = 0; x < size.width; x++) {
+            uchar v = static_cast<uchar>(x * 255 / std::max(1, size.width - 1));
+            base_(cv::Rect(x, barRows, 1, size.height - barRows)).setTo(cv::Scalar::all(v));
+        }
+    }
+    finishOpen(size, 30.0);
+}
+
+bool SyntheticSource::produce(cv::Mat& out) {
+    const cv::Size size = frameSize();
+    base_.copyTo(out);
+
+    // Box crossing the frame, one step per frame
+    const int box = std::max(8, size.height / 6);
+    const int travel = std::max(1, size.width - box);
+    const int x = static_cast<int>((frame_ * 8) % (2 * travel));
+    cv::rectangle(out, cv::Rect(x < travel ? x : 2 * travel - x, (size.height - box) / 2, box, box),
+                  cv::Scalar(40, 200, 255), cv::FILLED);
+    cv::putText(out, "frame " + std::to_string(frame_), cv::Point(10, size.height - 12),
+                cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(0, 0, 0), 2);
+
+    // Seeded per frame, so frame n is identical on every run
+    const double amplitude = pattern_ == Pattern::Noise ? 48 : 6;
+    cv::RNG rng(seed_ * 1000003 + frame_ + 1);
+    noise_.create(size, CV_8UC3);
+    rng.fill(noise_, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(amplitude));
+    cv::add(out, noise_, out);
+    cv::subtract(out, cv::Scalar::all(amplitude / 2), out);
+
+    frame_++;
+    return true;
+}
+
+bool SyntheticSource::rewind() {
+    frame_ = 0;
+    return true;
+}
+
+// **Factory**
+std::unique_ptr<FrameSource> openFrameSource(const std::string& spec, cv::Size size, uint32_t pixelFormat,
+                                             const PlaybackOptions& options) {
+    std::unique_ptr<FrameSource> source;
+    const std::string ext = lowercaseExtension(spec);
+
+    if (spec.compare(0, 10, "/dev/video") == 0) {
+        source.reset(new V4L2MmapSource(spec, size, pixelFormat));
+    } else if (!spec.empty() && std::all_of(spec.begin(), spec.end(), [](unsigned char c) { return std::isdigit(c); })) {
+        source.reset(new VideoCaptureSource(std::atoi(spec.c_str()), size, options));
+    } else if (spec.compare(0, 9, "synthetic") == 0) {
+        std::string kind = spec.size() > 10 && spec[9] == ':' ? spec.substr(10) : "bars";
+        SyntheticSource::Pattern pattern;
+        if (kind == "bars") pattern = SyntheticSource::Pattern::Bars;
+        else if (kind == "gradient") pattern = SyntheticSource::Pattern::Gradient;
+        else if (kind == "noise") pattern = SyntheticSource::Pattern::Noise;
+        else {
+            std::cerr << "Error: Unknown synthetic pattern '" << kind << "' (bars, gradient, noise)\n";
+            return nullptr;
+        }
+        if (options.preload && options.maxFrames == 0) {
+            std::cerr << "Error: --preload on a synthetic source needs --frames N (the pattern never ends)\n";
+            return nullptr;
+        }
+        source.reset(new SyntheticSource(size, pattern, options));
+    } else if (isDirectory(spec) || spec.find_first_of("*?") != std::string::npos || isImageExtension(ext)) {
+        source.reset(new ImageSequenceSource(spec, options));
+    } else if (isVideoExtension(ext)) {
+        source.reset(new VideoCaptureSource(spec, options));
+    } else {
+        source.reset(new RawFileSource(spec, size, pixelFormat, options.loop));
+    }
+
+    if (!source->isOpened()) {
+        std::cerr << "Error: Cannot open source " << spec << "\n";
+        return nullptr;
+    }
+    return source;
+}
+
+std::string cameraDeviceForSource(const std::string& spec) {
+    if (spec.compare(0, 10, "/dev/video") == 0) return spec;
+    if (!spec.empty() && std::all_of(spec.begin(), spec.end(), [](unsigned char c) { return std::isdigit(c); })) {
+        return "/dev/video" + spec;
+    }
+    return std::string();
+}
+
+bool parseSourceOption(int argc, char** argv, int& i, std::string& spec, PlaybackOptions& options) {
+    std::string arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+
+    if (arg == "--free-run") options.freeRun = true;
+    else if (arg == "--preload") options.preload = true;
+    else if (arg == "--once") options.loop = false;
+    else if (arg == "--source" && hasValue) spec = argv[++i];
+    else if (arg == "--fps" && hasValue) options.fps = std::max(0.0, std::atof(argv[++i]));
+    else if (arg == "--frames" && hasValue) options.maxFrames = static_cast<size_t>(std::max(0, std::atoi(argv[++i])));
+    else return false;
+    return true;
+}
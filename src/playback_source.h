@@ -0,0 +1,174 @@
+// Frame sources for runs without a camera: CI, build servers, profiling.
+// Every live program used to read cv::VideoCapture(0), so none of them could
+// run headless or repeatably. These sources implement FrameSource and
+// deliver BGR24 frames:
+//
+//   VideoCaptureSource    a live camera through cv::VideoCapture, or a video file
+//   ImageSequenceSource   a glob pattern (e.g. ../image*.jpeg) or a single image
+//   SyntheticSource       a deterministic moving test pattern
+//
+// openFrameSource() picks one (or V4L2MmapSource / RawFileSource) from a
+// command-line spec. File and synthetic sources are paced to a frame rate
+// like a camera. In free-run mode they deliver frames as fast as read() is
+// called. Pair that with Block policies in the pipeline, so every frame is
+// processed and a run takes as long as the processing does. With preload,
+// every frame is decoded up front, so decode cost does not show up in
+// measurements of the enhancement code. Frames are written into a small
+// FrameArena and go back to it when the lease is dropped.
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "frame_arena.h"
+#include "frame_source.h"
+
+// **Playback Options Shared by the File-Backed and Synthetic Sources**
+struct PlaybackOptions {
+    double fps = 0;           // Delivery rate; 0 = the file's own rate (30 if unknown)
+    bool freeRun = false;     // Deliver as fast as read() is called
+    bool loop = true;         // Start over at the end instead of ending the stream
+    bool preload = false;     // Decode every frame into memory first
+    size_t maxFrames = 0;     // Frames per pass; 0 = the whole file (synthetic: endless)
+};
+
+// **Base for Sources That Produce Frames Themselves**
+// Handles pacing, looping, preloading and buffer reuse; subclasses only
+// decode or render the next frame.
+class PlaybackSource : public FrameSource {
+public:
+    ~PlaybackSource() override;
+
+    bool isOpened() const override { return opened_; }
+    bool read(CapturedFrame& frame) override;
+    cv::Size frameSize() const override { return size_; }
+    uint32_t pixelFormat() const override { return V4L2_PIX_FMT_BGR24; }
+
+    double fps() const { return fps_; }
+    const PlaybackOptions& options() const { return options_; }
+    size_t preloadedFrames() const { return preloaded_.size(); }
+
+protected:
+    explicit PlaybackSource(const PlaybackOptions& options);
+
+    // Call at the end of the subclass constructor, once the frame size and
+    // native rate are known; preloads if asked. paced = false for sources
+    // that wait for frames themselves (a live camera).
+    void finishOpen(cv::Size size, double nativeFps, bool paced = true);
+
+    // Writes the next frame (BGR, frameSize()) into out; false at the end.
+    virtual bool produce(cv::Mat& out) = 0;
+    // Back to the first frame; false if the source cannot (a live camera).
+    virtual bool rewind() = 0;
+
+private:
+    bool nextFrame(cv::Mat& out);
+    void pace();
+
+    PlaybackOptions options_;
+    bool opened_ = false;
+    bool paced_ = true;
+    cv::Size size_;
+    double fps_ = 0;
+
+    std::vector<cv::Mat> preloaded_;
+    size_t position_ = 0;  // Frames delivered in the current pass
+    uint64_t sequence_ = 0;
+    std::chrono::steady_clock::time_point deadline_;
+
+    std::shared_ptr<FrameArena> arena_;  // Shared with outstanding leases
+    int bufferIndex_ = -1;
+};
+
+// **Live Camera or Video File Read with cv::VideoCapture**
+class VideoCaptureSource : public PlaybackSource {
+public:
+    // Live camera: size is requested, the camera paces delivery.
+    VideoCaptureSource(int camera, cv::Size size, const PlaybackOptions& options = PlaybackOptions());
+    // Video file: paced to options.fps, or the file's rate.
+    explicit VideoCaptureSource(const std::string& path, const PlaybackOptions& options = PlaybackOptions());
+
+private:
+    bool produce(cv::Mat& out) override;
+    bool rewind() override;
+
+    cv::VideoCapture capture_;
+    bool live_;
+    cv::Mat decoded_;
+};
+
+// **Still Images, in Name Order**
+// Every image is scaled to the size of the first one.
+class ImageSequenceSource : public PlaybackSource {
+public:
+    // pattern: a cv::glob pattern ("../image*.jpeg"), a directory, or one file.
+    explicit ImageSequenceSource(const std::string& pattern, const PlaybackOptions& options = PlaybackOptions());
+
+    const std::vector<std::string>& files() const { return files_; }
+
+private:
+    bool produce(cv::Mat& out) override;
+    bool rewind() override;
+
+    std::vector<std::string> files_;
+    size_t next_ = 0;
+};
+
+// **Deterministic Test Pattern**
+// Color bars, a horizontal gradient and a box moving one step per frame,
+// plus seeded noise; frame n is the same on every run.
+class SyntheticSource : public PlaybackSource {
+public:
+    enum class Pattern {
+        Bars,      // Color bars and moving box
+        Gradient,  // Gradient and moving box (smooth content)
+        Noise,     // Bars with strong per-pixel noise (denoise input)
+    };
+
+    SyntheticSource(cv::Size size, Pattern pattern = Pattern::Bars, const PlaybackOptions& options = PlaybackOptions(),
+                    uint64_t seed = 1);
+
+private:
+    bool produce(cv::Mat& out) override;
+    bool rewind() override;
+
+    Pattern pattern_;
+    uint64_t seed_;
+    uint64_t frame_ = 0;
+    cv::Mat base_;  // Static part of the pattern, rendered once
+    cv::Mat noise_;
+};
+
+// **Open a Source from a Command-Line Spec**
+//   /dev/videoN                     V4L2MmapSource (zero-copy, native format)
+//   0, 1, ...                       VideoCaptureSource on that camera index
+//   synthetic[:bars|gradient|noise] SyntheticSource of the given size
+//   *.jpg|jpeg|png|bmp, pattern, directory
+//                                   ImageSequenceSource
+//   *.mp4|avi|mkv|mov|webm          VideoCaptureSource on the file
+//   any other file                  RawFileSource with frames of size / pixelFormat
+// Returns null (after printing an error) if the source cannot be opened.
+// Preloading a synthetic source needs options.maxFrames, as it never ends.
+std::unique_ptr<FrameSource> openFrameSource(const std::string& spec, cv::Size size,
+                                             uint32_t pixelFormat = V4L2_PIX_FMT_YUYV,
+                                             const PlaybackOptions& options = PlaybackOptions());
+
+// **V4L2 Device Behind a Camera Spec**
+// "/dev/videoN" itself, "/dev/videoN" for camera index N; empty for file and
+// synthetic sources, which have no camera controls.
+std::string cameraDeviceForSource(const std::string& spec);
+
+// **Command-Line Options Shared by the Programs That Take a Source**
+//   --source SPEC   see openFrameSource()
+//   --fps N         delivery rate of file and synthetic sources
+//   --free-run      deliver as fast as the pipeline accepts
+//   --preload       decode everything before the run starts
+//   --frames N      frames per pass
+//   --once          end the stream after one pass instead of looping
+// Consumes argv[i] (and its value) if it is one of these and returns true.
+bool parseSourceOption(int argc, char** argv, int& i, std::string& spec, PlaybackOptions& options);
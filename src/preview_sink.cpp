@@ -0,0 +1,140 @@
+#include "preview_sink.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+
+namespace {
+
+// waitKey is pumped at least this often, so windows stay responsive
+// between frames
+const std::chrono::milliseconds kEventPoll(10);
+// Keys nobody polls for are dropped beyond this
+const size_t kMaxQueuedKeys = 64;
+
+}  // namespace
+
+PreviewSink::PreviewSink(const PreviewConfig& config)
+    : config_(config),
+      period_(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double>(1.0 / std::max(0.1, config.fps)))),
+      showLatency_(latencyRegistry().stage("preview")),
+      posted_(0), skipped_(0), shown_(0) {
+    if (!config_.headless) thread_ = std::thread(&PreviewSink::loop, this);
+}
+
+PreviewSink::~PreviewSink() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) thread_.join();
+}
+
+int PreviewSink::addWindow(const std::string& title) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    windows_.emplace_back(new Window());
+    windows_.back()->title = title;
+    return static_cast<int>(windows_.size()) - 1;
+}
+
+// **Decimation: At Most fps Frames a Second per Window**
+// A frame up to a quarter period early still counts as due, so 30 fps
+// input previewed at 15 fps shows every other frame rather than every third.
+bool PreviewSink::post(int window, const cv::Mat& frame) {
+    if (config_.headless || frame.empty()) return false;
+
+    auto now = std::chrono::steady_clock::now();
+    Window* w;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (window < 0 || window >= static_cast<int>(windows_.size())) return false;
+        w = windows_[window].get();
+        if (now < w->due - period_ / 4) {
+            skipped_++;
+            return false;
+        }
+        w->due = w->due + period_ < now ? now + period_ : w->due + period_;
+    }
+
+    // **Scale Down Outside the Lock, Then Swap It In**
+    // Only the preview-sized image is written, into a buffer that an earlier
+    // swap handed back, so neither the copy nor an allocation happens under
+    // the mutex the preview thread takes.
+    if (config_.maxWidth > 0 && frame.cols > config_.maxWidth) {
+        double scale = static_cast<double>(config_.maxWidth) / frame.cols;
+        cv::resize(frame, w->staging, cv::Size(), scale, scale, cv::INTER_AREA);
+    } else {
+        frame.copyTo(w->staging);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::swap(w->staging, w->pending);
+        w->fresh = true;
+    }
+    posted_++;
+    wake_.notify_one();
+    return true;
+}
+
+bool PreviewSink::pollKey(int& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (keys_.empty()) return false;
+    key = keys_.front();
+    keys_.pop_front();
+    return true;
+}
+
+PreviewStats PreviewSink::stats() const {
+    PreviewStats s;
+    s.posted = posted_;
+    s.skipped = skipped_;
+    s.shown = shown_;
+    return s;
+}
+
+// **Preview Thread: Every HighGUI Call Happens Here**
+void PreviewSink::loop() {
+    std::vector<Window*> toShow;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        wake_.wait_for(lock, kEventPoll);
+        if (stopping_) break;
+
+        toShow.clear();
+        for (std::unique_ptr<Window>& w : windows_) {
+            if (!w->fresh) continue;
+            std::swap(w->pending, w->showing);
+            w->fresh = false;
+            toShow.push_back(w.get());
+        }
+        lock.unlock();
+
+        int key;
+        {
+            ScopedLatency timer(showLatency_);
+            for (Window* w : toShow) {
+                cv::imshow(w->title, w->showing);
+                shown_++;
+            }
+            key = cv::waitKey(1);
+        }
+
+        lock.lock();
+        if (key >= 0 && keys_.size() < kMaxQueuedKeys) keys_.push_back(key & 0xFF);
+    }
+    lock.unlock();
+    cv::destroyAllWindows();
+}
+
+bool parsePreviewOption(int argc, char** argv, int& i, PreviewConfig& config) {
+    std::string arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+
+    if (arg == "--headless") config.headless = true;
+    else if (arg == "--preview-fps" && hasValue) config.fps = std::max(0.1, std::atof(argv[++i]));
+    else if (arg == "--preview-width" && hasValue) config.maxWidth = std::max(0, std::atoi(argv[++i]));
+    else return false;
+    return true;
+}
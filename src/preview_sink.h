@@ -0,0 +1,94 @@
+// Preview windows shown from their own thread.
+// The live loops used to call cv::imshow on every full-resolution frame and
+// cv::waitKey(1) on every iteration, sometimes for two windows, so GUI work
+// took a large share of each frame. PreviewSink owns every HighGUI call: the
+// pipeline's sink posts frames, and post() copies a frame only when its
+// window is due at the preview rate, scaled down to at most maxWidth. The
+// preview thread shows it and pumps waitKey. Key presses go into a
+// queue that the sink drains with pollKey(). Headless mode opens no windows
+// and starts no thread: post() returns at once, no keys arrive.
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "latency_stats.h"
+
+struct PreviewConfig {
+    double fps = 15.0;      // Refresh rate of each window, independent of processing
+    int maxWidth = 640;     // Larger frames are scaled down to this width
+    bool headless = false;  // No GUI at all
+};
+
+struct PreviewStats {
+    uint64_t posted = 0;   // Frames scaled down and copied for display
+    uint64_t skipped = 0;  // Frames offered before their window was due
+    uint64_t shown = 0;    // imshow calls
+};
+
+class PreviewSink {
+public:
+    explicit PreviewSink(const PreviewConfig& config);
+
+    // Stops the preview thread and closes the windows.
+    ~PreviewSink();
+
+    PreviewSink(const PreviewSink&) = delete;
+    PreviewSink& operator=(const PreviewSink&) = delete;
+
+    // **Register a Window; Returns the Index for post()**
+    int addWindow(const std::string& title);
+
+    // **Offer a Frame to a Window**
+    // Copies it at preview size (returns true) only if the window is due;
+    // cheap otherwise. Post to a given window from one thread only.
+    bool post(int window, const cv::Mat& frame);
+
+    // **Next Key Pressed in Any Window; False If None Is Waiting**
+    bool pollKey(int& key);
+
+    bool headless() const { return config_.headless; }
+    PreviewStats stats() const;
+
+private:
+    struct Window {
+        std::string title;
+        cv::Mat staging;   // post() only, written outside mutex_
+        cv::Mat pending;   // Latest posted frame, guarded by mutex_
+        bool fresh = false;
+        cv::Mat showing;   // Preview thread only
+        std::chrono::steady_clock::time_point due;
+    };
+
+    void loop();
+
+    PreviewConfig config_;
+    std::chrono::steady_clock::duration period_;
+    LatencyHistogram& showLatency_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+    std::vector<std::unique_ptr<Window>> windows_;  // Stable addresses for the preview thread
+    std::deque<int> keys_;
+
+    std::atomic<uint64_t> posted_, skipped_, shown_;
+    std::thread thread_;
+};
+
+// **Command-Line Options Shared by the Programs with a Preview**
+//   --headless          no windows (stop with --once, --frames or Ctrl-C)
+//   --preview-fps N     refresh rate of each window
+//   --preview-width N   maximum width of the shown frames
+// Consumes argv[i] (and its value) if it is one of these and returns true.
+bool parsePreviewOption(int argc, char** argv, int& i, PreviewConfig& config);
@@ -0,0 +1,203 @@
+#include "recording_sink.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <utility>
+
+bool parseOverflowPolicy(const std::string& name, OverflowPolicy& policy) {
+    if (name == "drop-oldest") policy = OverflowPolicy::DropOldest;
+    else if (name == "drop-newest") policy = OverflowPolicy::DropNewest;
+    else if (name == "block") policy = OverflowPolicy::Block;
+    else return false;
+    return true;
+}
+
+RecordingSink::RecordingSink(const RecorderConfig& config)
+    : config_(config), ring_(config.queueFrames, config.policy),
+      encodeLatency_(latencyRegistry().stage("encode")),
+      pushed_(0), encoded_(0), rejected_(0), files_(0), blockedMicros_(0), closed_(false),
+      lastStats_(std::chrono::steady_clock::now()) {
+    thread_ = std::thread(&RecordingSink::encodeLoop, this);
+}
+
+RecordingSink::~RecordingSink() {
+    close();
+}
+
+void RecordingSink::close() {
+    if (closed_.exchange(true)) return;
+    ring_.close();
+    if (thread_.joinable()) thread_.join();
+}
+
+// **Slots for the Queue, the Frame Being Encoded and the One Being Pushed**
+bool RecordingSink::allocate(const cv::Mat& first) {
+    if (first.type() != CV_8UC3) {
+        std::cerr << "Error: Recording needs CV_8UC3 frames\n";
+        return false;
+    }
+    size_ = first.size();
+    type_ = first.type();
+    arena_.reset(new FrameArena(ring_.capacity() + 2));
+    bufferIndex_ = arena_->reserve(size_, type_);
+    return arena_->allocate();
+}
+
+bool RecordingSink::push(const cv::Mat& frame) {
+    if (closed_ || frame.empty()) return false;
+    if (!arena_ && !allocate(frame)) {
+        rejected_++;
+        return false;
+    }
+    if (frame.size() != size_ || frame.type() != type_) {
+        rejected_++;
+        return false;
+    }
+
+    Frame item;
+    item.buffer = arena_->acquire();
+    if (item.buffer) {
+        item.image = item.buffer[bufferIndex_];
+        frame.copyTo(item.image);
+    } else {
+        item.image = frame.clone();  // Only if a slot is still held elsewhere
+    }
+
+    bool queued;
+    if (config_.policy == OverflowPolicy::Block) {
+        auto start = std::chrono::steady_clock::now();
+        queued = ring_.push(std::move(item));
+        blockedMicros_ += std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    } else {
+        queued = ring_.push(std::move(item));
+    }
+    if (queued) pushed_++;
+    return queued;
+}
+
+// **Next File of the Rolling Set; Deletes the One Falling Out of It**
+bool RecordingSink::openSegment() {
+    writer_.release();
+
+    char suffix[16];
+    std::snprintf(suffix, sizeof(suffix), "_%03d", fileIndex_);
+    std::string path = config_.prefix + suffix + config_.extension;
+    const std::string& f = config_.fourcc;
+    int fourcc = f.size() == 4 ? cv::VideoWriter::fourcc(f[0], f[1], f[2], f[3]) : 0;
+    if (!writer_.open(path, fourcc, config_.fps, size_, true)) {
+        std::cerr << "Error: Cannot open " << path << " for recording (" << f << ")\n";
+        return false;
+    }
+
+    if (config_.maxFiles > 0 && fileIndex_ >= config_.maxFiles) {
+        std::snprintf(suffix, sizeof(suffix), "_%03d", fileIndex_ - config_.maxFiles);
+        std::remove((config_.prefix + suffix + config_.extension).c_str());
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(fileMutex_);
+        currentFile_ = path;
+    }
+    fileIndex_++;
+    files_++;
+    segmentFrames_ = 0;
+    return true;
+}
+
+// **Encoder Thread**
+void RecordingSink::encodeLoop() {
+    const uint64_t framesPerSegment =
+        config_.segmentSeconds > 0 ? std::max<uint64_t>(1, config_.segmentSeconds * config_.fps) : 0;
+    bool failed = false;  // A file could not be opened: drain without writing
+
+    Frame item;
+    while (ring_.pop(item)) {
+        if (!failed && (!writer_.isOpened() || (framesPerSegment > 0 && segmentFrames_ >= framesPerSegment))) {
+            failed = !openSegment();
+        }
+        if (failed) {
+            rejected_++;
+            continue;
+        }
+
+        {
+            ScopedLatency timer(encodeLatency_);
+            writer_.write(item.image);
+        }
+        item = Frame();  // Slot back to the arena before waiting for the next frame
+        segmentFrames_++;
+        encoded_++;
+    }
+    writer_.release();
+}
+
+// **Snapshot (One Caller Thread); Cheap Enough to Call Every Frame**
+// The encode rate is refreshed once at least a second has passed.
+RecorderStats RecordingSink::stats() {
+    RecorderStats s;
+    s.pushed = pushed_;
+    s.encoded = encoded_;
+    s.dropped = ring_.dropped();
+    s.rejected = rejected_;
+    s.files = files_;
+    s.queueDepth = ring_.depth();
+    s.queueMaxDepth = ring_.maxDepth();
+    s.queueCapacity = ring_.capacity();
+    s.blockedSeconds = blockedMicros_ / 1e6;
+    {
+        std::lock_guard<std::mutex> lock(fileMutex_);
+        s.currentFile = currentFile_;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - lastStats_).count();
+    if (seconds >= 1.0) {
+        encodeFps_ = (s.encoded - reportedEncoded_) / seconds;
+        reportedEncoded_ = s.encoded;
+        lastStats_ = now;
+    }
+    s.encodeFps = encodeFps_;
+    return s;
+}
+
+std::string describeRecorderStats(const RecorderStats& stats) {
+    char line[256];
+    std::snprintf(line, sizeof(line),
+                  "Recording %s: %.1f fps encoded, queue %zu/%zu (max %zu), %llu dropped, %llu rejected, "
+                  "%.1f s blocked",
+                  stats.currentFile.empty() ? "-" : stats.currentFile.c_str(), stats.encodeFps,
+                  stats.queueDepth, stats.queueCapacity, stats.queueMaxDepth,
+                  static_cast<unsigned long long>(stats.dropped), static_cast<unsigned long long>(stats.rejected),
+                  stats.blockedSeconds);
+    return line;
+}
+
+bool parseRecorderOption(int argc, char** argv, int& i, RecorderConfig& config, bool& record) {
+    std::string arg = argv[i];
+    if (arg.compare(0, 8, "--record") != 0 || i + 1 >= argc) return false;
+    std::string value = argv[i + 1];
+
+    if (arg == "--record") {
+        config.prefix = value;
+        record = true;
+    } else if (arg == "--record-fps") {
+        config.fps = std::max(1.0, std::atof(value.c_str()));
+    } else if (arg == "--record-segment") {
+        config.segmentSeconds = std::max(0.0, std::atof(value.c_str()));
+    } else if (arg == "--record-files") {
+        config.maxFiles = std::max(0, std::atoi(value.c_str()));
+    } else if (arg == "--record-queue") {
+        config.queueFrames = static_cast<size_t>(std::max(1, std::atoi(value.c_str())));
+    } else if (arg == "--record-policy") {
+        if (!parseOverflowPolicy(value, config.policy)) {
+            std::cerr << "Error: Unknown recording policy '" << value << "', keeping the default\n";
+        }
+    } else {
+        return false;
+    }
+    i++;
+    return true;
+}
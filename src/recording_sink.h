@@ -0,0 +1,122 @@
+// Asynchronous recording of the processed stream.
+// Calling cv::VideoWriter::write from the sink would put encoder latency on
+// every frame. RecordingSink::push only copies the frame into a
+// preallocated slot (a FrameArena sized from the first frame) and queues it
+// in a FrameRing. The encoder thread writes the queue to a rolling set of
+// files: prefix_000.avi, prefix_001.avi, ... A new file starts every
+// segmentSeconds of video, and only the newest maxFiles are kept. When the
+// encoder falls behind, the ring's overflow policy decides: drop the oldest
+// or the newest queued frame (capture never waits), or block the caller
+// (nothing is lost, but the caller slows to the encoder's rate). stats()
+// reports encode fps, queue depth and drops, so the pressure is visible.
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "frame_arena.h"
+#include "frame_ring.h"
+#include "latency_stats.h"
+
+// **Output Files and Queue**
+struct RecorderConfig {
+    std::string prefix = "recording";   // Files are prefix_NNN + extension
+    std::string extension = ".avi";
+    std::string fourcc = "MJPG";
+    double fps = 30.0;                  // Frame rate written to the container
+    double segmentSeconds = 300.0;      // Video per file; 0 = a single file
+    int maxFiles = 0;                   // Delete older files beyond this; 0 = keep all
+    size_t queueFrames = 8;
+    OverflowPolicy policy = OverflowPolicy::DropOldest;
+};
+
+// "drop-oldest", "drop-newest", "block"
+bool parseOverflowPolicy(const std::string& name, OverflowPolicy& policy);
+
+struct RecorderStats {
+    uint64_t pushed = 0;       // Frames accepted by push()
+    uint64_t encoded = 0;      // Frames written
+    uint64_t dropped = 0;      // Lost to a full queue
+    uint64_t rejected = 0;     // Wrong size or type, or no writer
+    uint64_t files = 0;        // Files opened so far
+    double encodeFps = 0;      // Over the last second or more
+    size_t queueDepth = 0, queueMaxDepth = 0, queueCapacity = 0;
+    double blockedSeconds = 0;  // Time callers waited in push() (Block policy)
+    std::string currentFile;
+};
+
+class RecordingSink {
+public:
+    explicit RecordingSink(const RecorderConfig& config);
+
+    // Encodes what is still queued, then closes the file.
+    ~RecordingSink();
+
+    RecordingSink(const RecordingSink&) = delete;
+    RecordingSink& operator=(const RecordingSink&) = delete;
+
+    // **Queue a Copy of a CV_8UC3 Frame**
+    // The first frame fixes the size; later frames must match. Returns false
+    // if the frame was not queued (dropped, rejected or closed).
+    bool push(const cv::Mat& frame);
+
+    // Stops accepting frames and waits for the encoder to drain the queue.
+    void close();
+
+    RecorderStats stats();
+
+private:
+    struct Frame {
+        cv::Mat image;  // Points into buffer
+        FrameArena::Lease buffer;
+    };
+
+    bool allocate(const cv::Mat& first);
+    bool openSegment();
+    void encodeLoop();
+
+    RecorderConfig config_;
+    cv::Size size_;
+    int type_ = -1;
+
+    std::unique_ptr<FrameArena> arena_;  // Outlives the ring's leases
+    int bufferIndex_ = -1;
+    FrameRing<Frame> ring_;
+
+    // Encoder thread only
+    cv::VideoWriter writer_;
+    int fileIndex_ = 0;
+    uint64_t segmentFrames_ = 0;
+
+    std::mutex fileMutex_;  // Guards currentFile_
+    std::string currentFile_;
+
+    LatencyHistogram& encodeLatency_;
+    std::atomic<uint64_t> pushed_, encoded_, rejected_, files_, blockedMicros_;
+    std::atomic<bool> closed_;
+    uint64_t reportedEncoded_ = 0;
+    double encodeFps_ = 0;
+    std::chrono::steady_clock::time_point lastStats_;
+    std::thread thread_;
+};
+
+// "Recording recording_002.avi: 29.8 fps encoded, queue 1/8 (max 5), 12 dropped, ..."
+std::string describeRecorderStats(const RecorderStats& stats);
+
+// **Command-Line Options Shared by the Recording Programs**
+//   --record PREFIX          record to PREFIX_000.avi, PREFIX_001.avi, ...
+//   --record-fps N           container frame rate
+//   --record-segment SECONDS video per file (0 = one file)
+//   --record-files N         keep only the newest N files
+//   --record-queue N         queued frames before the policy applies
+//   --record-policy drop-oldest|drop-newest|block
+// Consumes argv[i] and its value if it is one of these (record is set by
+// --record) and returns true; otherwise returns false.
+bool parseRecorderOption(int argc, char** argv, int& i, RecorderConfig& config, bool& record);
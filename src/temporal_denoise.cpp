@@ -0,0 +1,80 @@
+#include "temporal_denoise.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+TemporalDenoiser::TemporalDenoiser(const TemporalDenoiseConfig& config) : config_(config) {
+    config_.strength = std::min(std::max(config_.strength, 0.0), 0.98);
+    config_.noiseLevel = std::max(config_.noiseLevel, 0);
+
+    // **Weight by Difference: Full up to noiseLevel, 0 from 3 * noiseLevel**
+    const int low = config_.noiseLevel, high = 3 * config_.noiseLevel;
+    const double full = config_.strength * 256.0;
+    for (int d = 0; d < 256; d++) {
+        double ramp = d <= low ? 1.0 : d >= high ? 0.0 : double(high - d) / (high - low);
+        weight_[d] = static_cast<uint16_t>(full * ramp + 0.5);
+    }
+}
+
+void TemporalDenoiser::reset() {
+    accumulator_.release();
+    motionFraction_ = 0;
+}
+
+void TemporalDenoiser::apply(const cv::Mat& src, cv::Mat& dst) {
+    CV_Assert(src.depth() == CV_8U);
+    if (src.empty()) {
+        dst.release();
+        return;
+    }
+
+    const int cn = src.channels();
+    const int accType = CV_MAKETYPE(CV_16U, cn);
+
+    // **Start Afresh on the First Frame or a New Shape**
+    if (accumulator_.size() != src.size() || accumulator_.type() != accType) {
+        src.convertTo(accumulator_, CV_16U, 256.0);
+        if (dst.data != src.data) src.copyTo(dst);
+        motionFraction_ = 0;
+        return;
+    }
+
+    dst.create(src.size(), src.type());
+
+    const int rows = src.rows, cols = src.cols;
+    const int stripes = std::max(1, std::min(rows, cv::getNumThreads() * 4));
+    static thread_local std::vector<int64_t> movingCounts;
+    std::vector<int64_t>& moving = movingCounts;
+    moving.assign(stripes, 0);
+
+    cv::parallel_for_(cv::Range(0, stripes), [&](const cv::Range& range) {
+        for (int s = range.start; s < range.end; s++) {
+            int64_t count = 0;
+            for (int y = rows * s / stripes; y < rows * (s + 1) / stripes; y++) {
+                const uchar* in = src.ptr<uchar>(y);
+                uint16_t* acc = accumulator_.ptr<uint16_t>(y);
+                uchar* out = dst.ptr<uchar>(y);
+                for (int x = 0; x < cols; x++, in += cn, acc += cn, out += cn) {
+                    // Largest channel difference from the rounded accumulator
+                    int diff = 0;
+                    for (int c = 0; c < cn; c++)
+                        diff = std::max(diff, std::abs(int(in[c]) - ((acc[c] + 128) >> 8)));
+                    const uint32_t k = weight_[diff];
+                    count += k == 0;
+
+                    for (int c = 0; c < cn; c++) {
+                        uint32_t a = (acc[c] * k + (uint32_t(in[c]) << 8) * (256 - k) + 128) >> 8;
+                        acc[c] = static_cast<uint16_t>(a);
+                        out[c] = static_cast<uchar>((a + 128) >> 8);
+                    }
+                }
+            }
+            moving[s] = count;
+        }
+    });
+
+    int64_t total = 0;
+    for (int64_t count : moving) total += count;
+    motionFraction_ = double(total) / (double(rows) * cols);
+}
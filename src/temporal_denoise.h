@@ -0,0 +1,50 @@
+// Motion-adaptive recursive temporal denoiser for the live loops.
+// Consecutive frames of a still scene differ mostly by sensor noise, which
+// the CLAHE and saturation boost of main5 / main7 then amplify. The
+// denoiser keeps a running accumulator (16-bit fixed point, so repeated
+// blending does not stall on 8-bit rounding) and blends each new frame into
+// it per pixel:
+//
+//   acc = k * acc + (1 - k) * frame,   output = acc
+//
+// k is largest (strength) where the pixel differs from the accumulator by
+// no more than noiseLevel, and falls to 0 at 3 * noiseLevel, so moving
+// edges follow the new frame at once instead of ghosting. The difference is
+// the largest per-channel |frame - acc| of the pixel. One parallel pass reads
+// the frame and the accumulator and writes both outputs; there is no spatial
+// window. Works on any 8-bit interleaved image, including native YUYV.
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <cstdint>
+
+// **Denoiser Settings**
+struct TemporalDenoiseConfig {
+    double strength = 0.75;  // Accumulator weight for static pixels (0 = off, < 1)
+    int noiseLevel = 6;      // Differences up to this are treated as noise (8-bit levels)
+};
+
+class TemporalDenoiser {
+public:
+    explicit TemporalDenoiser(const TemporalDenoiseConfig& config = TemporalDenoiseConfig());
+
+    // **Blend a CV_8UC(n) Frame into the Accumulator (dst may be src)**
+    // The first frame, and any frame of a new size or type, starts the
+    // accumulator afresh and is passed through.
+    void apply(const cv::Mat& src, cv::Mat& dst);
+
+    // Forgets the accumulator, e.g. after a scene cut or camera change.
+    void reset();
+
+    const TemporalDenoiseConfig& config() const { return config_; }
+
+    // Share of pixels on the last frame treated as moving (k = 0)
+    double motionFraction() const { return motionFraction_; }
+
+private:
+    TemporalDenoiseConfig config_;
+    uint16_t weight_[256];   // k in 1/256 steps, by difference
+    cv::Mat accumulator_;    // CV_16UC(n), value * 256
+    double motionFraction_ = 0;
+};
@@ -0,0 +1,198 @@
+#include "white_balance.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+// Gains in 4.12 fixed point; products stay in 32-bit lanes
+const int kGainShift = 12;
+
+struct FixedGains {
+    int b, g, r;
+};
+
+int toFixed(double gain) {
+    return static_cast<int>(std::min(std::max(gain, 0.0), 15.0) * (1 << kGainShift) + 0.5);
+}
+
+FixedGains toFixed(const WbGains& gains) {
+    return {toFixed(gains.b), toFixed(gains.g), toFixed(gains.r)};
+}
+
+// One value times a fixed-point gain, rounded and clamped; the pass and
+// the LUT form both go through this
+inline uchar scaled(uchar value, int gain) {
+    return static_cast<uchar>(std::min((value * gain + (1 << (kGainShift - 1))) >> kGainShift, 255));
+}
+
+// **Scale One Row of Interleaved BGR**
+// Branch-free with a clamp. The gains are taken by value into locals: a
+// store through the uchar pointer may alias anything, so gains read through
+// a reference would be reloaded after every store and GCC would not
+// vectorise the loop. src and dst must not overlap unless they are equal;
+// the in-place case gets its own single-pointer loop, since GCC's runtime
+// overlap check would send it down the scalar path.
+void scaleRow(const uchar* src, uchar* dst, int count, FixedGains gains) {
+    const int gb = gains.b, gg = gains.g, gr = gains.r;
+    for (int x = 0; x < count; x++) {
+        dst[3 * x] = scaled(src[3 * x], gb);
+        dst[3 * x + 1] = scaled(src[3 * x + 1], gg);
+        dst[3 * x + 2] = scaled(src[3 * x + 2], gr);
+    }
+}
+
+void scaleRowInPlace(uchar* p, int count, FixedGains gains) {
+    const int gb = gains.b, gg = gains.g, gr = gains.r;
+    for (int x = 0; x < count; x++) {
+        p[3 * x] = scaled(p[3 * x], gb);
+        p[3 * x + 1] = scaled(p[3 * x + 1], gg);
+        p[3 * x + 2] = scaled(p[3 * x + 2], gr);
+    }
+}
+
+// Histogramming is scalar; done on the row while it is still in cache
+void countRow(const uchar* p, int count, FrameHistograms& h) {
+    for (int x = 0; x < count; x++) {
+        h.bins[0][p[3 * x]]++;
+        h.bins[1][p[3 * x + 1]]++;
+        h.bins[2][p[3 * x + 2]]++;
+    }
+    h.pixels += count;
+}
+
+double clampGain(double gain, double maxGain) {
+    maxGain = std::max(maxGain, 1.0);
+    return std::min(std::max(gain, 1.0 / maxGain), maxGain);
+}
+
+}  // namespace
+
+const char* wbEstimatorName(WbEstimator estimator) {
+    switch (estimator) {
+        case WbEstimator::GrayWorld: return "gray-world";
+        case WbEstimator::WhitePatch: return "white-patch";
+        case WbEstimator::Percentile: return "percentile";
+    }
+    return "unknown";
+}
+
+bool parseWbEstimator(const std::string& name, WbEstimator& estimator) {
+    for (WbEstimator e : {WbEstimator::GrayWorld, WbEstimator::WhitePatch, WbEstimator::Percentile}) {
+        if (name == wbEstimatorName(e)) {
+            estimator = e;
+            return true;
+        }
+    }
+    return false;
+}
+
+// **Gains Relative to Green from One Set of Histograms**
+WbGains estimateWbGains(const FrameHistograms& h, const WbConfig& config) {
+    WbGains gains;
+    if (h.pixels == 0) return gains;
+
+    double reference[3];
+    switch (config.estimator) {
+        case WbEstimator::GrayWorld:
+            for (int c = 0; c < 3; c++) reference[c] = h.mean(static_cast<FrameHistograms::Channel>(c));
+            if (config.targetTemp > 0) {
+                // main8's original correction: blue by target / estimate, red by its inverse
+                FrameStats stats;
+                stats.meanB = reference[0];
+                stats.meanG = reference[1];
+                stats.meanR = reference[2];
+                double scale = config.targetTemp / (stats.colorTemperature() + 1e-6);
+                gains.b = clampGain(scale, config.maxGain);
+                gains.r = clampGain(1.0 / scale, config.maxGain);
+                return gains;
+            }
+            break;
+        case WbEstimator::WhitePatch:
+            for (int c = 0; c < 3; c++) reference[c] = h.percentile(static_cast<FrameHistograms::Channel>(c), 1.0);
+            break;
+        case WbEstimator::Percentile:
+            for (int c = 0; c < 3; c++)
+                reference[c] = h.percentile(static_cast<FrameHistograms::Channel>(c), config.percentile);
+            break;
+    }
+
+    const double green = std::max(reference[1], 1.0);
+    gains.b = clampGain(green / std::max(reference[0], 1.0), config.maxGain);
+    gains.r = clampGain(green / std::max(reference[2], 1.0), config.maxGain);
+    return gains;
+}
+
+void wbGainLut(const WbGains& gains, cv::Mat& lut) {
+    const FixedGains fixed = toFixed(gains);
+    const int channelGains[3] = {fixed.b, fixed.g, fixed.r};
+    lut.create(1, 256, CV_8UC3);
+    uchar* out = lut.ptr<uchar>();
+    for (int i = 0; i < 256; i++)
+        for (int c = 0; c < 3; c++) out[3 * i + c] = scaled(static_cast<uchar>(i), channelGains[c]);
+}
+
+// **Balancer**
+SoftwareWhiteBalancer::SoftwareWhiteBalancer(const WbConfig& config) : config_(config) {
+    histograms_.clear();
+}
+
+void SoftwareWhiteBalancer::apply(const cv::Mat& src, cv::Mat& dst) {
+    if (src.empty() || src.type() != CV_8UC3) {
+        std::cerr << "Error: SoftwareWhiteBalancer needs a CV_8UC3 image" << std::endl;
+        return;
+    }
+
+    if (config_.live && haveStats_ && histograms_.pixels > 0) {
+        gains_ = estimateWbGains(histograms_, config_);
+        applyGains(src, dst, gains_, true);  // Measures this frame for the next one
+        return;
+    }
+
+    measure(src);
+    gains_ = estimateWbGains(histograms_, config_);
+    applyGains(src, dst, gains_, false);
+}
+
+void SoftwareWhiteBalancer::measure(const cv::Mat& bgr) {
+    pass(bgr, nullptr, WbGains(), true);
+}
+
+void SoftwareWhiteBalancer::applyGains(const cv::Mat& src, cv::Mat& dst, const WbGains& gains, bool measureInput) {
+    if (dst.data != src.data) dst.create(src.size(), src.type());
+    pass(src, &dst, gains, measureInput);
+}
+
+// **One Parallel Pass: Histogram the Input Row, Then Scale It**
+void SoftwareWhiteBalancer::pass(const cv::Mat& src, cv::Mat* dst, const WbGains& gains, bool measure) {
+    if (src.empty() || src.type() != CV_8UC3) return;
+
+    const int rows = src.rows, cols = src.cols;
+    const FixedGains fixed = toFixed(gains);
+    const int stripes = std::max(1, std::min(rows, cv::getNumThreads() * 4));
+    if (measure) {
+        partial_.resize(stripes);
+        for (FrameHistograms& h : partial_) h.clear();
+    }
+
+    cv::parallel_for_(cv::Range(0, stripes), [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; i++) {
+            int y0 = static_cast<int>(static_cast<int64_t>(rows) * i / stripes);
+            int y1 = static_cast<int>(static_cast<int64_t>(rows) * (i + 1) / stripes);
+            for (int y = y0; y < y1; y++) {
+                const uchar* in = src.ptr<uchar>(y);
+                if (measure) countRow(in, cols, partial_[i]);
+                if (!dst) continue;
+                uchar* out = dst->ptr<uchar>(y);
+                if (out == in) scaleRowInPlace(out, cols, fixed);
+                else scaleRow(in, out, cols, fixed);
+            }
+        }
+    });
+
+    if (measure) {
+        histograms_.clear();
+        for (const FrameHistograms& h : partial_) histograms_.add(h);
+        haveStats_ = true;
+    }
+}
@@ -0,0 +1,93 @@
+// Software white balance for cameras without (usable) hardware WB.
+// main8 used to split the frame into planes, scale blue and red with two
+// Mat operations and merge again: three passes and three plane allocations
+// per frame, after a separate cv::mean pass for the estimate. Here the
+// gains are applied to the interleaved BGR pixels in one parallel pass,
+// in place if wanted, with 12-bit fixed-point multiplies in a branch-free
+// row loop written so GCC can vectorise it. The same pass can collect
+// 256-bin histograms of its input's B, G and R (FrameHistograms, as
+// FrameAnalyzer fills them), from which three estimators derive the next
+// gains in O(256):
+//
+//   gray-world   channel means equal (optionally toward a target temperature)
+//   white-patch  channel maxima equal
+//   percentile   channel percentiles equal (white-patch that ignores a few
+//                clipped or specular pixels)
+//
+// All gains are relative to green, which keeps brightness roughly constant.
+// In live mode each frame is balanced with the gains from the previous
+// frame's histograms, so a frame costs a single read-modify-write pass.
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "frame_stats.h"
+
+enum class WbEstimator {
+    GrayWorld,
+    WhitePatch,
+    Percentile,
+};
+
+// "gray-world", "white-patch", "percentile"
+const char* wbEstimatorName(WbEstimator estimator);
+bool parseWbEstimator(const std::string& name, WbEstimator& estimator);
+
+struct WbGains {
+    double b = 1.0, g = 1.0, r = 1.0;
+};
+
+// **Estimator Settings**
+struct WbConfig {
+    WbEstimator estimator = WbEstimator::GrayWorld;
+    double targetTemp = 0;      // Gray-world only: > 0 scales toward this temperature like main8
+    double percentile = 0.99;   // Percentile estimator
+    double maxGain = 4.0;       // Gains are clamped to [1 / maxGain, maxGain]
+    bool live = false;          // Use the previous frame's statistics (one pass per frame)
+};
+
+// Uses the Blue, Green and Red channels; histograms from FrameAnalyzer
+// (the frame was analysed anyway) and from the balancer's own pass both work.
+WbGains estimateWbGains(const FrameHistograms& histograms, const WbConfig& config);
+
+// **The Gains as a 1x256 CV_8UC3 Table, Bit-Exact with the Pass**
+// For chains that fold white balance into a fused point-op LUT.
+void wbGainLut(const WbGains& gains, cv::Mat& lut);
+
+class SoftwareWhiteBalancer {
+public:
+    explicit SoftwareWhiteBalancer(const WbConfig& config = WbConfig());
+
+    // **Balance a CV_8UC3 BGR Frame (dst may be src)**
+    // Live mode: one pass, gains from the previous frame. Otherwise (and on
+    // the first live frame) a histogram pass, then the gain pass.
+    void apply(const cv::Mat& src, cv::Mat& dst);
+
+    // **The Two Halves, for Callers That Manage Gains Themselves**
+    void measure(const cv::Mat& bgr);
+    void applyGains(const cv::Mat& src, cv::Mat& dst, const WbGains& gains, bool measureInput = false);
+
+    // Histograms of the input of the last measuring pass (Blue, Green and Red
+    // only), and the gains the last apply() used
+    const FrameHistograms& histograms() const { return histograms_; }
+    const WbGains& gains() const { return gains_; }
+
+    const WbConfig& config() const { return config_; }
+    void setConfig(const WbConfig& config) { config_ = config; }
+
+    // Drops the previous frame's statistics (live mode measures afresh).
+    void reset() { haveStats_ = false; }
+
+private:
+    void pass(const cv::Mat& src, cv::Mat* dst, const WbGains& gains, bool measure);
+
+    WbConfig config_;
+    FrameHistograms histograms_;
+    WbGains gains_;
+    bool haveStats_ = false;
+    std::vector<FrameHistograms> partial_;  // One per stripe, kept between frames
+};
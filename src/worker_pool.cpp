@@ -0,0 +1,81 @@
+#include "worker_pool.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+bool pinThreadToCore(std::thread& thread, int core) {
+    const int cores = static_cast<int>(std::thread::hardware_concurrency());
+    if (core < 0 || (cores > 0 && core >= cores)) {
+        std::cerr << "Error: Cannot pin to core " << core << " (" << cores << " cores)\n";
+        return false;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    int err = pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+    if (err != 0) {
+        std::cerr << "Error: pthread_setaffinity_np(core " << core << "): " << std::strerror(err) << "\n";
+        return false;
+    }
+    return true;
+}
+
+WorkerPool::WorkerPool(int threads, int firstCore) {
+    const int cores = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    if (threads <= 0) threads = cores;
+
+    threads_.reserve(threads);
+    for (int i = 0; i < threads; i++) {
+        threads_.emplace_back(&WorkerPool::loop, this);
+        if (firstCore >= 0) pinThreadToCore(threads_.back(), (firstCore + i) % cores);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& t : threads_) t.join();
+}
+
+void WorkerPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    wake_.notify_one();
+}
+
+void WorkerPool::drain() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this] { return tasks_.empty() && running_ == 0; });
+}
+
+size_t WorkerPool::pending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return tasks_.size();
+}
+
+void WorkerPool::loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        wake_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+        if (tasks_.empty()) return;  // Stopping and drained
+
+        std::function<void()> task = std::move(tasks_.front());
+        tasks_.pop_front();
+        running_++;
+        lock.unlock();
+        task();
+        lock.lock();
+        if (--running_ == 0 && tasks_.empty()) idle_.notify_all();
+    }
+}
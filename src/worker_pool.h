@@ -0,0 +1,51 @@
+// Fixed pool of threads running queued tasks.
+// Used where several producers share the processing cores, e.g. every
+// camera of the multi-camera runtime, instead of each starting its own
+// threads and competing for the same cores. Workers can be pinned to cores
+// with pthread_setaffinity_np.
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// **Pin a Thread to One Core (Linux)**
+// Returns false, with a message, if the core does not exist or the call fails.
+bool pinThreadToCore(std::thread& thread, int core);
+
+class WorkerPool {
+public:
+    // threads <= 0: one per core. firstCore >= 0 pins worker i to core
+    // (firstCore + i) modulo the number of cores.
+    explicit WorkerPool(int threads = 0, int firstCore = -1);
+
+    // Runs the tasks still queued, then joins the workers.
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    void submit(std::function<void()> task);
+
+    // Waits until the queue is empty and no task is running. Tasks may
+    // submit further tasks meanwhile; those are waited for too.
+    void drain();
+
+    int size() const { return static_cast<int>(threads_.size()); }
+    size_t pending() const;
+
+private:
+    void loop();
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::deque<std::function<void()>> tasks_;
+    int running_ = 0;  // Tasks being run
+    bool stopping_ = false;
+    std::vector<std::thread> threads_;
+};